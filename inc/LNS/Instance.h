@@ -41,6 +41,8 @@ public:
         return getManhattanDistance(curr, next) < 2;
     }
     list<int> getNeighbors(int curr) const;
+    // the same as above, but write them into neighbors, which has room for 4, and return the number.
+    int getNeighbors(int curr, int * neighbors) const;
 
 
     inline int linearizeCoordinate(int row, int col) const { return ( this->num_of_cols * row + col); }
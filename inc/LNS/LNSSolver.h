@@ -9,6 +9,8 @@
 #include "common.h"
 #include <unordered_set>
 #include <queue>
+#include <thread>
+#include <atomic>
 #include "LaCAM2/LaCAM2Solver.hpp"
 #include "LNS/Parallel/GlobalManager.h"
 #include "util/StatsTree.h"
@@ -59,10 +61,52 @@ public:
     bool need_new_execution_paths=false;
     int execution_window; // TODO: read it from config
     int planning_window; // TODO: read it from config
+    string replan_algo;
+    bool sipp=false;
+    // the side of the square regions of the congestion destroy heuristic, 0 disables it.
+    int congestion_region_size=0;
+    // if set, the per-iteration statistics of LNS are written to this CSV file.
+    string telemetry_path;
 
     int num_task_completed=0;
     int max_task_completed;
 
+    // if true, plan() advances the previous LNS solution by the steps executed since instead of resetting it.
+    bool warm_start=false;
+    bool lns_solved=false;
+    int shifted_steps=0; // the steps planning_paths are shifted by since the last LNS run
+    std::vector<Parallel::Path> warm_paths;
+    std::vector<int> extended_from; // [agent]: the first timestep of planning_paths that extend_paths() changed
+    std::vector<int> changed_agents; // the agents whose paths or goals changed since the last LNS run
+
+    // if true, while the execution paths are executed a background thread extends the planning paths left after
+    // them with LaCAM2 and keeps optimizing them with its own GlobalManager. plan() leaves the time of each step
+    // to it and only takes its paths when the execution paths run out. if goals were reassigned meanwhile, plan()
+    // keeps the taken paths of the other agents and replans the reassigned ones in the LNS of the step.
+    bool background=false;
+    SharedEnvironment background_env;
+    std::vector<::Path> background_paths;
+    std::shared_ptr<Instance> background_instance;
+    std::shared_ptr<Parallel::GlobalManager> background_lns;
+    std::thread background_thread;
+    std::atomic<bool> background_stop{false};
+    // planning_paths were taken from the background since the last LNS run, so lns cannot be advanced to them.
+    bool background_taken=false;
+    void start_background(const SharedEnvironment & env);
+    // whether a goal in env differs from the one the running background plans for.
+    bool background_goals_changed(const SharedEnvironment & env) const;
+    // whether the agents that end their background paths early can wait there until the end of the planning
+    // window, as stop_background() pads their planning paths, without colliding.
+    bool background_padding_collision_free() const;
+    // stop the background optimization if it runs and take its paths. it must be called before the shared
+    // heuristics or map weights are modified.
+    void stop_background();
+
+    // extend the paths shorter than the planning window with LaCAM2. paths[i] must start at starts[i]. if
+    // changed_from is given, it is set to the first timestep where each path changes, its old length if it is
+    // only extended.
+    void extend_paths(const SharedEnvironment & env, std::vector<::Path> & paths, std::vector<::State> & starts, std::vector<::State> & goals, const string & timer_prefix, std::vector<int> * changed_from=nullptr);
+
     LNSSolver(
         const std::shared_ptr<HeuristicTable> & HT,
         SharedEnvironment * env,
@@ -73,6 +117,7 @@ public:
     );
 
     ~LNSSolver(){
+        stop_background();
         delete MT;
     };
 
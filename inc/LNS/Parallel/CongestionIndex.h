@@ -0,0 +1,57 @@
+#pragma once
+#include "LNS/Parallel/DataStructure.h"
+#include <random>
+
+namespace LNS {
+
+namespace Parallel {
+
+// The delays of the current paths, accumulated over square regions of the map for the congestion destroy heuristic.
+// Every agent adds its number of delays to each region its path passes through within the window, so a region is
+// hot if many delayed agents go through it. The heats are kept in a Fenwick tree, so updating an agent and sampling
+// a region in proportion to its heat both take O(log #regions), and the index is updated whenever a path changes
+// instead of being rebuilt for every neighbor.
+class CongestionIndex {
+public:
+    CongestionIndex(const Instance & instance, int region_size, int max_path_length);
+
+    // replace the contribution of agent.
+    void update(Agent & agent);
+    // with path instead of agent.path.
+    void update(Agent & agent, const Path & path);
+    void update(std::vector<Agent> & agents);
+    void reset();
+
+    // sample a region in proportion to its heat, -1 if nothing is delayed.
+    int sample(std::mt19937 & MT) const;
+    // the cells of region, row by row.
+    void get_region(int region, int & x0, int & y0, int & x1, int & y1) const;
+
+    inline int get_num_of_regions() const {return n_regions;}
+    inline double get_total_heat() const {return prefix_sum(n_regions);}
+
+    int region_size;
+    int n_region_cols;
+    int n_region_rows;
+
+private:
+    const Instance & instance;
+    int n_regions;
+    int max_path_length;
+
+    std::vector<double> tree; // [1..n_regions], Fenwick tree of the heats
+    std::vector<float> contributions; // [agent]: the delays each region of the agent got
+    std::vector<int> agent_regions; // [agent][max_path_length]: the distinct regions of the agent's path
+    std::vector<int> agent_region_counts; // [agent]
+
+    void add(int region, double delta);
+    double prefix_sum(int n) const;
+
+    inline int get_region(int loc) const {
+        return (loc/instance.num_of_cols/region_size)*n_region_cols+loc%instance.num_of_cols/region_size;
+    }
+};
+
+}
+
+} // namespace LNS
@@ -2,12 +2,16 @@
 #include "common.h"
 #include "LNS/Instance.h"
 #include "LaCAM2/instance.hpp"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
 
 namespace LNS {
 
 namespace Parallel {
 
-enum destroy_heuristic { RANDOMAGENTS, RANDOMWALK, INTERSECTION, DESTORY_COUNT };
+enum destroy_heuristic { RANDOMAGENTS, RANDOMWALK, INTERSECTION, CONGESTION, DESTORY_COUNT };
 
 struct PathEntry {
     int location;
@@ -24,14 +28,32 @@ struct Path {
     }
 
     inline PathEntry & operator [] (int i) { return nodes[i];}
-    inline size_t size() {return nodes.size();}
-    inline bool empty() {return nodes.empty();}
+    inline const PathEntry & operator [] (int i) const { return nodes[i];}
+    inline size_t size() const {return nodes.size();}
+    inline bool empty() const {return nodes.empty();}
 
     inline PathEntry & back() {return nodes.back();}
+    inline const PathEntry & back() const {return nodes.back();}
     inline PathEntry & front() {return nodes.front();}
+    inline const PathEntry & front() const {return nodes.front();}
 
 };
 
+// a sorted vector of ids used instead of std::set<int>: it iterates in the same order, and clear() keeps its memory.
+// return false if id is already in it.
+inline bool insert_sorted(std::vector<int> & ids, int id) {
+    auto it=std::lower_bound(ids.begin(),ids.end(),id);
+    if (it!=ids.end() && *it==id) {
+        return false;
+    }
+    ids.insert(it,id);
+    return true;
+}
+
+inline bool contains_sorted(const std::vector<int> & ids, int id) {
+    return std::binary_search(ids.begin(),ids.end(),id);
+}
+
 std::ostream & operator << (std::ostream &out, const PathEntry &pe);
 std::ostream & operator << (std::ostream &out, const Path &p);
 
@@ -84,7 +106,7 @@ struct Agent
         }
     }
 
-    inline float getEstimatedPathLength(Path & path, int goal_location, std::shared_ptr<HeuristicTable> HT, bool arrival_break=false, int T=-1) {
+    inline float getEstimatedPathLength(const Path & path, int goal_location, std::shared_ptr<HeuristicTable> HT, bool arrival_break=false, int T=-1) {
         if ((*agent_infos)[id].disabled) { // if disabled, we just set its estimated path length to 0. namely ignore it anyway.
             return 0;
         }
@@ -115,6 +137,11 @@ struct Agent
     }
 
     inline float getNumOfDelays() {
+        return getNumOfDelays(path);
+    }
+
+    // of another path of this agent, e.g., its current one in a PathStore.
+    inline float getNumOfDelays(const Path & path) {
         // : we may need two heuristic table: one for cost, one for path length estimation.
         return getEstimatedPathLength(path,instance.goal_locations[id],HT) - HT->get(instance.start_locations[id],instance.start_orientations[id],instance.goal_locations[id]);
     }
@@ -124,21 +151,197 @@ struct Agent
     }
 };
 
+// A neighbor is reused across iterations instead of being built from scratch: its path buffers keep their capacity,
+// so once they have grown to the longest path, replanning it allocates nothing.
+// agents is sorted, and m_paths[i] and m_old_paths[i] are the paths of agents[i]. The path vectors never shrink,
+// so only their first agents.size() entries are in use.
 struct Neighbor
 {
     vector<int> agents;
     float sum_of_costs;
     float old_sum_of_costs;
-    std::map<int, Path> m_paths; // for temporally storing the new paths. may change to vector later, agent id -> path
+    vector<Path> m_paths; // for temporally storing the new paths
     // set<pair<int, int>> colliding_pairs;  // id1 < id2
     // set<pair<int, int>> old_colliding_pairs;  // id1 < id2
-    // std::vector<Path> old_paths;
-    std::map<int, Path> m_old_paths; // for temporally storing the old paths. may change to vector later, agent id -> path
+    vector<Path> m_old_paths; // for temporally storing the old paths
     bool succ = false;
-    int selected_neighbor;
+    int selected_neighbor = -1;
 
     float num_arrived;
     float old_num_arrived;
+
+    // call it after agents are set: sort them and clear a path slot for each of them.
+    void reset_paths() {
+        std::sort(agents.begin(),agents.end());
+        if (m_paths.size()<agents.size()) {
+            m_paths.resize(agents.size());
+            m_old_paths.resize(agents.size());
+        }
+        for (size_t i=0;i<agents.size();++i) {
+            m_paths[i].clear();
+            m_old_paths[i].clear();
+        }
+    }
+
+    // the slot of agent aid, -1 if it is not in the neighbor.
+    inline int find(int aid) const {
+        auto it=std::lower_bound(agents.begin(),agents.end(),aid);
+        if (it==agents.end() || *it!=aid) {
+            return -1;
+        }
+        return (int)(it-agents.begin());
+    }
+};
+
+// An append-only log of the neighbors committed to the global solution, shared by all local optimizers in async LNS.
+// Each committed neighbor is stored once, and every local optimizer replays the entries from the version it has
+// seen to keep its own path table in sync. Writers reserve a slot with an atomic counter and then mark it ready,
+// readers replay ready slots in order and stop at the first one still being written, so nobody takes a lock.
+// Two neighbors that touch the same agents or locations are committed one after another (see
+// GlobalManager::commit), so the later one always gets the later slot and in-order replay is consistent.
+// Entries live in fixed chunks that never move, so appending never invalidates what readers are looking at.
+// Once all max_chunks are used, no more neighbors can be committed until the log is cleared, e.g., by advance().
+class CommitLog {
+public:
+    static const size_t chunk_size=1024;
+    static const size_t max_chunks=4096;
+
+    CommitLog(): chunks(new std::atomic<Entry *>[max_chunks]) {
+        for (size_t i=0;i<max_chunks;++i) {
+            chunks[i].store(nullptr,std::memory_order_relaxed);
+        }
+    };
+
+    ~CommitLog() {
+        for (size_t i=0;i<max_chunks;++i) {
+            delete [] chunks[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    CommitLog(const CommitLog &)=delete;
+    CommitLog & operator=(const CommitLog &)=delete;
+
+    // safe to call from multiple threads. take the next slot, or return false if the log is full, in which case the
+    // neighbor must not be committed. the slot blocks the readers of later ones until it is published.
+    bool reserve(size_t & version) {
+        version=n_entries.load(std::memory_order_relaxed);
+        do {
+            if (version>=max_chunks*chunk_size) {
+                return false;
+            }
+        } while (!n_entries.compare_exchange_weak(version,version+1,std::memory_order_relaxed));
+        size_t chunk_idx=version/chunk_size;
+        Entry * chunk=chunks[chunk_idx].load(std::memory_order_acquire);
+        if (chunk==nullptr) {
+            // the writers of the first slots of a chunk may race to allocate it, only one of them wins.
+            Entry * new_chunk=new Entry[chunk_size];
+            if (!chunks[chunk_idx].compare_exchange_strong(chunk,new_chunk,std::memory_order_acq_rel)) {
+                delete [] new_chunk;
+            }
+        }
+        return true;
+    }
+
+    // write the slot taken by reserve(). the neighbor is swapped into its entry without copying any path, and it
+    // gets back the buffers of the neighbor the entry held before clear(), so they are reused by the next iteration.
+    void publish(size_t version, Neighbor & neighbor) {
+        Entry & entry=chunks[version/chunk_size].load(std::memory_order_acquire)[version%chunk_size];
+        std::swap(entry.neighbor,neighbor);
+        entry.ready.store(true,std::memory_order_release);
+    }
+
+    // return nullptr if the entry of version has not been completely written yet.
+    inline const Neighbor * try_get(size_t version) const {
+        if (version>=n_entries.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        Entry * chunk=chunks[version/chunk_size].load(std::memory_order_acquire);
+        if (chunk==nullptr) {
+            return nullptr;
+        }
+        const Entry & entry=chunk[version%chunk_size];
+        if (!entry.ready.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &entry.neighbor;
+    }
+
+    // the number of reserved entries, some of the last ones may be still being written.
+    inline size_t size() const {
+        return n_entries.load(std::memory_order_acquire);
+    }
+
+    // must not be called while anyone reads or writes the log. the chunks and their neighbors are kept for reuse,
+    // which also keeps freeing them out of the planner's critical path.
+    void clear() {
+        size_t n=n_entries.load(std::memory_order_relaxed);
+        for (size_t i=0;i<n;++i) {
+            Entry & entry=chunks[i/chunk_size].load(std::memory_order_relaxed)[i%chunk_size];
+            entry.ready.store(false,std::memory_order_relaxed);
+        }
+        n_entries.store(0,std::memory_order_release);
+    }
+
+private:
+    struct Entry {
+        Neighbor neighbor;
+        std::atomic<bool> ready{false};
+    };
+
+    std::unique_ptr<std::atomic<Entry *>[]> chunks;
+    std::atomic<size_t> n_entries{0};
+};
+
+// The current paths of all agents, read by every local optimizer and neighbor generator instead of a copy per thread.
+// During a run no path is written in place: agents[aid].path is the path at the start of the run, and a commit
+// points its agents to the CommitLog entry that holds their new paths by storing the version of the entry. A reader
+// loads the version and reads an immutable path, so it takes no lock and never holds up the committer. The path may
+// be replaced right after it is read, which the commit re-checks anyway. With no commit, e.g., in sync mode, every
+// agent reads agents[aid].path.
+class PathStore {
+public:
+    static const size_t BASE=SIZE_MAX; // the path is agents[aid].path
+
+    PathStore(std::vector<Agent> & agents, const CommitLog & log, int num_of_agents):
+        agents(agents), log(log), n_agents(num_of_agents), versions(new std::atomic<size_t>[num_of_agents]) {
+        for (int i=0;i<n_agents;++i) {
+            versions[i].store(BASE,std::memory_order_relaxed);
+        }
+    }
+
+    PathStore(const PathStore &)=delete;
+    PathStore & operator=(const PathStore &)=delete;
+
+    inline const Path & get(int aid) const {
+        size_t version=versions[aid].load(std::memory_order_acquire);
+        if (version==BASE) {
+            return agents[aid].path;
+        }
+        const Neighbor * neighbor=log.try_get(version);
+        return neighbor->m_paths[neighbor->find(aid)];
+    }
+
+    // called by the commit owning aid, after the entry of version is published.
+    inline void set(int aid, size_t version) {
+        versions[aid].store(version,std::memory_order_release);
+    }
+
+    // copy the paths committed in the run back into agents, so that the log can be cleared. must not be called while
+    // anyone reads or commits.
+    void flush() {
+        for (int i=0;i<n_agents;++i) {
+            if (versions[i].load(std::memory_order_relaxed)!=BASE) {
+                agents[i].path=get(i);
+                versions[i].store(BASE,std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    std::vector<Agent> & agents;
+    const CommitLog & log;
+    int n_agents;
+    std::unique_ptr<std::atomic<size_t>[]> versions;
 };
 
 }
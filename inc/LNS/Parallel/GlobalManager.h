@@ -2,15 +2,36 @@
 #include "LNS/Parallel/DataStructure.h"
 #include "LNS/Parallel/NeighborGenerator.h"
 #include "LNS/Parallel/LocalOptimizer.h"
+#include "LNS/Parallel/Telemetry.h"
 #include "util/TimeLimiter.h"
 #include <memory>
 #include "LaCAM2/instance.hpp"
 #include <omp.h>
+#include <atomic>
 
 namespace LNS {
 
 namespace Parallel {
 
+// counters of the optimistic commits in async mode, reset at every run.
+struct CommitStats {
+    std::atomic<size_t> n_attempts{0}; // succeeded neighbors that tried to commit
+    std::atomic<size_t> n_commits{0};
+    std::atomic<size_t> n_invalid{0}; // no longer valid or cheaper against the global solution
+    std::atomic<size_t> n_aborts{0}; // attempts that found an agent or location taken by another commit
+    std::atomic<size_t> n_dropped{0}; // given up after max_commit_retries aborts, or because the commit log is full
+    std::atomic<uint64_t> wait_ns{0}; // spent backing off after aborts
+
+    void reset() {
+        n_attempts=0;
+        n_commits=0;
+        n_invalid=0;
+        n_aborts=0;
+        n_dropped=0;
+        wait_ns=0;
+    }
+};
+
 class GlobalManager
 {
 public:
@@ -26,7 +47,8 @@ public:
     int window_size_for_CT;
     int window_size_for_CAT;
     int window_size_for_PATH;
-    list<IterationStats> iteration_stats;
+    // a vector, so clear() keeps its memory for the next run.
+    vector<IterationStats> iteration_stats;
     string init_algo_name;
     string replan_algo_name;
     Instance & instance;
@@ -39,13 +61,49 @@ public:
 
     std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos;
 
-    std::vector<std::vector<Neighbor>> updating_queues; // the generated neighbors for usage
-    std::vector<omp_lock_t> updating_queue_locks;
+    // the neighbors committed in async mode, replayed by every local optimizer.
+    CommitLog commit_log;
+    // the current paths of agents during an async run, copied back into agents when it ends.
+    PathStore path_store;
+
+    // in async mode, neighbors are committed without a global lock. a commit owns the agents of the neighbor and
+    // the locations on their old and new paths by advancing their stamps from even to odd with a CAS, and
+    // advances them again when it is done. if any of them is already odd, another commit overlaps and this one
+    // backs off and retries, so commits of disjoint neighbors run concurrently.
+    std::unique_ptr<std::atomic<uint32_t>[]> agent_stamps;
+    std::unique_ptr<std::atomic<uint32_t>[]> location_stamps;
+    int max_commit_retries=8;
+    CommitStats commit_stats;
+    // the iterations of each thread in async mode, merged into sum_of_costs, num_of_failures and iteration_stats
+    // when the run ends, so that no thread takes a lock for its statistics.
+    struct ThreadIteration {
+        int group_size;
+        float cost_delta; // 0 if not committed
+        double elapse;
+    };
+    struct alignas(64) ThreadStats {
+        int num_of_failures=0;
+        std::vector<ThreadIteration> iterations; // clear() keeps its memory for the next run
+    };
+    std::vector<ThreadStats> thread_stats;
+
+    // if set, every async iteration is recorded and flushed at the end of run().
+    std::shared_ptr<Telemetry> telemetry;
 
     bool has_disabled_agents=false;
 
     bool async=false;
 
+    // prepended to the g_timer keys and the commit log line, so e.g. a background run is reported apart.
+    string timer_prefix;
+
+    // set by advance(): agents and the path tables already hold the initial solution of the next run().
+    bool warm_started=false;
+
+    // replanned together as the first neighbor of the next async run(), e.g., the agents whose goals were
+    // reassigned after their initial paths were planned. cleared by run().
+    std::vector<int> priority_agents;
+
     GlobalManager(
         bool async,
         Instance & instance, std::shared_ptr<HeuristicTable> HT, 
@@ -54,21 +112,36 @@ public:
         bool ALNS, double decay_factor, double reaction_factor,
         string init_algo_name, string replan_algo_name, bool sipp,
         int window_size_for_CT, int window_size_for_CAT, int window_size_for_PATH, int execution_window,
+        int congestion_region_size,
         bool has_disabled_agents,
         bool fix_ng_bug,
         int screen
     );
 
-    ~GlobalManager();
-
     void getInitialSolution(Neighbor & neighbor);
+    // warm start across timesteps instead of reset(): drop the first steps timesteps of the current solution.
+    // the agents in changed_agents, sorted, take new_paths, which start where the old paths are after steps
+    // timesteps, and the other agents only append new_paths to their paths. see PathTable::advance(). the ALNS
+    // weights and tabu lists of the neighbor generators are kept.
+    void advance(int steps, const std::vector<int> & changed_agents, std::vector<Path> & new_paths);
     bool _run_async(TimeLimiter & time_limiter);
     bool _run(TimeLimiter & time_limiter);
     bool run(TimeLimiter & time_limiter);
     void update(Neighbor & neighbor, bool recheck);
     void update(Neighbor & neighbor);
+    // commit a succeeded neighbor in async mode, set neighbor.succ to false if it fails. cost_delta is the change
+    // of the sum of costs if it is committed, and the time spent backing off is added to wait_ns. the neighbor is
+    // swapped into commit_log on success and gets back the buffers of an old entry.
+    commit_result commit(Neighbor & neighbor, float & cost_delta, uint64_t & wait_ns);
     void reset();
 
+private:
+    void check_initial_path(int agent_id, Path & path);
+    // getInitialSolution() and synchronize it to the local optimizers, unless advance() has done it.
+    void init_solution(Neighbor & init_neighbor);
+    // replan priority_agents with the first local optimizer and commit them, before the threads start.
+    void replan_priority_agents(TimeLimiter & time_limiter);
+
     string getSolverName() const { return "LNS(" + init_algo_name + ";" + replan_algo_name + ")"; }
 
 };
@@ -3,7 +3,9 @@
 #include "util/HeuristicTable.h"
 #include "util/TimeLimiter.h"
 #include "LNS/Parallel/TimeSpaceAStarPlanner.h"
+#include "LNS/Parallel/SIPPPlanner.h"
 #include "LaCAM2/instance.hpp"
+#include "LNS/Parallel/CongestionIndex.h"
 
 namespace LNS {
 
@@ -14,17 +16,31 @@ class LocalOptimizer
 public:
     // : think about what data structure needs a separate copy for each local optimizer.
     Instance & instance;
-    PathTable path_table; // maintain a copy
-    std::vector<Agent> agents; // remove in the future, currently we can visit it for agent id but not do anything else.
+    // a view of the global path table, in which runPP() hides the neighbor and inserts its new paths.
+    PathTable path_table;
+    // the global agents, only read for their ids, starts and goals: their current paths are in path_store.
+    std::vector<Agent> & agents;
+    const PathStore & path_store;
     std::shared_ptr<HeuristicTable> HT;
     std::shared_ptr<vector<float> > map_weights;
     std::shared_ptr<TimeSpaceAStarPlanner> path_planner;
+    // used instead of path_planner if sipp is true.
+    std::shared_ptr<SIPPPlanner> sipp_planner;
+    // the delays of agents' paths for the congestion destroy heuristic, nullptr if it is disabled.
+    std::shared_ptr<CongestionIndex> congestion_index;
 
     std::mt19937 MT; 
 
     std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos;
 
-    std::vector<Neighbor> updating_queue;
+    // the neighbor slots in the order runPP() plans them, kept to avoid allocating it every iteration.
+    std::vector<int> shuffled_slots;
+
+    // the number of entries of the global CommitLog applied to congestion_index.
+    size_t log_version=0;
+
+    // the states the single-agent planner expanded in the last optimize().
+    int n_expanded=0;
 
     string replan_algo_name;
     int window_size_for_CT;
@@ -36,17 +52,23 @@ public:
     bool has_disabled_agents=false;
 
     LocalOptimizer(
-        Instance & instance, std::vector<Agent> & agents, std::shared_ptr<HeuristicTable> HT, 
-        std::shared_ptr<vector<float> > map_weights, std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos,
+        Instance & instance, const PathTable & global_path_table, std::vector<Agent> & agents, const PathStore & path_store,
+        std::shared_ptr<HeuristicTable> HT, std::shared_ptr<vector<float> > map_weights, std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos,
         string replan_algo_name, bool sipp,
         int window_size_for_CT, int window_size_for_CAT, int window_size_for_PATH, int execution_window,
+        int congestion_region_size,
         bool has_disable_agents,
         int screen,
         int random_seed
     );
 
-    // the global manager will push global changes to local optimizer though this function. 
-    void update(Neighbor & neighbor);
+    // the global manager will push global changes to local optimizer though this function. only the congestion
+    // index needs them, the paths are read from the global path table and path_store.
+    void update(const Neighbor & neighbor);
+    // replay the entries committed since the last sync. return false if it stops early because of timeout.
+    bool sync(const CommitLog & log, const TimeLimiter & time_limiter);
+    // the local part of GlobalManager::advance(), after the global agents got their new paths.
+    void advance();
     void optimize(Neighbor & neighbor, const TimeLimiter & time_limiter);
     void prepare(Neighbor & neighbor);
 
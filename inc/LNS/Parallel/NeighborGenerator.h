@@ -5,6 +5,7 @@
 #include "util/HeuristicTable.h"
 #include "LNS/PathTable.h"
 #include "LaCAM2/instance.hpp"
+#include "LNS/Parallel/CongestionIndex.h"
 
 namespace LNS {
 
@@ -16,9 +17,14 @@ public:
     Instance & instance;
     std::shared_ptr<HeuristicTable> HT;
     PathTable & path_table;
+    // only read for their ids, starts and goals: their current paths are in path_store.
     std::vector<Agent> & agents;
+    const PathStore & path_store;
+    // kept up to date with the paths by its owner. nullptr disables the congestion heuristic.
+    CongestionIndex * congestion_index;
 
-    std::mt19937 MT; 
+    // one per idx, seeded from random_seed, so that parallel generators draw neither from each other nor from rand().
+    std::vector<std::mt19937> MTs;
 
     std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos;
 
@@ -33,6 +39,9 @@ public:
     int num_threads;
 
     static const int n_orients=4; // east, south, west, north
+    static const int max_successors=4; // FW, CR, CCR, W
+    // the congestion heuristic takes agents from the sampled region and at most this many rings of regions around it.
+    static const int max_congestion_rings=2;
 
     bool fix_ng_bug;
 
@@ -44,15 +53,22 @@ public:
     // unordered_set<int> global_tabu_list;
     // for randomwalk strategy
     // unordered_set<int> tabu_list;
-    std::vector<unordered_set<int>> tabu_list_list; // for randomwalk strategy
+    std::vector<std::vector<int> > tabu_list_list; // for randomwalk strategy, sorted agent ids
     // for intersection strategy: this is read-only after first generation
-    list<int> intersections;
+    std::vector<int> intersections;
+    // the BFS of the intersection strategy, one per idx so that nothing is allocated once they have grown.
+    struct SearchBuffer {
+        std::vector<int> open;
+        std::vector<int> closed; // sorted
+    };
+    std::vector<SearchBuffer> search_buffers;
 
-    std::vector<std::shared_ptr<Neighbor>> neighbors; // the generated neighbors for usage
+    std::vector<Neighbor> neighbors; // the generated neighbors for usage, reused by every generate()
 
     NeighborGenerator(
         Instance & instance, std::shared_ptr<HeuristicTable> HT, PathTable & path_table, 
-        std::vector<Agent> & agents, std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos,
+        std::vector<Agent> & agents, const PathStore & path_store, std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos,
+        CongestionIndex * congestion_index,
         int neighbor_size, destroy_heuristic destroy_strategy, 
         bool ALNS, double decay_factor, double reaction_factor, 
         int num_threads, bool fix_ng_bug, int screen, int random_seed
@@ -61,24 +77,31 @@ public:
     // we will just make this part sequentially now, namely each time we only select one neighborhood
     // if we want to parallelize the optimization of multiple ones. just call this fuction more.
     void generate_parallel(const TimeLimiter & time_limiter);
-    Neighbor generate(const TimeLimiter & time_limiter,int idx);
+    // generate neighbors[idx] in place.
+    Neighbor & generate(const TimeLimiter & time_limiter,int idx);
     void update(Neighbor & neighbor);
 
-    void chooseDestroyHeuristicbyALNS();
+    void chooseDestroyHeuristicbyALNS(int idx);
     bool generateNeighborByRandomWalk(Neighbor & neighbor, int idx);
-    bool generateNeighborByIntersection(Neighbor & neighbor);
+    bool generateNeighborByIntersection(Neighbor & neighbor, int idx);
+    // agents passing through a region sampled in proportion to the delays of the paths through it.
+    bool generateNeighborByCongestion(Neighbor & neighbor, int idx);
 
     void reset();
 
 private:
-    int rouletteWheel();
+    int rouletteWheel(int idx);
+    void reset_destroy_weights();
+    // add the agents going through the cells of region to neighbors_set, starting from a random cell.
+    void get_region_agents(vector<int> & neighbors_set, int region, int idx);
 
     int findMostDelayedAgent(int idx);
     void randomWalk(
         int agent_id, int start_timestep, 
-        set<int>& conflicting_agents, int neighbor_size
+        vector<int>& conflicting_agents, int neighbor_size, int idx
     );
-    std::list<std::pair<int,int> > getSuccessors(int loc, int orient);
+    // write them into successors, which has room for max_successors, and return the number.
+    int getSuccessors(int loc, int orient, std::pair<int,int> * successors);
 
 };
 
@@ -0,0 +1,81 @@
+#pragma once
+#include "LNS/Parallel/TimeSpaceAStarState.h"
+#include "LNS/Instance.h"
+#include <utility>
+#include "LNS/ConstraintTable.h"
+#include "util/HeuristicTable.h"
+#include "LNS/Parallel/DataStructure.h"
+#include "util/TimeLimiter.h"
+
+namespace LNS {
+
+namespace Parallel {
+
+// Safe Interval Path Planning with rotations over the windowed PathTable, a drop-in for TimeSpaceAStarPlanner.
+// A state is (pos, orient, safe interval, arrived) at its earliest arrival time t, so a wait of any length is a
+// single successor instead of one state per timestep. Rotations stay in the same interval and take one step.
+// Rotating first and waiting later occupies the same cell as the other way round, so waits are only needed before
+// a move and at the end of the window. It returns the same paths as the time-space A*: either window_size_for_PATH+1
+// long or, if execution_window is 1, ending at the goal. Its costs match the time-space A* only when all weights are
+// the same, otherwise the arrival it keeps for a safe interval may not be the best one, so LNSSolver falls back to
+// the time-space A* on non-uniform weights.
+class SIPPPlanner {
+public:
+    Instance & instance;
+    std::shared_ptr<HeuristicTable> HT;
+    std::shared_ptr<vector<float> > weights;
+    int execution_window;
+
+    TimeSpaceAStarOpenList open_list;
+    TimeSpaceAStarStateTable all_states;
+    TimeSpaceAStarStatePool state_pool;
+
+    std::vector<TimeSpaceAStarState> successors;
+    std::vector<uint64_t> successor_keys;
+
+    int n_expanded;
+    int n_generated;
+
+    // results
+    Path path;
+
+    static const int n_dirs=5; // east, south, west, north, stay
+    static const int n_orients=4; // east, south, west, north
+    // the interval index in the key of the state waiting at the end of the window
+    static const int terminal_interval=1<<30;
+
+    SIPPPlanner(Instance & instance, std::shared_ptr<HeuristicTable> HT, std::shared_ptr<vector<float> > weights, int execution_window);
+    void findPath(int start_pos, int start_orient, int goal_pos, ConstraintTable & constraint_table, const TimeLimiter & time_limiter);
+    void clear();
+    void buildPath(TimeSpaceAStarState * curr);
+    void getSuccessors(TimeSpaceAStarState * curr, int goal_pos);
+
+private:
+    // [begin, end), end is MAX_TIMESTEP if it lasts beyond the window.
+    struct SafeInterval {
+        int begin;
+        int end;
+    };
+
+    // safe intervals are computed from the path table on demand and kept for the rest of a search.
+    const PathTable * path_table;
+    int horizon; // the last timestep with constraints
+    int window;
+    std::vector<SafeInterval> intervals;
+    std::vector<int> interval_offsets; // [loc]
+    std::vector<int> interval_counts; // [loc]
+    std::vector<unsigned int> interval_generations; // [loc]
+    unsigned int generation=0;
+
+    const SafeInterval * get_safe_intervals(int loc, int & n);
+
+    inline void add_successor(int pos, int orient, int t, float g, bool arrived, int interval, TimeSpaceAStarState * prev, int goal_pos) {
+        float h=arrived?0:HT->get(pos, orient, goal_pos);
+        successors.emplace_back(pos, orient, t, g, h, 0, arrived, prev);
+        successor_keys.push_back(TimeSpaceAStarState::make_key(pos, orient, interval, arrived));
+    }
+};
+
+}
+
+} // namespace LNS
@@ -0,0 +1,50 @@
+#pragma once
+#include "common.h"
+#include <fstream>
+#include <cstdint>
+
+namespace LNS {
+
+namespace Parallel {
+
+// what happened to the neighbor of an async LNS iteration. INVALID and NOT_CHEAPER are found by the recheck
+// against the global solution, REPLAN_NOT_CHEAPER and REPLAN_FAILED by the local optimizer before any commit.
+enum commit_result { ACCEPTED, INVALID, NOT_CHEAPER, DROPPED, REPLAN_NOT_CHEAPER, REPLAN_FAILED };
+
+struct TelemetryRecord {
+    int thread;
+    int iteration; // of the thread in this run
+    float elapse; // seconds since the run started
+    int neighbor_size;
+    int selected_neighbor; // the destroy heuristic, see Neighbor::selected_neighbor
+    int n_expanded; // by the single-agent planner over the whole neighbor
+    float replan_ms;
+    commit_result result;
+    float commit_wait_ms; // backing off after aborted commits and waiting for stats_mutex
+    float cost_delta; // 0 unless accepted
+};
+
+// Per-iteration statistics of the async LNS, written as CSV to get the data for tuning neighborSize,
+// LNS_NUM_THREADS and the window sizes on each map. Every thread appends to its own buffer, so recording takes
+// no lock, and the buffers are written out by flush() at the end of each run, i.e., once per plan call, with the
+// run numbered in the first column.
+class Telemetry {
+public:
+    Telemetry(const string & path, int num_threads);
+
+    inline void record(int thread, const TelemetryRecord & record) {
+        buffers[thread].push_back(record);
+    }
+
+    // write and clear the records of the current run. it must not be called while threads are still recording.
+    void flush();
+
+private:
+    std::ofstream out;
+    int run=0;
+    std::vector<std::vector<TelemetryRecord> > buffers; // [thread]
+};
+
+}
+
+} // namespace LNS
@@ -1,6 +1,5 @@
 #pragma once
 #include "LNS/Parallel/TimeSpaceAStarState.h"
-#include "boost/unordered_set.hpp"
 #include "LNS/Instance.h"
 #include <utility>
 #include "LNS/ConstraintTable.h"
@@ -19,10 +18,13 @@ public:
     std::shared_ptr<vector<float> > weights;
     int execution_window;
 
-    boost::heap::pairing_heap<TimeSpaceAStarState*, boost::heap::compare<TimeSpaceAStarState::Compare> > open_list;
-    boost::unordered_set<TimeSpaceAStarState*, TimeSpaceAStarState::Hash, TimeSpaceAStarState::Equal> all_states;
+    // all reused across calls of findPath, so a search allocates nothing once they have grown large enough.
+    TimeSpaceAStarOpenList open_list;
+    TimeSpaceAStarStateTable all_states;
+    TimeSpaceAStarStatePool state_pool;
 
-    std::vector<TimeSpaceAStarState*> successors;
+    // generated by getSuccessors(), only copied into the pool if they are new.
+    std::vector<TimeSpaceAStarState> successors;
 
     int n_expanded;
     int n_generated;
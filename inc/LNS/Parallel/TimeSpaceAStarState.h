@@ -1,7 +1,10 @@
 #pragma once
 #include <cstdlib>
 #include <utility>
-#include "boost/heap/pairing_heap.hpp"
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace LNS {
 
@@ -57,23 +60,231 @@ public:
         }
     };
     
-    struct Hash {
-        std::size_t operator()(const TimeSpaceAStarState *s) const {
-            // : we may replace the hash here!
-            size_t h = std::hash<int>()(s->t<<21+s->pos<<5+s->orient<<1+s->arrived);
-            return h;        
+    bool closed=false;
+    // the position in TimeSpaceAStarOpenList, -1 if not in it.
+    int heap_index=-1;
+
+    // a state is identified by (t, pos, orient, arrived). t is below the planning window and pos below the map size,
+    // so they never overlap in the packed key.
+    static inline uint64_t make_key(int pos, int orient, int t, bool arrived) {
+        return ((uint64_t)t<<32)|((uint64_t)pos<<3)|((uint64_t)orient<<1)|(uint64_t)arrived;
+    }
+
+    inline uint64_t key() const {
+        return make_key(pos,orient,t,arrived);
+    }
+
+};
+
+// States are allocated from blocks kept across searches, so reset() just rewinds instead of deleting every state.
+// Blocks never move, so pointers to states, e.g., prev, stay valid until the next reset().
+class TimeSpaceAStarStatePool {
+public:
+    static const size_t block_size=4096;
+
+    inline TimeSpaceAStarState * allocate() {
+        size_t block_idx=n_used/block_size;
+        if (block_idx==blocks.size()) {
+            blocks.emplace_back(new TimeSpaceAStarState[block_size]);
         }
-    };
-    
-    struct Equal {
-        bool operator()(const TimeSpaceAStarState *s1, const TimeSpaceAStarState *s2) const {
-            return s1->pos == s2->pos && s1->orient==s2->orient && s1->t==s2->t && s1->arrived==s2->arrived;
+        return &blocks[block_idx][n_used++%block_size];
+    }
+
+    inline void reset() {
+        n_used=0;
+    }
+
+private:
+    std::vector<std::unique_ptr<TimeSpaceAStarState[]> > blocks;
+    size_t n_used=0;
+};
+
+// An open-addressed hash table with linear probing from TimeSpaceAStarState::key() to the generated state.
+// Slots carry the generation they are written in, so reset() invalidates all of them by bumping the generation.
+class TimeSpaceAStarStateTable {
+public:
+    TimeSpaceAStarStateTable(size_t init_capacity=1024) {
+        size_t capacity=16;
+        while (capacity<init_capacity) {
+            capacity<<=1;
         }
+        slots.resize(capacity);
+        mask=capacity-1;
+    }
+
+    inline TimeSpaceAStarState * find(uint64_t key) const {
+        for (size_t i=hash(key);;i=(i+1)&mask) {
+            const Slot & slot=slots[i];
+            if (slot.generation!=generation) {
+                return nullptr;
+            }
+            if (slot.key==key) {
+                return slot.state;
+            }
+        }
+    }
+
+    // the state must not be in the table yet.
+    inline void insert(TimeSpaceAStarState * state) {
+        insert(state->key(),state);
+    }
+
+    // with a key of the caller, e.g., SIPP identifies states by safe intervals instead of timesteps.
+    inline void insert(uint64_t key, TimeSpaceAStarState * state) {
+        // keep the load factor below 1/2.
+        if ((size+1)*2>slots.size()) {
+            grow();
+        }
+        place(key,state);
+        ++size;
+    }
+
+    void reset() {
+        size=0;
+        ++generation;
+        if (generation==0) {
+            // wrapped around, slots of an old search could look current.
+            for (auto & slot: slots) {
+                slot.generation=0;
+            }
+            generation=1;
+        }
+    }
+
+    size_t size=0;
+
+private:
+    struct Slot {
+        uint64_t key=0;
+        TimeSpaceAStarState * state=nullptr;
+        unsigned int generation=0;
     };
 
-    bool closed=false;
-    boost::heap::pairing_heap<TimeSpaceAStarState*, boost::heap::compare<TimeSpaceAStarState::Compare>>::handle_type open_list_handle;
+    std::vector<Slot> slots;
+    size_t mask;
+    unsigned int generation=1;
+
+    inline size_t hash(uint64_t key) const {
+        // fibonacci hashing spreads the consecutive positions and timesteps of a search over the table.
+        key*=0x9E3779B97F4A7C15ull;
+        return (size_t)(key^(key>>32))&mask;
+    }
+
+    inline void place(uint64_t key, TimeSpaceAStarState * state) {
+        size_t i=hash(key);
+        while (slots[i].generation==generation) {
+            i=(i+1)&mask;
+        }
+        slots[i].key=key;
+        slots[i].state=state;
+        slots[i].generation=generation;
+    }
+
+    void grow() {
+        std::vector<Slot> old_slots(slots.size()*2);
+        old_slots.swap(slots);
+        mask=slots.size()-1;
+        for (auto & slot: old_slots) {
+            if (slot.generation==generation) {
+                place(slot.key,slot.state);
+            }
+        }
+    }
+};
+
+// An intrusive 4-ary min-heap ordered by TimeSpaceAStarState::Compare, states keep their heap_index for increase().
+// A wider heap is shallower than a binary one, which saves cache misses in pop() on large open lists.
+class TimeSpaceAStarOpenList {
+public:
+    static const int arity=4;
+
+    inline bool is_better(const TimeSpaceAStarState * s1, const TimeSpaceAStarState * s2) const {
+        return TimeSpaceAStarState::Compare()(s2,s1);
+    }
+
+    inline void push(TimeSpaceAStarState * s) {
+        s->heap_index=(int)heap.size();
+        heap.push_back(s);
+        move_up(s->heap_index);
+    }
+
+    inline TimeSpaceAStarState * top() const {
+        return heap[0];
+    }
+
+    inline TimeSpaceAStarState * pop() {
+        TimeSpaceAStarState * ret=heap[0];
+        ret->heap_index=-1;
+        TimeSpaceAStarState * last=heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap[0]=last;
+            last->heap_index=0;
+            move_down(0);
+        }
+        return ret;
+    }
 
+    // s has become better, e.g., its cost decreased.
+    inline void increase(TimeSpaceAStarState * s) {
+        move_up(s->heap_index);
+    }
+
+    inline bool empty() const {
+        return heap.empty();
+    }
+
+    inline size_t size() const {
+        return heap.size();
+    }
+
+    inline void clear() {
+        heap.clear();
+    }
+
+private:
+    std::vector<TimeSpaceAStarState *> heap;
+
+    inline void move_up(int idx) {
+        TimeSpaceAStarState * s=heap[idx];
+        while (idx>0) {
+            int parent_idx=(idx-1)/arity;
+            if (!is_better(s,heap[parent_idx])) {
+                break;
+            }
+            heap[idx]=heap[parent_idx];
+            heap[idx]->heap_index=idx;
+            idx=parent_idx;
+        }
+        heap[idx]=s;
+        s->heap_index=idx;
+    }
+
+    inline void move_down(int idx) {
+        TimeSpaceAStarState * s=heap[idx];
+        int size=(int)heap.size();
+        while (true) {
+            int first_child_idx=idx*arity+1;
+            if (first_child_idx>=size) {
+                break;
+            }
+            int best_child_idx=first_child_idx;
+            int last_child_idx=std::min(first_child_idx+arity,size);
+            for (int child_idx=first_child_idx+1;child_idx<last_child_idx;++child_idx) {
+                if (is_better(heap[child_idx],heap[best_child_idx])) {
+                    best_child_idx=child_idx;
+                }
+            }
+            if (!is_better(heap[best_child_idx],s)) {
+                break;
+            }
+            heap[idx]=heap[best_child_idx];
+            heap[idx]->heap_index=idx;
+            idx=best_child_idx;
+        }
+        heap[idx]=s;
+        s->heap_index=idx;
+    }
 };
 
 }
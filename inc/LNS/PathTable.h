@@ -1,31 +1,128 @@
 #pragma once
 #include "LNS/common.h"
 #include "LNS/Parallel/DataStructure.h"
+#include <random>
+#include <atomic>
 
 #define NO_AGENT -1
 
 namespace LNS {
 
+// The collision-free paths within a fixed window, as a flat (window_size+1) x map_size array of agent ids.
+// It is time-major, so the slice of a timestep is contiguous, and the slices form a ring starting at base_slice:
+// advance() shifts every path back in time by rotating base_slice instead of rebuilding the table.
+// In async LNS, commits write the cells of the global table while the local optimizers read them, so the cells are
+// atomics accessed with relaxed ordering, i.e., plain loads and stores on x86.
+//
+// A table constructed from a shared one is a view of it: it has no cells of its own and shows the shared table
+// without the paths of the hidden agents, plus the Parallel::Paths inserted into the view. A local optimizer
+// replans a neighbor in a view of the global table, so it needs no copy of the table.
 class PathTable
 {
 public:
     int makespan = 0;
     int window_size = -1;
-    vector< vector<int> > table; // this stores the collision-free paths, the value is the id of the agent
+    int map_size = 0;
+    int n_slices = 0; // window_size+1
+    int base_slice = 0; // the slice of timestep 0
+    vector<std::atomic<int> > table; // [slice][location]: the id of the agent, NO_AGENT if none
     vector<int> goals; // this stores the goal locatons of the paths: key is the location, while value is the timestep when the agent reaches the goal
-    void reset() { auto map_size = table.size(); table.clear(); table.resize(map_size); goals.assign(map_size, MAX_TIMESTEP); makespan = 0; }
+    vector<int> changed_from; // [k]: the first timestep where the new path of changed_agents[k] differs in the last advance()
+
+    // only set for a view.
+    const PathTable * shared = nullptr;
+    // the cells of the paths hidden in and inserted into the view, as a list per location. a neighbor has only a
+    // few agents, so the lists are short and most locations have none.
+    struct ViewCell {
+        int loc;
+        int t;
+        int agent;
+        bool local; // inserted, otherwise hidden
+        int next; // the next cell of the same location, -1 if none
+    };
+    vector<ViewCell> view_cells;
+    vector<int> view_heads; // [location]: the first cell, -1 if none
+
+    void reset();
+    // shift the table by steps timesteps: what is at timestep t moves to t-steps and the last steps timesteps become empty.
+    void advance(int steps);
     void insertPath(int agent_id, const Path& path, bool verbose=false);
     void deletePath(int agent_id, const Path& path, bool verbose=false);
     void insertPath(int agent_id, const Parallel::Path& path,bool verbose=false);
     void deletePath(int agent_id, const Parallel::Path& path,bool verbose=false);
+    // warm start across timesteps: drop the first steps timesteps of the agents' paths and rotate the table by
+    // steps. the paths of changed_agents, which must be sorted, are replaced with new_paths, and only their cells
+    // after the first timestep where a new path differs are rewritten. the other paths are extended with
+    // new_paths, which only hold the timesteps after them. so the cells touched are the dropped ones, the ones of
+    // changed_agents and the appended ones, no whole slice is cleared.
+    void advance(int steps, std::vector<Parallel::Agent> & agents, const std::vector<int> & changed_agents, const std::vector<Parallel::Path> & new_paths);
     bool constrained(int from, int to, int to_time) const;
-    bool constrained(int from, int to, int to_time, std::vector<int> & ignored_agents) const;
+    // ignored_agents must be sorted, e.g., Parallel::Neighbor::agents.
+    bool constrained(int from, int to, int to_time, const std::vector<int> & ignored_agents) const;
 
-    void get_agents(set<int>& conflicting_agents, int loc) const;
-    void get_agents(set<int>& conflicting_agents, int neighbor_size, int loc) const;
-    void getConflictingAgents(int agent_id, set<int>& conflicting_agents, int from, int to, int to_time) const;;
+    // conflicting_agents is a sorted vector of agent ids, see Parallel::insert_sorted().
+    void get_agents(vector<int>& conflicting_agents, int loc) const;
+    // the agents around a random timestep drawn from MT, so that a seeded generator gives the same agents.
+    void get_agents(vector<int>& conflicting_agents, int neighbor_size, int loc, std::mt19937 & MT) const;
+    void getConflictingAgents(int agent_id, vector<int>& conflicting_agents, int from, int to, int to_time) const;;
     int getHoldingTime(int location, int earliest_timestep) const;
-    explicit PathTable(int map_size = 0, int window_size=-1) : table(map_size), goals(map_size, MAX_TIMESTEP), window_size(window_size) {}
+    explicit PathTable(int map_size = 0, int window_size=-1);
+    // a view of shared within window_size, which must not be larger than the window of shared.
+    PathTable(const PathTable * shared, int window_size);
+
+    // hide agent_id, whose path in the shared table is path, in a view. if the shared path is replaced later, the
+    // cells of the new one are still shown.
+    void hide(int agent_id, const Parallel::Path & path);
+    // make a view show the shared table as it is again.
+    void clear_view();
+    // whether the table has no cells, i.e., it is default-constructed.
+    inline bool empty() const { return shared == nullptr && table.empty(); }
+
+    // the agent at location loc at timestep t, NO_AGENT if none or t is outside the window.
+    inline int get(int loc, int t) const {
+        if (t < 0 || t >= n_slices)
+            return NO_AGENT;
+        if (shared != nullptr)
+            return get_from_view(loc, t);
+        int slice = base_slice + t;
+        if (slice >= n_slices)
+            slice -= n_slices;
+        return table[(size_t)slice * map_size + loc].load(std::memory_order_relaxed);
+    }
+
+private:
+    inline std::atomic<int> & at(int loc, int t) {
+        int slice = base_slice + t;
+        if (slice >= n_slices)
+            slice -= n_slices;
+        return table[(size_t)slice * map_size + loc];
+    }
+    inline void set(int loc, int t, int agent_id) {
+        at(loc, t).store(agent_id, std::memory_order_relaxed);
+    }
+    inline int get_from_view(int loc, int t) const {
+        int slice = shared->base_slice + t;
+        if (slice >= shared->n_slices)
+            slice -= shared->n_slices;
+        int agent = shared->table[(size_t)slice * map_size + loc].load(std::memory_order_relaxed);
+        for (int i = view_heads[loc]; i >= 0; i = view_cells[i].next)
+        {
+            auto & cell = view_cells[i];
+            if (cell.t != t)
+                continue;
+            if (cell.local)
+                return cell.agent;
+            // hidden, but an inserted path may still be here.
+            if (cell.agent == agent)
+                agent = NO_AGENT;
+        }
+        return agent;
+    }
+    void add_view_cells(int agent_id, const Parallel::Path & path, bool local);
+    // the number of timesteps of a path kept in the table
+    inline int get_path_length(size_t path_size) const {
+        return (int)std::min(path_size, (size_t)n_slices);
+    }
 };
 
 class PathTableWC // with collisions
@@ -49,6 +49,10 @@ public:
     int num_task_completed=0;
     int max_task_completed;
 
+    // the search nodes of Planner::solve, one for each member of the portfolio, kept across plan() calls so their
+    // memory is reused.
+    std::vector<SearchArena> search_arenas;
+
     // Config next_config;
 
     // std::vector<std::vector<int>> action_costs;
@@ -3,6 +3,7 @@
  */
 #pragma once
 #include "LaCAM2/utils.hpp"
+#include <array>
 #include "SharedEnv.h"
 
 namespace LaCAM2 {
@@ -11,6 +12,8 @@ struct Vertex {
   const uint id;     // index for V in Graph
   const uint index;  // index for U, width * y + x, in Graph
   std::vector<Vertex*> neighbor;
+  // [k]: the orientation of the move to neighbor[k], 0:east, 1:south, 2:west, 3:north.
+  std::array<int, 4> neighbor_orients;
 
   Vertex(uint _id, uint _index);
 };
@@ -22,6 +25,8 @@ struct Config {
   std::vector<int> orients;
   std::vector<bool> arrivals;
 
+  Config() {}
+
   Config(int N) {
     locs.resize(N, nullptr);
     orients.resize(N, -1);
@@ -67,6 +72,8 @@ struct Graph {
   ~Graph();
 
   uint size() const;  // the number of vertices
+
+  void set_neighbor_orients();
 };
 
 bool is_same_config(
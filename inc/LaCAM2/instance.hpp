@@ -50,6 +50,8 @@ struct Instance {
     int planning_window=-1,
     std::vector<::Path> * precomputed_paths=nullptr
   );
+  // the same starts and goals with other agent infos.
+  Instance(const Instance & other, std::vector<AgentInfo> & agent_infos);
   ~Instance() {}
 
   void set_starts_and_goals(std::vector<::State> * starts, std::vector<::State> * goals);
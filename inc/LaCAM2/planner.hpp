@@ -9,6 +9,7 @@
 #include "LaCAM2/utils.hpp"
 #include "util/HeuristicTable.h"
 #include <memory>
+#include <atomic>
 #include "LaCAM2/executor.hpp"
 
 namespace LaCAM2 {
@@ -27,23 +28,76 @@ struct Agent {
 };
 using Agents = std::vector<Agent*>;
 
+// Nodes are allocated from blocks kept across searches, so reset() releases all of them at once by rewinding.
+// Blocks never move, so pointers to nodes, e.g., parents, stay valid until the next reset(). A recycled node keeps
+// the capacity of its vectors, so once the blocks are warm a search allocates nothing for its nodes.
+template <typename T>
+class NodePool {
+public:
+  static const size_t block_size=1024;
+
+  inline T* allocate() {
+    size_t block_idx=n_used/block_size;
+    if (block_idx==blocks.size()) {
+      blocks.emplace_back(new T[block_size]);
+    }
+    return &blocks[block_idx][n_used++%block_size];
+  }
+
+  inline void reset() { n_used=0; }
+  inline size_t size() const { return n_used; }
+
+private:
+  std::vector<std::unique_ptr<T[]> > blocks;
+  size_t n_used=0;
+};
+
 // low-level node
+// the constraints are the chain of parents: each node only adds who moves to where.
 struct LNode {
-  std::vector<uint> who;
-  std::vector<std::tuple<Vertex*,int > > where; // vertex and orientation
-  const uint depth;
-  LNode(LNode* parent, uint i, const std::tuple<Vertex*,int > & t);  // who and where
-  LNode(): who(), where(), depth(0) {}
+  LNode* parent;
+  uint who;
+  Vertex* where;
+  int orient;
+  uint depth;
+  void init(LNode* parent, uint i, const std::tuple<Vertex*,int > & t);
+  void init() { parent=nullptr; who=0; where=nullptr; orient=-1; depth=0; }
+};
+
+// a FIFO queue of low-level nodes that keeps its memory when cleared.
+struct LNodeQueue {
+  std::vector<LNode*> nodes;
+  size_t head=0;
+  inline bool empty() const { return head==nodes.size(); }
+  inline LNode* front() const { return nodes[head]; }
+  inline void pop() { ++head; }
+  inline void push(LNode* L) { nodes.push_back(L); }
+  inline void clear() { nodes.clear(); head=0; }
+};
+
+struct SearchArena;
+
+// the key of an agent in HNode::order, packed so that smaller keys come first. see HNode::init for the fields.
+struct AgentPriority {
+  uint64_t key1;
+  uint64_t key2;
+  uint id;  // breaks the remaining ties, so the order doesn't depend on how it is sorted.
+
+  inline bool operator<(const AgentPriority& other) const {
+    if (key1 != other.key1) return key1 < other.key1;
+    if (key2 != other.key2) return key2 < other.key2;
+    return id < other.id;
+  }
 };
 
 // high-level node
 struct HNode {
-  static uint HNODE_CNT;  // count #(high-level node)
-  const Config C;
+  static std::atomic<uint> HNODE_CNT;  // count #(high-level node)
+  Config C;
 
   // tree
   HNode* parent;
-  std::set<HNode*> neighbor;
+  std::vector<HNode*> neighbor;
 
   uint d;        // depth (might be updated, it might be different from g)
 
@@ -53,18 +107,31 @@ struct HNode {
   float f;        // g + h (might be updated)
 
   // for low-level search
-  std::vector<float> priorities;
   std::vector<uint> order;
-  std::queue<LNode*> search_tree;
+  std::vector<AgentPriority> priorities; // the keys of order
+  LNodeQueue search_tree;
   
   int order_strategy;
 
-  HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Instance * ins, HNode* _parent, float _g,
-        float _h, const uint _d, int order_strategy, bool disable_agent_goals);
-  ~HNode();
+  // HNodes are recycled by SearchArena, so they are set up by init() instead of a constructor.
+  // a child's order is derived from its parent's: only the agents whose keys may have changed, i.e., that moved,
+  // rotated, arrived or ran out of precomputed path, are re-keyed, sorted and merged into the rest.
+  void init(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Instance * ins, HNode* _parent, float _g,
+        float _h, const uint _d, int order_strategy, bool disable_agent_goals, SearchArena & arena);
 };
 using HNodes = std::vector<HNode*>;
 
+// the nodes of Planner::solve, released at the end of each solve. it can be kept by the caller across solves.
+struct SearchArena {
+  NodePool<HNode> hnodes;
+  NodePool<LNode> lnodes;
+
+  inline void reset() {
+    hnodes.reset();
+    lnodes.reset();
+  }
+};
+
 struct Planner {
   Instance* ins;
   const Deadline* deadline;
@@ -88,13 +155,27 @@ struct Planner {
 
   // used in PIBT
   std::vector<std::array<Vertex*, 5> > C_next;  // next locations, used in PIBT
-  std::vector<float> tie_breakers;              // random values, used in PIBT
   Agents A;
   Agents occupied_now;                          // for quick collision checking
   Agents occupied_next;                         // for quick collision checking
 
   bool disable_agent_goals;
 
+  // owned by the caller, or by own_arena if none is given.
+  SearchArena* arena;
+  std::unique_ptr<SearchArena> own_arena;
+
+  // the search gives up like on an expired deadline once it is set, e.g., by another planner of a portfolio.
+  const std::atomic<bool>* stop_flag;
+
+  // tiled PIBT, off if pibt_tile_size <= 0. the grid is cut into square tiles. agents at vertices next to another
+  // tile are planned first by a sequential pass, then the other agents of each tile are planned in parallel, which
+  // only touches the vertices of their own tile.
+  int pibt_tile_size;
+  int n_tiles;
+  std::vector<int> vertex_tiles;  // [vertex id]: the tile, -1 if next to another tile
+  std::vector<std::vector<Agent*> > tile_agents;  // [tile]: in the order of the high-level node
+
   float get_cost_move(int pst,int ped);
 
   Planner(Instance* _ins, const std::shared_ptr<HeuristicTable> & HT, const std::shared_ptr<std::vector<float> > & map_weights, const Deadline* _deadline, std::mt19937* _MT,
@@ -105,7 +186,10 @@ struct Planner {
           bool use_swap=false,
           bool use_orient_in_heuristic=false,
           bool use_external_executor=false,
-          bool disable_agent_goals=true);
+          bool disable_agent_goals=true,
+          SearchArena* arena=nullptr,
+          const std::atomic<bool>* stop_flag=nullptr,
+          int pibt_tile_size=0);
   ~Planner();
 
   Executor executor;
@@ -121,7 +205,9 @@ struct Planner {
   float get_edge_cost(HNode* H_from, HNode* H_to);
   float get_h_value(const Config& C);
   bool get_new_config(HNode* H, LNode* L);
-  bool funcPIBT(Agent* ai, HNode * H);
+  // in_tile: planning concurrently inside a tile, so MT is not touched.
+  bool funcPIBT(Agent* ai, HNode * H, bool in_tile=false);
+  bool tiled_PIBT(HNode* H);
 
   // swap operation
   Agent* swap_possible_and_required(Agent* ai);
@@ -18,6 +18,7 @@
 #include "RHCR/interface/CompetitionGraph.h"
 #include "common.h"
 #include <memory>
+#include <future>
 #include "LaCAM2/LaCAM2Solver.hpp"
 #include "LNS/LNSSolver.h"
 
@@ -56,6 +57,18 @@ public:
     void load_configs();
     std::string load_map_weights(string weights_path);
 
+    // the heuristics of LaCAM2 and LNS
+    std::shared_ptr<HeuristicTable> heuristics;
+    std::future<std::shared_ptr<HeuristicTable> > heuristics_repair;
+    // change map weights online. the heuristics are repaired in the background, and the solvers keep using the
+    // old ones until the repair is swapped in at the start of a later plan(). call it between plan() calls.
+    void update_map_weights(const std::vector<WeightDelta> & deltas);
+    // the online weight updates of the file at config "map_weight_updates_path", sorted by timestep. plan() passes
+    // the ones due at the current timestep to update_map_weights().
+    std::vector<std::pair<int,std::vector<WeightDelta> > > weight_updates;
+    size_t next_weight_update=0;
+    void load_weight_updates(string updates_path);
+
     RHCR::MAPFSolver* rhcr_build_mapf_solver(nlohmann::json & config, RHCR::CompetitionGraph & graph);
     void rhcr_config_solver(std::shared_ptr<RHCR::RHCRSolver> & solver,nlohmann::json & config);
 
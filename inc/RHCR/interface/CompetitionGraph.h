@@ -11,19 +11,7 @@ public:
     CompetitionGraph(const SharedEnvironment & env);
     // a dummy function.
     bool load_map(string fname);
-    // preprocessing the map, e.g., computing heuristics for later planning.
-    void preprocessing(bool consider_rotation,const string & file_storage_path);
-    // NOTE: in this competition, we only need to deal with grid-like graphs, so we just use BFS to compute shortest paths to all other locations. 
-    void compute_heuristics(
-        int root_location, 
-        double * lengths, 
-        bool * visited,
-        State * queue,
-        vector<double> & result,
-        const int n_directions       
-    );
-
-    void save_heuristics_table(std::string fname);
-    bool load_heuristics_table(std::ifstream& myfile);
+    // preprocessing the map, e.g., attaching the heuristics shared with the other solvers.
+    void preprocessing(const std::shared_ptr<HeuristicTable> & heuristic_table);
 };
 }
\ No newline at end of file
@@ -1,15 +1,39 @@
 #pragma once
 #include "common.h"
 #include "States.h"
+#include "util/HeuristicTable.h"
 
 #define WEIGHT_MAX INT_MAX/2
 
 namespace RHCR {
+
+// a read-only view of the HeuristicTable built by MAPFPlanner, so RHCR keeps no table of its own. the table has
+// unit weights because RHCR plans with unit costs.
+// heuristics.at(goal)[loc] is the cost from loc in its best orientation to goal, DBL_MAX if unreachable.
+class HeuristicsView {
+public:
+    struct Row {
+        HeuristicTable * table;
+        int goal;
+
+        inline double operator[](int loc) const {
+            float h=table->get(loc,goal);
+            return h>=MAX_HEURISTIC?DBL_MAX:(double)h;
+        }
+    };
+
+    std::shared_ptr<HeuristicTable> table;
+
+    inline Row at(int goal) const {
+        return Row{table.get(),goal};
+    }
+};
+
 class BasicGraph
 {
 public:
     vector<std::string> types;
-    unordered_map<int, vector<double>> heuristics;
+    HeuristicsView heuristics;
     virtual ~BasicGraph()= default;
     string map_name;
 	virtual bool load_map(string fname) = 0;
@@ -31,10 +55,6 @@ public:
     void copy(const BasicGraph& copy);
     int get_direction(int from, int to) const;
 
-	vector<double> compute_heuristics(int root_location); // compute distances from all lacations to the root location
-	bool load_heuristics_table(std::ifstream& myfile);
-	void save_heuristics_table(string fname);
-
     int rows;
     int cols;
     vector<vector<double> > weights; // (directed) weighted 4-neighbor grid
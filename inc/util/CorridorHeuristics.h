@@ -0,0 +1,82 @@
+#pragma once
+#include "SharedEnv.h"
+#include <vector>
+#include <cstdint>
+
+// Exact heuristics over a map contracted at its corridors.
+// A corridor cell is a free cell with exactly two free neighbors, a maximal chain of them is a corridor and
+// all other free cells are junctions. Any path leaving a corridor first steps onto the junction at one of its
+// two ends, and any path reaching a corridor cell last enters it from one of its ends. So distances are
+// all-pairs over junction states only, plus small per-corridor tables, and get() combines them.
+// All indices are location indices of HeuristicTable, i.e., into empty_locs.
+class CorridorHeuristics {
+public:
+    struct Corridor {
+        // cells from the end at side 0 to the end at side 1
+        int cell_offset;
+        int length;
+        // the end cell and the direction of the step out of the corridor at each side
+        int end_poses[2];
+        int exit_dirs[2];
+        // junction states, i.e., junction_idx*n_orientations+orient.
+        // an exit state is reached by stepping out of the corridor, an entry state steps into it.
+        int exit_states[2];
+        int entry_states[2];
+        // the columns of entry states in junction_dists
+        int entry_columns[2];
+        // the cost of the step from an entry state into the corridor
+        float entry_move_costs[2];
+        size_t exit_cost_offset;
+        size_t enter_cost_offset;
+        size_t inner_offset;
+    };
+
+    const SharedEnvironment & env;
+    const std::vector<float> & weights;
+    int n_orientations;
+    const int * empty_locs;
+    const int * loc_idxs;
+    size_t loc_size;
+
+    // [loc_size], -1 if not a junction
+    std::vector<int> junction_idxs;
+    // [n_junctions], the location index of a junction
+    std::vector<int> junction_locs;
+    // [loc_size], -1 if not a corridor cell
+    std::vector<int> corridor_ids;
+    std::vector<int> corridor_poses;
+    std::vector<Corridor> corridors;
+    // [sum of corridor lengths], location indices of corridor cells
+    std::vector<int> corridor_cells;
+
+    // [corridor state][side]: the cost to an exit state without leaving the corridor before.
+    std::vector<float> exit_costs;
+    // [side][cell]: the cost from an entry state to a cell without leaving the corridor after entering.
+    std::vector<float> enter_costs;
+    // [corridor state][cell]: the cost between cells of the same corridor without leaving it.
+    std::vector<float> inner_costs;
+    // [junction state][column]: the columns are junctions in any orientation, followed by the entry states
+    // of corridors if they are not junctions already.
+    std::vector<float> junction_dists;
+    size_t n_junction_states=0;
+    size_t n_junction_columns=0;
+
+    CorridorHeuristics(const SharedEnvironment & env, const std::vector<float> & weights, int n_orientations,
+        const int * empty_locs, const int * loc_idxs, size_t loc_size);
+
+    void compute();
+
+    // the same as the dense table: from (loc_idx1, orient1) to loc_idx2 in any orientation.
+    float get(int loc_idx1, int orient1, int loc_idx2) const;
+    // the minimum over start orientations.
+    float get(int loc_idx1, int loc_idx2) const;
+
+    size_t memory_bytes() const;
+
+private:
+    // the free neighbor of loc in direction dir (0 east, 1 south, 2 west, 3 north), or -1.
+    int get_neighbor(int loc, int dir) const;
+    void classify_cells();
+    void compute_corridor_costs(int corridor_id);
+    void compute_junction_dists();
+};
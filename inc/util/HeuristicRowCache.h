@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// a goal-centric heuristic row: the cost from every (loc_idx, orient) to goal_loc.
+struct HeuristicRow {
+    int goal_loc;
+    // [loc_size*n_orientations]
+    std::vector<float> values;
+
+    HeuristicRow(int goal_loc, size_t size, float init_value): goal_loc(goal_loc), values(size, init_value) {};
+};
+
+// A bounded LRU cache of heuristic rows keyed by goal, safe to use from multiple threads.
+// It is split into shards by goal so that threads querying different goals rarely wait on the same lock.
+// Rows are handed out as shared_ptr, so a row evicted while someone still reads it stays valid.
+class HeuristicRowCache {
+public:
+    using RowPtr=std::shared_ptr<const HeuristicRow>;
+
+    HeuristicRowCache(size_t capacity, size_t n_shards=16): capacity(capacity) {
+        if (n_shards>capacity) {
+            n_shards=capacity>0?capacity:1;
+        }
+        for (size_t i=0;i<n_shards;++i) {
+            shards.emplace_back(new Shard());
+            // spread the capacity over shards, the first ones take the remainder.
+            shards.back()->capacity=capacity/n_shards+(i<capacity%n_shards?1:0);
+        }
+    }
+
+    // return nullptr if the row of goal_loc is not cached. callers that keep their own hits and misses pass count=false.
+    RowPtr find(int goal_loc, bool count=true) {
+        Shard & shard=get_shard(goal_loc);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto iter=shard.index.find(goal_loc);
+        if (iter==shard.index.end()) {
+            if (count) ++n_misses;
+            return nullptr;
+        }
+        // move to the front as the most recently used
+        shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+        if (count) ++n_hits;
+        return *(iter->second);
+    }
+
+    // insert a row and return the cached one. if another thread has inserted the same goal in the meantime,
+    // its row is kept and returned instead.
+    RowPtr insert(const RowPtr & row) {
+        Shard & shard=get_shard(row->goal_loc);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto iter=shard.index.find(row->goal_loc);
+        if (iter!=shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+            return *(iter->second);
+        }
+
+        shard.lru.push_front(row);
+        shard.index[row->goal_loc]=shard.lru.begin();
+        while (shard.lru.size()>shard.capacity) {
+            shard.index.erase(shard.lru.back()->goal_loc);
+            shard.lru.pop_back();
+            ++n_evictions;
+        }
+        return row;
+    }
+
+    size_t size() {
+        size_t n=0;
+        for (auto & shard: shards) {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            n+=shard->lru.size();
+        }
+        return n;
+    }
+
+    void clear() {
+        for (auto & shard: shards) {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            shard->lru.clear();
+            shard->index.clear();
+        }
+    }
+
+    size_t capacity;
+    std::atomic<size_t> n_hits{0};
+    std::atomic<size_t> n_misses{0};
+    std::atomic<size_t> n_evictions{0};
+
+private:
+    struct Shard {
+        std::mutex mtx;
+        size_t capacity;
+        // front is the most recently used
+        std::list<RowPtr> lru;
+        std::unordered_map<int, std::list<RowPtr>::iterator> index;
+    };
+
+    std::vector<std::unique_ptr<Shard> > shards;
+
+    inline Shard & get_shard(int goal_loc) {
+        return *shards[(size_t)goal_loc%shards.size()];
+    }
+};
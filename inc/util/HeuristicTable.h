@@ -13,11 +13,37 @@
 #include "util/MyLogger.h"
 #include "boost/format.hpp"
 #include "util/SearchForHeuristics/SpatialSearch.h"
+#include "util/SearchForHeuristics/MultiSourceSearch.h"
+#include "util/HeuristicRowCache.h"
+#include "util/CorridorHeuristics.h"
+#include "nlohmann/json.hpp"
+#include <mutex>
+#include <cstdint>
 // #include "bshoshany/BS_thread_pool.hpp"
 
 
 #define MAX_HEURISTIC FLT_MAX/16
 
+// how the heuristic values are stored.
+// DENSE: all-pairs rows are computed (or loaded) in preprocess().
+// LAZY: the row of a goal is computed by a backward search the first time it is queried, 
+//       and kept in a bounded LRU cache. memory scales with the number of active goals.
+// QUANTIZED: like DENSE, but distances are stored as uint16 fixed-point values and the orientation deltas
+//       are packed into 2 or 4 bits each. values are rounded down, so the heuristic stays admissible.
+// CORRIDOR: corridors of degree-2 cells are contracted, all-pairs are computed over the remaining junctions only,
+//       and queries involving corridor cells are answered from per-corridor tables. values are the same as DENSE.
+// LANDMARK: lower bounds from the distances to and from a few landmarks (ALT), for maps too large for all-pairs.
+//       goals queried often get an exact row from a backward search, kept in a bounded LRU cache.
+enum class HeuristicMode { DENSE, LAZY, QUANTIZED, CORRIDOR, LANDMARK };
+
+HeuristicMode parse_heuristic_mode(const string & name);
+
+// a new value of map_weights[weight_idx], where weight_idx is loc*5+dir as in the weight files.
+struct WeightDelta {
+    int weight_idx;
+    float weight;
+};
+
 class HeuristicTable {
 public:
 
@@ -36,17 +62,33 @@ public:
 
     std::shared_ptr<std::vector<float> > map_weights;
 
-    HeuristicTable(SharedEnvironment * _env, const std::shared_ptr<std::vector<float> > & map_weights, bool consider_rotation=true);
+    HeuristicMode mode=HeuristicMode::DENSE;
+    // kept to build repaired tables with the same settings.
+    nlohmann::json config;
+
+    // config is the "heuristics" entry of the map config, e.g. {"mode": "lazy", "lazy_cache_size_mb": 4096}
+    HeuristicTable(SharedEnvironment * _env, const std::shared_ptr<std::vector<float> > & map_weights, bool consider_rotation=true, nlohmann::json config=nlohmann::json::object());
     ~HeuristicTable();
 
     // weights is an array of [loc_size*n_orientations]
     void compute_weighted_heuristics();
 
+    // compute the rows of start_loc_idxs into allocated tables.
+    void compute_rows(const std::vector<int> & start_loc_idxs);
+    void _compute_weighted_heuristics_per_source(const std::vector<int> & start_loc_idxs, int n_threads);
+    void _compute_weighted_heuristics_batched(const std::vector<int> & start_loc_idxs, int n_threads, int max_weight);
+
+    // compute the row of start_loc_idx into main_row [loc_size] and sub_row [loc_size*n_orientations].
     void _compute_weighted_heuristics(
         int start_loc_idx,
         float * values,
-        UTIL::SPATIAL::SpatialAStar * planner
+        UTIL::SPATIAL::SpatialAStar * planner,
+        float * main_row,
+        float * sub_row
     );
+    // fill main_row and sub_row from values [n_orientations][loc_size*n_orientations], the costs from each
+    // start orientation, unreachable ones are MAX_HEURISTIC.
+    void _fill_weighted_heuristics(const float * values, float * main_row, float * sub_row);
 
     void dump_main_heuristics(int start_loc, string file_path_prefix);
 
@@ -70,6 +112,99 @@ public:
 
     // void preprocess();
     void preprocess(string suffix="");
+    // "gz": the compressed stream of save() and load().
+    // "mmap": an uncompressed, versioned file that is saved once and then mapped read-only by save_mmap() and load_mmap().
+    // "chunked": blocks of chunk_rows start locations compressed independently by save_chunked() and load_chunked().
+    string file_format="gz";
+    int chunk_rows=64;
     void save(const string & fpath);
     void load(const string & fpath);
+    bool save_mmap(const string & fpath);
+    // return false if the file doesn't match this table, e.g., written for other map weights.
+    bool load_mmap(const string & fpath);
+    bool save_chunked(const string & fpath);
+    // load only the blocks holding start_loc_idxs if it is given, the other rows stay unreachable.
+    // return false if the file doesn't match this table.
+    bool load_chunked(const string & fpath, const std::vector<int> * start_loc_idxs=nullptr);
+
+    // the tables point into this mapping if they are loaded by load_mmap().
+    void * mmap_addr=nullptr;
+    size_t mmap_size=0;
+
+    // online weight changes. repair() returns a table for the weights with deltas applied, and only reads this
+    // table, so planners can keep querying it meanwhile, e.g., while repair() runs in another thread.
+    // DENSE: only the rows that the deltas can change are searched again, the others are copied.
+    // QUANTIZED and LANDMARK: computed again, as quantization and landmarks depend on all weights.
+    // LAZY and CORRIDOR: nothing is computed in advance, cached rows are dropped or tables rebuilt in swap_in().
+    std::shared_ptr<HeuristicTable> repair(const std::vector<WeightDelta> & deltas);
+    // take over the weights and tables of a table returned by repair(). no one may query this table meanwhile.
+    void swap_in(HeuristicTable & repaired);
+    // the start locations whose rows may change with deltas, judged by the old costs.
+    std::vector<int> get_affected_rows(const std::vector<WeightDelta> & deltas) const;
+
+    void allocate_tables();
+    void release_tables();
+    size_t main_table_bytes() const;
+    size_t sub_table_bytes() const;
+
+    // lazy mode
+    std::unique_ptr<HeuristicRowCache> row_cache;
+    // used to tell apart tables in the per-thread last-row memo.
+    size_t table_id;
+    std::mutex planner_pool_mtx;
+    std::vector<UTIL::SPATIAL::SpatialAStar *> planner_pool;
+
+    const HeuristicRow & get_lazy_row(int goal_loc);
+    HeuristicRowCache::RowPtr compute_goal_row(int goal_loc);
+    void print_lazy_stats();
+
+    // corridor mode
+    std::unique_ptr<CorridorHeuristics> corridor_heuristics;
+
+    // landmark mode, the exact rows of hot goals use the row cache of lazy mode.
+    int n_landmarks=16;
+    std::vector<int> landmark_locs;
+    // [state][landmark]: the cost from a state to a landmark and from a landmark (in its first orientation) to a state.
+    std::vector<float> landmark_to;
+    std::vector<float> landmark_from;
+    // [loc_idx][landmark]: the max of landmark_to and the min of landmark_from over orientations, for goals.
+    std::vector<float> landmark_to_goal;
+    std::vector<float> landmark_from_goal;
+    // a goal becomes hot and gets an exact row after this many queries that are answered by landmarks.
+    uint32_t hot_goal_queries=20;
+    std::unique_ptr<std::atomic<uint32_t>[]> goal_query_counts;
+    std::unique_ptr<std::atomic<bool>[]> hot_goals;
+
+    void compute_landmarks();
+    // orient1==-1 means the minimum over start orientations.
+    float get_landmark_bound(int loc_idx1, int orient1, int loc_idx2) const;
+    // return nullptr if the goal is not hot, the query is then counted as a miss of the cache.
+    const HeuristicRow * get_hot_goal_row(int goal_loc);
+
+    // quantized mode
+    static constexpr uint16_t QUANT_UNREACHABLE=UINT16_MAX;
+    // main value = q*quant_unit, where quant_unit is a power of two.
+    float quant_unit=1;
+    // sub value = dq*delta_units[loc_idx1]. a delta is at most two rotations at loc1,
+    // so it is measured in fractions of the rotation weight of loc1.
+    float * delta_units=nullptr;
+    // bits per orientation delta, 2 or 4
+    int sub_bits=2;
+    // bytes per (loc1,loc2) pair in sub_heuristics_q
+    int sub_bytes=1;
+    // number of distances clamped to the largest representable value
+    size_t n_saturated=0;
+    // loc1, loc2
+    uint16_t * main_heuristics_q=nullptr;
+    // loc1, loc2, then n_orientations deltas of sub_bits each
+    uint8_t * sub_heuristics_q=nullptr;
+
+    void init_quantization(int _sub_bits);
+    void store_quantized_row(int start_loc_idx, const float * main_row, const float * sub_row);
+
+    inline float get_quantized_delta(int loc_idx1, size_t pair_idx, int orient) const {
+        int offset=orient*sub_bits;
+        int dq=(sub_heuristics_q[pair_idx*sub_bytes+(offset>>3)]>>(offset&7))&((1<<sub_bits)-1);
+        return (float)dq*delta_units[loc_idx1];
+    }
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "util/SearchForHeuristics/SpatialState.h"
 #include <iostream>
 #include <random>
+#include <vector>
 
 namespace UTIL {
 namespace SPATIAL {
@@ -119,5 +120,54 @@ public:
 
 };
 
+
+// A circular bucket queue (Dial's algorithm) for Dijkstra with small non-negative integer weights.
+// An edge never spans more than max_weight buckets, so max_weight+1 buckets indexed by cost modulo the size
+// are enough. It has no decrease-key: an improved state is pushed again and the stale entry is skipped by the
+// caller when its cost doesn't match the bucket it is popped from.
+class BucketQueue {
+public:
+    std::vector<std::vector<State *> > buckets;
+    int n_buckets;
+    int curr_cost;
+    int size;
+
+    BucketQueue(int max_weight): n_buckets(max_weight+1), curr_cost(0), size(0) {
+        buckets.resize(n_buckets);
+    };
+
+    void push(State * s, int cost) {
+        buckets[cost%n_buckets].push_back(s);
+        ++size;
+    }
+
+    // return the next state with the smallest cost and set curr_cost to it.
+    State * pop() {
+        while (buckets[curr_cost%n_buckets].empty()) {
+            ++curr_cost;
+        }
+        auto & bucket=buckets[curr_cost%n_buckets];
+        State * ret=bucket.back();
+        bucket.pop_back();
+        --size;
+        return ret;
+    }
+
+    inline bool empty() {
+        return size==0;
+    }
+
+    void clear() {
+        if (size>0) {
+            for (auto & bucket: buckets) {
+                bucket.clear();
+            }
+        }
+        size=0;
+        curr_cost=0;
+    }
+
+};
+
 }
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+#include "SharedEnv.h"
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace UTIL {
+
+namespace SPATIAL {
+
+// Dijkstra from up to 64 sources at once for small integer weights, one bit lane per source.
+// For every state and cost bucket there is a mask of the sources whose search reaches the state at that cost,
+// so relaxing an edge for all the sources is a single and/or on 64-bit words instead of 64 heap operations.
+// A state is settled for a source the first time its bit shows up, because buckets are processed in cost order.
+// States are indexed by loc_idx*n_orients+orient, the same as the rows of HeuristicTable.
+class MultiSourceDial {
+public:
+    using Mask=uint64_t;
+    static const int n_lanes=64;
+    // the masks take (max_weight+1)*n_states words, so larger weights use the per-source search instead.
+    static const int max_batch_weight=16;
+
+    MultiSourceDial(
+        const SharedEnvironment & env, int n_orients, const std::vector<float> & weights, int max_weight,
+        const int * empty_locs, const int * loc_idxs, size_t loc_size
+    ): n_orients(n_orients), n_buckets(max_weight+1) {
+        n_states=loc_size*n_orients;
+
+        // successors of each state in CSR, the same actions as SpatialAStar::get_successors() except W,
+        // which is a self-loop and never improves a cost.
+        const int n_dirs=5;
+        const int offsets[4]={1,env.cols,-1,-env.cols};
+        succ_offsets.resize(n_states+1);
+        succ_offsets[0]=0;
+        for (size_t loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            int pos=empty_locs[loc_idx];
+            int x=pos%env.cols;
+            int y=pos/env.cols;
+            bool inside[4]={x+1<env.cols,y+1<env.rows,x-1>=0,y-1>=0};
+            for (int orient=0;orient<n_orients;++orient) {
+                for (int dir=0;dir<4;++dir) {
+                    if (n_orients>1 && dir!=orient) {
+                        continue;
+                    }
+                    if (!inside[dir] || env.map[pos+offsets[dir]]!=0) {
+                        continue;
+                    }
+                    int next_loc_idx=loc_idxs[pos+offsets[dir]];
+                    succ_states.push_back(next_loc_idx*n_orients+(n_orients>1?orient:0));
+                    succ_weights.push_back((int)weights[pos*n_dirs+dir]);
+                }
+                if (n_orients>1) {
+                    int weight=(int)weights[pos*n_dirs+4];
+                    succ_states.push_back((int)loc_idx*n_orients+(orient+1)%n_orients);
+                    succ_weights.push_back(weight);
+                    succ_states.push_back((int)loc_idx*n_orients+(orient-1+n_orients)%n_orients);
+                    succ_weights.push_back(weight);
+                }
+                succ_offsets[loc_idx*n_orients+orient+1]=(int)succ_states.size();
+            }
+        }
+
+        settled.resize(n_states);
+        pending.resize(n_buckets*n_states,0);
+        bucket_states.resize(n_buckets);
+    };
+
+    // search from sources, which are state indices. dists[lane*n_states+state] is set to the cost from
+    // sources[lane], states that are unreachable are left untouched.
+    void search(const int * sources, int n_sources, float * dists) {
+        std::fill(settled.begin(),settled.end(),0);
+        size_t n_pending=0;
+        for (int lane=0;lane<n_sources;++lane) {
+            n_pending+=add(sources[lane],0,(Mask)1<<lane);
+        }
+
+        for (int cost=0;n_pending>0;++cost) {
+            int bucket=cost%n_buckets;
+            auto & states=bucket_states[bucket];
+            Mask * masks=pending.data()+(size_t)bucket*n_states;
+            // zero-weight edges append to the bucket being processed.
+            for (size_t i=0;i<states.size();++i) {
+                int state=states[i];
+                Mask mask=masks[state]&~settled[state];
+                masks[state]=0;
+                if (mask==0) {
+                    continue;
+                }
+                settled[state]|=mask;
+
+                for (Mask m=mask;m!=0;m&=m-1) {
+                    dists[(size_t)__builtin_ctzll(m)*n_states+state]=(float)cost;
+                }
+
+                for (int j=succ_offsets[state];j<succ_offsets[state+1];++j) {
+                    int next_state=succ_states[j];
+                    Mask next_mask=mask&~settled[next_state];
+                    if (next_mask!=0) {
+                        n_pending+=add(next_state,cost+succ_weights[j],next_mask);
+                    }
+                }
+            }
+            n_pending-=states.size();
+            states.clear();
+        }
+    }
+
+    int n_orients;
+    int n_buckets;
+    size_t n_states;
+
+private:
+    std::vector<int> succ_offsets;
+    std::vector<int> succ_states;
+    std::vector<int> succ_weights;
+    // [state]: the sources that have settled the state
+    std::vector<Mask> settled;
+    // [bucket][state]: the sources that reach the state at a cost in the bucket
+    std::vector<Mask> pending;
+    // [bucket]: the states with a non-zero pending mask
+    std::vector<std::vector<int> > bucket_states;
+
+    // return the number of states added to the bucket.
+    inline size_t add(int state, int cost, Mask mask) {
+        int bucket=cost%n_buckets;
+        Mask & pending_mask=pending[(size_t)bucket*n_states+state];
+        size_t added=0;
+        if (pending_mask==0) {
+            bucket_states[bucket].push_back(state);
+            added=1;
+        }
+        pending_mask|=mask;
+        return added;
+    }
+};
+
+}
+
+}
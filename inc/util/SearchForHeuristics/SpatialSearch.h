@@ -3,6 +3,8 @@
 #include "util/SearchForHeuristics/DataStructure.h"
 #include "SharedEnv.h"
 #include "util/MyLogger.h"
+#include <algorithm>
+#include <cmath>
 
 namespace UTIL {
 
@@ -20,27 +22,70 @@ public:
         all_states = new State[max_states];
         max_successors=8;
         successors = new State[max_successors];
+        generation=0;
+        bucket_queue=nullptr;
+        int max_weight=get_max_integer_weight(env,weights);
+        if (max_weight>0) {
+            bucket_queue = new BucketQueue(max_weight);
+        }
         reset();
     };
 
+    // return the largest weight if all the weights of free cells are integers in [0,max_bucket_weight],
+    // otherwise -1 and the binary heap is used.
+    static int get_max_integer_weight(const SharedEnvironment & env, const std::vector<float> & weights) {
+        const int n_dirs=5;
+        float max_weight=0;
+        for (int pos=0;pos<env.rows*env.cols;++pos) {
+            if (env.map[pos]!=0) {
+                continue;
+            }
+            for (int dir=0;dir<n_dirs;++dir) {
+                float weight=weights[pos*n_dirs+dir];
+                if (!(weight>=0 && weight<=max_bucket_weight) || weight!=std::floor(weight)) {
+                    return -1;
+                }
+                max_weight=std::max(max_weight,weight);
+            }
+        }
+        return (int)max_weight;
+    }
+
+    // states are invalidated by bumping the generation instead of clearing all of them.
     void reset() {
         open_list->clear();
+        if (bucket_queue!=nullptr) {
+            bucket_queue->clear();
+        }
         n_states=0;
-        for (int i=0;i<max_states;++i) {
-            if (all_states[i].pos!=-1) {
-                all_states[i].pos=-1;
-                all_states[i].orient=-1;
-                all_states[i].g=-1;
-                all_states[i].h=0;
-                all_states[i].f=-1;
-                all_states[i].prev=nullptr;
+        ++generation;
+        if (generation==0) {
+            // wrapped around, old stamps could look valid again.
+            for (int i=0;i<max_states;++i) {
+                all_states[i].generation=0;
             }
+            generation=1;
         }
         n_successors=0;
     }
 
+    inline int get_index(int pos, int orient) const {
+        return orient==-1?pos:pos*n_orients+orient;
+    }
+
+    // whether the state at index is reached by the last search.
+    inline bool is_reached(int index) const {
+        return all_states[index].generation==generation;
+    }
+
+    // the cost of the state at index in the last search, or -1 if unreachable.
+    inline float get_g(int index) const {
+        return is_reached(index)?all_states[index].g:-1;
+    }
+
     ~SpatialAStar() {
         delete open_list;
+        delete bucket_queue;
         delete [] all_states;
         delete [] successors;
     }
@@ -51,6 +96,11 @@ public:
     OpenList* open_list;
     State * all_states;
     const int n_dirs=5; // right,down,left,up,stay
+    unsigned int generation;
+
+    // integer weights up to this use the bucket queue, which needs max weight+1 buckets.
+    static constexpr int max_bucket_weight=1024;
+    BucketQueue * bucket_queue;
 
     int n_successors;
     int max_successors;
@@ -189,19 +239,84 @@ public:
         }
     }
 
-    State * add_state(int pos, int orient, float g, float h, State * prev) {
-        int index;
-        if (orient==-1) {
-            index=pos;
+    // the reverse of get_successors: states that can reach curr in one action.
+    // it is used to search backward from a goal, so g is the cost to the goal.
+    void get_predecessors(State * curr) {
+        clear_successors();
+        int pos=curr->pos;
+        int x=pos%(env.cols);
+        int y=pos/(env.cols);
+        if (curr->orient==-1) {
+            // from west, moving east
+            if (x-1>=0) {
+                int prev_pos=pos-1;
+                if (env.map[prev_pos]==0) {
+                    add_successor(prev_pos, -1, curr->g+weights[prev_pos*n_dirs], 0, curr);
+                }
+            }
+
+            // from north, moving south
+            if (y-1>=0) {
+                int prev_pos=pos-env.cols;
+                if (env.map[prev_pos]==0) {
+                    add_successor(prev_pos, -1, curr->g+weights[prev_pos*n_dirs+1], 0, curr);
+                }
+            }
+
+            // from east, moving west
+            if (x+1<env.cols) {
+                int prev_pos=pos+1;
+                if (env.map[prev_pos]==0) {
+                    add_successor(prev_pos, -1, curr->g+weights[prev_pos*n_dirs+2], 0, curr);
+                }
+            }
+
+            // from south, moving north
+            if (y+1<env.rows) {
+                int prev_pos=pos+env.cols;
+                if (env.map[prev_pos]==0) {
+                    add_successor(prev_pos, -1, curr->g+weights[prev_pos*n_dirs+3], 0, curr);
+                }
+            }
         } else {
-            index=pos*n_orients+orient;
+            int orient=curr->orient;
+
+            // FW: the previous state has the same orientation and is one step behind.
+            int prev_pos=-1;
+            if (orient==0) {
+                if (x-1>=0) prev_pos=pos-1;
+            } else if (orient==1) {
+                if (y-1>=0) prev_pos=pos-env.cols;
+            } else if (orient==2) {
+                if (x+1<env.cols) prev_pos=pos+1;
+            } else if (orient==3) {
+                if (y+1<env.rows) prev_pos=pos+env.cols;
+            } else {
+                std::cerr<<"spatial search in heuristics: invalid orient: "<<orient<<endl;
+                exit(-1);
+            }
+            if (prev_pos!=-1 && env.map[prev_pos]==0) {
+                add_successor(prev_pos, orient, curr->g+weights[prev_pos*n_dirs+orient], 0, curr);
+            }
+
+            // CR and CCR: rotations are symmetric, so both neighboring orientations can rotate into orient.
+            int weight_idx=pos*n_dirs+4;
+            add_successor(pos, (orient+1+n_orients)%n_orients, curr->g+weights[weight_idx], 0, curr);
+            add_successor(pos, (orient-1+n_orients)%n_orients, curr->g+weights[weight_idx], 0, curr);
+
+            // W is a self-loop and never improves g, so it is skipped.
         }
-        State * s=all_states+index;
-        if (s->pos!=-1) {
+    }
+
+    State * add_state(int pos, int orient, float g, float h, State * prev) {
+        State * s=all_states+get_index(pos,orient);
+        if (s->generation==generation) {
             DEV_ERROR("State {} {} already exists!",pos,orient);
             exit(-1);
         }
 
+        s->generation=generation;
+        s->closed=false;
         s->pos=pos;
         s->orient=orient;
         s->g=g;
@@ -215,27 +330,55 @@ public:
 
 
     void search_for_all(int start_pos, int start_orient) {
-        State * start=add_state(start_pos, start_orient, 0, 0, nullptr);
-        open_list->push(start);
+        push(add_state(start_pos, start_orient, 0, 0, nullptr));
+        expand_all(false);
+    }
+
+    inline void push(State * s) {
+        if (bucket_queue!=nullptr) {
+            bucket_queue->push(s, (int)s->g);
+        } else {
+            open_list->push(s);
+        }
+    }
+
+    // compute the cost from every state to goal_pos (with any orientation, or goal_orient if it is given).
+    // afterwards, get_g(pos*n_orients+orient) is the cost-to-go, or -1 if unreachable.
+    void search_for_all_backward(int goal_pos, int goal_orient=-1) {
+        if (n_orients==1) {
+            push(add_state(goal_pos, -1, 0, 0, nullptr));
+        } else if (goal_orient!=-1) {
+            push(add_state(goal_pos, goal_orient, 0, 0, nullptr));
+        } else {
+            for (int orient=0;orient<n_orients;++orient) {
+                push(add_state(goal_pos, orient, 0, 0, nullptr));
+            }
+        }
+        expand_all(true);
+    }
+
+    void expand_all(bool backward) {
+        if (bucket_queue!=nullptr) {
+            expand_all_buckets(backward);
+            return;
+        }
 
         while (!open_list->empty()) {
             State * curr=open_list->pop();
             curr->closed=true;
             // cerr<<curr->pos<<" "<<curr->orient<<" "<<curr->g<<" "<<curr->h<<endl;
 
-            get_successors(curr);
+            if (backward) {
+                get_predecessors(curr);
+            } else {
+                get_successors(curr);
+            }
             for (int i=0;i<n_successors;++i) {
                 State * next=successors+i;
-                int index;
-                if (next->orient==-1) {
-                    index=next->pos;
-                } else {
-                    index=next->pos*n_orients+next->orient;
-                }
-                if ((all_states+index)->pos==-1) {
+                int index=get_index(next->pos,next->orient);
+                if (!is_reached(index)) {
                     // new state
                     State * new_state=add_state(next->pos, next->orient, next->g, next->h, next->prev);
-                    new_state->closed=false;
                     open_list->push(new_state);
                 } else {
                     // old state
@@ -255,6 +398,37 @@ public:
         }
     }
 
+    // the same as expand_all but with integer weights, so g is always integral and states are popped in
+    // bucket order. a state improved while open is pushed again, and its old entry is skipped when popped.
+    void expand_all_buckets(bool backward) {
+        while (!bucket_queue->empty()) {
+            State * curr=bucket_queue->pop();
+            if (curr->closed || (int)curr->g!=bucket_queue->curr_cost) {
+                continue;
+            }
+            curr->closed=true;
+
+            if (backward) {
+                get_predecessors(curr);
+            } else {
+                get_successors(curr);
+            }
+            for (int i=0;i<n_successors;++i) {
+                State * next=successors+i;
+                int index=get_index(next->pos,next->orient);
+                if (!is_reached(index)) {
+                    bucket_queue->push(add_state(next->pos, next->orient, next->g, next->h, next->prev), (int)next->g);
+                } else {
+                    auto old_state=all_states+index;
+                    if (!old_state->closed && next->g<old_state->g) {
+                        old_state->copy(next);
+                        bucket_queue->push(old_state, (int)next->g);
+                    }
+                }
+            }
+        }
+    }
+
 };
 
 }
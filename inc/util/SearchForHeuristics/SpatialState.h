@@ -56,6 +56,8 @@ struct State {
     bool closed;
     boost::heap::pairing_heap<State*, boost::heap::compare<State::StateCompare> >::handle_type open_list_handle;
     int heap_index;
+    // the search this state belongs to, see SpatialAStar::reset().
+    unsigned int generation=0;
 
 };
 
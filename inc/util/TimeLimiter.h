@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <chrono>
 #include <iostream>
 
@@ -8,6 +9,8 @@ class TimeLimiter {
 public:
     steady_clock::time_point start_time;
     double time_limit;
+    // if set, timeout() also returns true once another thread sets it, e.g., to stop a background search.
+    const std::atomic<bool> * stop_flag = nullptr;
 
     TimeLimiter(double _time_limit): time_limit(_time_limit) {
         reset_start_time();
@@ -16,6 +19,7 @@ public:
     TimeLimiter(const TimeLimiter & other) {
         time_limit = other.time_limit;
         start_time = other.start_time;
+        stop_flag = other.stop_flag;
     }
 
     inline void reset_start_time() {
@@ -29,6 +33,9 @@ public:
     }
 
     inline bool timeout() const {
+        if (stop_flag != nullptr && stop_flag->load(std::memory_order_relaxed)) {
+            return true;
+        }
         double elapse=get_elapse();
         return elapse >= time_limit;
     }
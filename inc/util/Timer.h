@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <iostream>
 #include <chrono>
+#include <mutex>
 #include "util/Dev.h"
 #include "util/MyLogger.h"
 
@@ -18,7 +19,7 @@ using std::chrono::duration;
 // Timer uses second as the default unit.
 // p means time point
 // d means time duration
-// : it may be modified to be thread-safe.
+// it is thread-safe, e.g., the background LNS records while the planner runs.
 class Timer
 {
 public:
@@ -48,6 +49,8 @@ public:
     void clear();
 
 private:
+    // recursive because e.g. record_d calls record_p.
+    mutable std::recursive_mutex mtx;
     std::unordered_map<string,steady_clock::time_point> time_points;
     std::unordered_map<string,double> time_durations;
     std::unordered_map<string,size_t> time_duration_counters;
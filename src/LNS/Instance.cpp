@@ -524,6 +524,18 @@ list<int> Instance::getNeighbors(int curr) const
 	return neighbors;
 }
 
+int Instance::getNeighbors(int curr, int * neighbors) const
+{
+	int n = 0;
+	int candidates[4] = {curr + 1, curr - 1, curr + num_of_cols, curr - num_of_cols};
+	for (int next : candidates)
+	{
+		if (validMove(curr, next))
+			neighbors[n++] = next;
+	}
+	return n;
+}
+
 void Instance::savePaths(const string & file_name, const vector<Path*>& paths) const
 {
     std::ofstream output;
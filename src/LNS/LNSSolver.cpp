@@ -4,6 +4,8 @@
 #include "util/Analyzer.h"
 #include "LNS/Parallel/GlobalManager.h"
 #include "LNS/Parallel/DataStructure.h"
+#include <omp.h>
+#include <limits>
 
 namespace LNS {
 
@@ -54,6 +56,34 @@ void LNSSolver::initialize(const SharedEnvironment & env){
     planning_window=window_size_for_CT; // : read from config & initialized in constructor
     execution_window=read_param_json<int>(config,"execution_window"); // : read from config & initialized in constructor
 
+    // replanAlgo "SIPP" is prioritized planning with the SIPP planner instead of the time-space A*.
+    replan_algo=read_param_json<string>(config,"replanAlgo");
+    sipp=replan_algo=="SIPP";
+    if (sipp) {
+        replan_algo="PP";
+        // SIPP keeps one arrival per safe interval, which is only the best one if all moves and waits cost the same.
+        float weight=-1;
+        for (int pos=0;pos<env.rows*env.cols && sipp;++pos) {
+            if (env.map[pos]==1) {
+                continue;
+            }
+            for (int i=pos*5;i<pos*5+5;++i) {
+                if (weight<0) {
+                    weight=(*map_weights)[i];
+                } else if ((*map_weights)[i]!=weight) {
+                    cerr<<"SIPP needs uniform map weights, fall back to the time-space A*"<<endl;
+                    sipp=false;
+                    break;
+                }
+            }
+        }
+    }
+
+    warm_start=read_param_json<bool>(config,"warm_start",false);
+    background=read_param_json<bool>(config,"background",false);
+    congestion_region_size=read_param_json<int>(config,"congestion_region_size",0);
+    telemetry_path=read_param_json<string>(config,"telemetry_path","");
+
 }
 
 int get_neighbor_orientation(const SharedEnvironment * env, int loc1,int loc2) {
@@ -92,65 +122,45 @@ std::vector<State> subvector(std::vector<State> & v, int start, int end) {
     return ret;
 }
 
-void LNSSolver::plan(const SharedEnvironment & env){
-    // : make it configurable.
-    double time_limit=read_param_json<double>(config,"cutoffTime");
-    TimeLimiter time_limiter(time_limit);
-
-    ONLYDEV(g_timer.record_p("_plan_s");)
-
-    ONLYDEV(g_timer.record_p("plan_s");)
-
-    std::vector<::State> starts;
-    std::vector<::State> goals;
-
-    int disabled_agent_count=0;
-    for (int i=0;i<env.num_of_agents;++i) {
-        if ((*agent_infos)[i].disabled) {
-            ++disabled_agent_count;
-        }
-        starts.emplace_back(execution_paths[i].back().location,-1,execution_paths[i].back().orientation);
-        // if ((*agent_infos)[i].disabled) {
-        //     goals.emplace_back(env.curr_states[i].location,-1,-1);
-        // } else {
-            goals.emplace_back(env.goal_locations[i][0].first,-1,-1);
-        // }
-    }
-
-    ONLYDEV(std::cout<<"disabled_agents:"<<disabled_agent_count <<std::endl;)
-
+void LNSSolver::extend_paths(const SharedEnvironment & env, std::vector<::Path> & paths, std::vector<::State> & starts, std::vector<::State> & goals, const string & timer_prefix, std::vector<int> * changed_from) {
     // : we need to replan for all agents that has no plan
     // later we may think of padding all agents to the same length
-    if (planning_paths[0].size()<planning_window+1) {
-        // std::cout<<"call lacam2: "<<planning_paths[0].size()<<std::endl;
+    if (changed_from!=nullptr) {
+        changed_from->resize(paths.size());
+        for (int i=0;i<paths.size();++i) {
+            (*changed_from)[i]=(int)paths[i].size();
+        }
+    }
+    if (paths[0].size()<planning_window+1) {
+        // std::cout<<"call lacam2: "<<paths[0].size()<<std::endl;
         // : maybe we should directly build lacam2 planner in this class.
         if (read_param_json<string>(config,"initAlgo")=="LaCAM2"){
-            ONLYDEV(g_timer.record_p("lacam2_plan_s");)
+            ONLYDEV(g_timer.record_p(timer_prefix+"lacam2_plan_s");)
             // use lacam2 to get a initial solution
             // : the following line may need to be optimized. There is no need to rebuild the graph G again.
             lacam2_solver->clear(env);
             
             // : we should avoid copy here. we may use deque for paths.
-            ONLYDEV(g_timer.record_p("copy_paths_1_s");)
+            ONLYDEV(g_timer.record_p(timer_prefix+"copy_paths_1_s");)
             vector<::Path> precomputed_paths;
             precomputed_paths.resize(env.num_of_agents);
             for (int i=0;i<env.num_of_agents;++i){
-                if (planning_paths[i][0].location!=execution_paths[i].back().location || planning_paths[i][0].orientation!=execution_paths[i].back().orientation){
+                if (paths[i][0].location!=starts[i].location || paths[i][0].orientation!=starts[i].orientation){
                     cerr<<"agent "<<i<<"'s current state doesn't match with the plan"<<endl; // TODO: modify this cerr.
                     exit(-1);
                 }
-                for (int j=0;j<planning_paths[i].size();++j){
-                    precomputed_paths[i].emplace_back(planning_paths[i][j]);
+                for (int j=0;j<paths[i].size();++j){
+                    precomputed_paths[i].emplace_back(paths[i][j]);
                     // we could break if we arrive at goal eariler here.
-                    if (j>1 && planning_paths[i][j].location==env.goal_locations[i][0].first){
+                    if (j>1 && paths[i][j].location==env.goal_locations[i][0].first){
                         break;
                     }
                 }
                 // std::cerr<<"agent "<<i<<std::endl;
-                // std::cerr<<planning_paths[i]<<std::endl;
+                // std::cerr<<paths[i]<<std::endl;
                 // std::cerr<<precomputed_paths[i]<<std::endl;
             }
-            ONLYDEV(g_timer.record_d("copy_paths_1_s","copy_paths_1_e","copy_paths_1");)
+            ONLYDEV(g_timer.record_d(timer_prefix+"copy_paths_1_s",timer_prefix+"copy_paths_1_e",timer_prefix+"copy_paths_1");)
 
 
             // TODO: lacam2_solver should plan with starts differnt from env.curr_states but goals the same as env.goals because they are up-to-date. 
@@ -160,26 +170,31 @@ void LNSSolver::plan(const SharedEnvironment & env){
             // we need to copy the new planned paths into paths
             // std::cerr<<"lacam2 paths:"<<endl;
             // for (int i=0;i<env.num_of_agents;++i) {
-            //     std::cerr<<"before agent "<<i<<" "<<env.curr_states[i]<<"->"<<env.goal_locations[i][0].first<<" "<<planning_paths[i].size()<<": "<<planning_paths[i]<<std::endl;
+            //     std::cerr<<"before agent "<<i<<" "<<env.curr_states[i]<<"->"<<env.goal_locations[i][0].first<<" "<<paths[i].size()<<": "<<paths[i]<<std::endl;
             //     std::cerr<<lacam2_solver->paths[i]<<endl;
             // }
             int num_inconsistent=0;
             for (int i=0;i<env.num_of_agents;++i){
-                for (int j=0;j<planning_paths[i].size()-1;++j){
-                    if (planning_paths[i][j].location!=lacam2_solver->paths[i][j].location || planning_paths[i][j].orientation!=lacam2_solver->paths[i][j].orientation){
-                        ++num_inconsistent;
-                        break;
-                    }
+                int j=0;
+                int T=(int)std::min(paths[i].size(),lacam2_solver->paths[i].size());
+                while (j<T && paths[i][j].location==lacam2_solver->paths[i][j].location && paths[i][j].orientation==lacam2_solver->paths[i][j].orientation){
+                    ++j;
+                }
+                if (j<(int)paths[i].size()-1){
+                    ++num_inconsistent;
+                }
+                if (changed_from!=nullptr){
+                    (*changed_from)[i]=j;
                 }
 
-                planning_paths[i].clear();
+                paths[i].clear();
                 for (int j=0;j<lacam2_solver->paths[i].size();++j){
-                    planning_paths[i].emplace_back(lacam2_solver->paths[i][j].location,j,lacam2_solver->paths[i][j].orientation);
+                    paths[i].emplace_back(lacam2_solver->paths[i][j].location,j,lacam2_solver->paths[i][j].orientation);
                 }
-                // std::cerr<<"agent "<<i<<" "<<env.curr_states[i]<<"->"<<env.goal_locations[i][0].first<<" "<<planning_paths[i].size()<<": "<<planning_paths[i]<<std::endl;
+                // std::cerr<<"agent "<<i<<" "<<env.curr_states[i]<<"->"<<env.goal_locations[i][0].first<<" "<<paths[i].size()<<": "<<paths[i]<<std::endl;
             }
             ONLYDEV(std::cerr<<"num_inconsistent/total: "<<num_inconsistent<<"/"<<env.num_of_agents<<"="<<num_inconsistent/(float)env.num_of_agents<<std::endl;)
-            ONLYDEV(g_timer.record_d("lacam2_plan_s","lacam2_plan_e","lacam2_plan");)
+            ONLYDEV(g_timer.record_d(timer_prefix+"lacam2_plan_s",timer_prefix+"lacam2_plan_e",timer_prefix+"lacam2_plan");)
         }
 
         // ONLYDEV(analyzer.snapshot(
@@ -188,7 +203,77 @@ void LNSSolver::plan(const SharedEnvironment & env){
         //     paths
         // );)
     }
+}
+
+void LNSSolver::plan(const SharedEnvironment & env){
+    // : make it configurable.
+    double time_limit=read_param_json<double>(config,"cutoffTime");
+    TimeLimiter time_limiter(time_limit);
+
+    if (background) {
+        // it was stopped in the middle of a window, e.g. to swap in repaired heuristics.
+        if (!background_thread.joinable() && !need_new_execution_paths && lns_solved) {
+            start_background(env);
+        }
+        // the background plans the window after the current execution paths, so the time of this step is left
+        // to it. its paths already span the whole planning window and are only taken when the execution paths
+        // run out.
+        if (background_thread.joinable()) {
+            if (!need_new_execution_paths || !background_goals_changed(env)) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(time_limit-time_limiter.get_elapse()));
+                if (need_new_execution_paths) {
+                    ONLYDEV(g_timer.record_p("take_background_s");)
+                    stop_background();
+                    ONLYDEV(g_timer.record_d("take_background_s","take_background_e","take_background");)
+                }
+                return;
+            }
+
+            // some goals were reassigned after the background started, so its paths may still lead to the old
+            // ones. its paths are taken as they are and only the reassigned agents are replanned first below, in
+            // the time of this step. if the padding of the taken paths collides, they are cut to the steps the
+            // synchronous mode keeps and extended towards the new goals instead.
+            ONLYDEV(g_timer.record_p("take_background_s");)
+            stop_background();
+            if (background_padding_collision_free()) {
+                lns->priority_agents.clear();
+                for (int i=0;i<env.num_of_agents;++i) {
+                    if (env.goal_locations[i][0].first!=background_env.goal_locations[i][0].first) {
+                        lns->priority_agents.push_back(i);
+                    }
+                }
+            } else {
+                for (auto & path: planning_paths) {
+                    path.resize(planning_window+1-execution_window);
+                }
+            }
+            ONLYDEV(g_timer.record_d("take_background_s","take_background_e","take_background");)
+        }
+    }
+
+    ONLYDEV(g_timer.record_p("_plan_s");)
+
+    ONLYDEV(g_timer.record_p("plan_s");)
 
+    std::vector<::State> starts;
+    std::vector<::State> goals;
+
+    int disabled_agent_count=0;
+    for (int i=0;i<env.num_of_agents;++i) {
+        if ((*agent_infos)[i].disabled) {
+            ++disabled_agent_count;
+        }
+        starts.emplace_back(execution_paths[i].back().location,-1,execution_paths[i].back().orientation);
+        // if ((*agent_infos)[i].disabled) {
+        //     goals.emplace_back(env.curr_states[i].location,-1,-1);
+        // } else {
+            goals.emplace_back(env.goal_locations[i][0].first,-1,-1);
+        // }
+    }
+
+    ONLYDEV(std::cout<<"disabled_agents:"<<disabled_agent_count <<std::endl;)
+
+    extend_paths(env,planning_paths,starts,goals,"",&extended_from);
 
     // : not sure what's bug making it cannot be placed in initialize()    
     ONLYDEV(g_timer.record_p("prepare_LNS_s");)
@@ -207,19 +292,36 @@ void LNSSolver::plan(const SharedEnvironment & env){
             0.01, // TODO: decay factor
             0.01, // TODO: reaction factor
             read_param_json<string>(config,"initAlgo"),
-            read_param_json<string>(config,"replanAlgo"),
-            false, // TODO: not sipp
+            replan_algo,
+            sipp,
             read_param_json<int>(config,"window_size_for_CT"),
             read_param_json<int>(config,"window_size_for_CAT"),
             read_param_json<int>(config,"window_size_for_PATH"),
             execution_window,
+            congestion_region_size,
             lacam2_solver->max_agents_in_use!=env.num_of_agents, // TODO: has disabled agents
             read_param_json<bool>(config,"fix_ng_bug"),
             0 // TODO: screen
         );
+        if (telemetry_path!="") {
+            lns->telemetry=std::make_shared<Parallel::Telemetry>(telemetry_path,lns->num_threads);
+        }
     }
 
-    lns->reset();
+    // the previous solution is still in lns, and planning_paths only differ from it by the shifted steps and
+    // what LaCAM2 changed. the other agents are only extended by LaCAM2.
+    bool warm=warm_start && lns_solved && !background_taken;
+    if (!warm) {
+        lns->reset();
+    } else {
+        changed_agents.clear();
+        for (int i=0;i<env.num_of_agents;++i) {
+            int kept=(int)lns->agents[i].path.size()-shifted_steps;
+            if (kept<=0 || extended_from[i]<kept || goals[i].location!=instance->goal_locations[i]) {
+                changed_agents.push_back(i);
+            }
+        }
+    }
     instance->set_starts_and_goals(starts,goals);
     ONLYDEV(g_timer.record_d("prepare_LNS_s","prepare_LNS_e","prepare_LNS");)
 
@@ -258,27 +360,51 @@ void LNSSolver::plan(const SharedEnvironment & env){
     // copy current paths to lns paths
     // we need to do this every timestep because the goal might be updated.
     ONLYDEV(g_timer.record_p("copy_paths_2_s");)
-    for (int i=0;i<lns->agents.size();i++){
-        if (lns->agents[i].id!=i) {
-            cerr<<"agents are not ordered at the begining"<<endl;
-            exit(-1);
+    if (warm) {
+        // the changed agents take their whole paths, the others only the timesteps appended to their old paths.
+        warm_paths.resize(planning_paths.size());
+        int k=0;
+        for (int i=0;i<planning_paths.size();++i) {
+            auto & path=warm_paths[i];
+            path.clear();
+            bool changed=k<changed_agents.size() && changed_agents[k]==i;
+            int from=0;
+            if (changed) {
+                ++k;
+            } else {
+                from=(int)lns->agents[i].path.size()-shifted_steps;
+            }
+            for (int j=from;j<planning_paths[i].size();++j){
+                path.nodes.emplace_back(planning_paths[i][j].location,planning_paths[i][j].orientation);
+            }
+            if (changed) {
+                path.path_cost=lns->agents[i].getEstimatedPathLength(path,env.goal_locations[i][0].first,HT);
+            }
         }
-        lns->agents[i].path.clear();
-        bool goal_arrived=false;
-        for (int j=0;j<planning_paths[i].size();++j){
-            lns->agents[i].path.nodes.emplace_back(planning_paths[i][j].location,planning_paths[i][j].orientation);
-            if (planning_paths[i][j].location==env.goal_locations[i][0].first){
-                goal_arrived=true;
-                // break;
+        lns->advance(shifted_steps,changed_agents,warm_paths);
+    } else {
+        for (int i=0;i<lns->agents.size();i++){
+            if (lns->agents[i].id!=i) {
+                cerr<<"agents are not ordered at the begining"<<endl;
+                exit(-1);
             }
+            lns->agents[i].path.clear();
+            bool goal_arrived=false;
+            for (int j=0;j<planning_paths[i].size();++j){
+                lns->agents[i].path.nodes.emplace_back(planning_paths[i][j].location,planning_paths[i][j].orientation);
+                if (planning_paths[i][j].location==env.goal_locations[i][0].first){
+                    goal_arrived=true;
+                    // break;
+                }
+            }
+            // : it is not correct on weighted maps
+            lns->agents[i].path.path_cost=lns->agents[i].getEstimatedPathLength(lns->agents[i].path,env.goal_locations[i][0].first,HT);
+            // cerr<<"agent "<<i<<": ";
+            // for (int j=0;j<lns->agents[i].path.size();++j){
+            //     cerr<<lacam2_solver->paths[i][j].location<<" ";
+            // }   
+            // cerr<<endl;
         }
-        // : it is not correct on weighted maps
-        lns->agents[i].path.path_cost=lns->agents[i].getEstimatedPathLength(lns->agents[i].path,env.goal_locations[i][0].first,HT);
-        // cerr<<"agent "<<i<<": ";
-        // for (int j=0;j<lns->agents[i].path.size();++j){
-        //     cerr<<lacam2_solver->paths[i][j].location<<" ";
-        // }   
-        // cerr<<endl;
     }
     ONLYDEV(g_timer.record_d("copy_paths_2_s","copy_paths_2_e","copy_paths_2");)
 
@@ -293,16 +419,9 @@ void LNSSolver::plan(const SharedEnvironment & env){
     //     exit(-1);
     // }
 
-    // we cannot do this because it would make result invalid
-    // deal with a special case when the goal and the start are the same.
-    if (execution_window==1) {
-        for (int i=0;i<lns->agents.size();++i) {
-            if (lns->agents[i].path.size()<planning_window+1) {
-                // in this case, actually the goal is the same as the start
-                lns->agents[i].path.nodes.resize(planning_window+1,lns->agents[i].path.back());
-            }
-        }
-    }
+    lns_solved=true;
+    background_taken=false;
+    shifted_steps=0;
     ONLYDEV(g_timer.record_d("run_LNS_s","run_LNS_e","run_LNS");)
 
     // save to paths
@@ -336,6 +455,16 @@ void LNSSolver::plan(const SharedEnvironment & env){
             //     break;
             // }
         }
+
+        // we cannot do this because it would make result invalid
+        // deal with a special case when the goal and the start are the same.
+        // the padding is not added to lns->agents, so they stay the same as the path tables for a warm start.
+        if (execution_window==1) {
+            // in this case, actually the goal is the same as the start
+            for (int j=(int)path.size();j<planning_window+1;++j) {
+                path.emplace_back(new_path.back().location, j, new_path.back().orientation);
+            }
+        }
         // cerr<<"agent "<<i<<" s:"<<env.curr_states[i]<<" e:"<<env.goal_locations[i][0].first<<" c:"<<executed_plan_step<<endl;
         // std::cerr<<"agent "<<i<<" "<<env.curr_states[i]<<"->"<<env.goal_locations[i][0].first<<" "<<path.size()<<": "<<path<<endl;
         // std::cerr<<path<<endl;
@@ -455,6 +584,7 @@ void LNSSolver::get_step_actions(const SharedEnvironment & env, vector<Action> &
 
         // keep only the remaining planning paths
         // std::cerr<<"truncated planning paths"<<std::endl;
+        shifted_steps+=execution_window;
         for (int i=0;i<env.num_of_agents;++i) {
             planning_paths[i].erase(planning_paths[i].begin(),planning_paths[i].begin()+execution_window);
             if (planning_paths[i].size()!=planning_window+1-execution_window) {
@@ -515,7 +645,138 @@ void LNSSolver::get_step_actions(const SharedEnvironment & env, vector<Action> &
         }
     )
 
+    if (background && need_new_execution_paths) {
+        start_background(env);
+    }
+
     ONLYDEV(g_timer.record_d("get_step_actions_s","get_step_actions_e","get_step_actions");)
 }
 
+void LNSSolver::start_background(const SharedEnvironment & env) {
+    // the remaining planning paths start where the execution paths end, so the next window can be planned while
+    // the execution paths are being executed.
+    if (planning_window<=execution_window) {
+        return;
+    }
+
+    if (background_lns==nullptr) {
+        background_instance=std::make_shared<Instance>(env);
+        background_lns=std::make_shared<Parallel::GlobalManager>(
+            true,
+            *background_instance,
+            HT,
+            map_weights,
+            agent_infos,
+            read_param_json<int>(config,"neighborSize"),
+            Parallel::destroy_heuristic::RANDOMWALK,
+            true,
+            0.01,
+            0.01,
+            read_param_json<string>(config,"initAlgo"),
+            replan_algo,
+            sipp,
+            read_param_json<int>(config,"window_size_for_CT"),
+            read_param_json<int>(config,"window_size_for_CAT"),
+            read_param_json<int>(config,"window_size_for_PATH"),
+            execution_window,
+            congestion_region_size,
+            lacam2_solver->max_agents_in_use!=env.num_of_agents,
+            read_param_json<bool>(config,"fix_ng_bug"),
+            0
+        );
+        background_lns->timer_prefix="bg_";
+    }
+
+    // the simulator updates env between steps, so the background works on a copy.
+    background_env=env;
+    background_paths=planning_paths;
+
+    background_stop=false;
+    background_thread=std::thread([this](){
+        auto & env=background_env;
+        std::vector<::State> starts;
+        std::vector<::State> goals;
+        for (int i=0;i<env.num_of_agents;++i) {
+            starts.emplace_back(background_paths[i][0].location,-1,background_paths[i][0].orientation);
+            goals.emplace_back(env.goal_locations[i][0].first,-1,-1);
+        }
+
+        extend_paths(env,background_paths,starts,goals,"bg_");
+
+        background_lns->reset();
+        background_instance->set_starts_and_goals(starts,goals);
+        for (int i=0;i<background_lns->agents.size();++i) {
+            auto & agent=background_lns->agents[i];
+            agent.path.clear();
+            for (int j=0;j<background_paths[i].size();++j) {
+                agent.path.nodes.emplace_back(background_paths[i][j].location,background_paths[i][j].orientation);
+            }
+            agent.path.path_cost=agent.getEstimatedPathLength(agent.path,env.goal_locations[i][0].first,HT);
+        }
+
+        // the time limit is only the stop flag.
+        TimeLimiter time_limiter(std::numeric_limits<double>::max());
+        time_limiter.stop_flag=&background_stop;
+        omp_set_num_threads(background_lns->num_threads);
+        background_lns->run(time_limiter);
+    });
+}
+
+bool LNSSolver::background_padding_collision_free() const {
+    // the background paths are collision-free, so only an agent waiting at the end of its path can collide, with
+    // an agent passing there later.
+    std::vector<int> waiting_from(background_env.map.size(),MAX_TIMESTEP);
+    std::vector<int> waiting_agent(background_env.map.size(),-1);
+    for (int i=0;i<background_lns->agents.size();++i) {
+        auto & path=background_lns->agents[i].path;
+        if ((int)path.size()<planning_window+1) {
+            waiting_from[path.back().location]=(int)path.size()-1;
+            waiting_agent[path.back().location]=i;
+        }
+    }
+    for (int i=0;i<background_lns->agents.size();++i) {
+        auto & path=background_lns->agents[i].path;
+        for (int t=0;t<path.size();++t) {
+            int loc=path[t].location;
+            if (waiting_from[loc]<=t && waiting_agent[loc]!=i) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool LNSSolver::background_goals_changed(const SharedEnvironment & env) const {
+    for (int i=0;i<env.num_of_agents;++i) {
+        if (env.goal_locations[i][0].first!=background_env.goal_locations[i][0].first) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LNSSolver::stop_background() {
+    if (!background_thread.joinable()) {
+        return;
+    }
+
+    background_stop=true;
+    background_thread.join();
+
+    // the background paths have the same starts and are still collision-free among themselves.
+    for (int i=0;i<planning_paths.size();++i) {
+        auto & path=planning_paths[i];
+        auto & new_path=background_lns->agents[i].path;
+        path.clear();
+        for (int j=0;j<new_path.size();++j) {
+            path.emplace_back(new_path[j].location,j,new_path[j].orientation);
+        }
+        // the same padding as in plan() for paths that end at the goal early.
+        for (int j=(int)path.size();j<planning_window+1;++j) {
+            path.emplace_back(new_path.back().location,j,new_path.back().orientation);
+        }
+    }
+    background_taken=true;
+}
+
 } // end namespace LNS
@@ -0,0 +1,123 @@
+#include "LNS/Parallel/CongestionIndex.h"
+
+namespace LNS {
+
+namespace Parallel {
+
+CongestionIndex::CongestionIndex(const Instance & instance, int region_size, int max_path_length):
+    instance(instance), region_size(region_size), max_path_length(max_path_length) {
+
+    if (region_size<=0) {
+        std::cerr<<"CongestionIndex: invalid region size: "<<region_size<<endl;
+        exit(-1);
+    }
+
+    n_region_cols=(instance.num_of_cols+region_size-1)/region_size;
+    n_region_rows=(instance.num_of_rows+region_size-1)/region_size;
+    n_regions=n_region_cols*n_region_rows;
+
+    tree.resize(n_regions+1,0);
+    contributions.resize(instance.num_of_agents,0);
+    agent_regions.resize((size_t)instance.num_of_agents*max_path_length);
+    agent_region_counts.resize(instance.num_of_agents,0);
+}
+
+void CongestionIndex::reset() {
+    std::fill(tree.begin(),tree.end(),0);
+    std::fill(contributions.begin(),contributions.end(),0);
+    std::fill(agent_region_counts.begin(),agent_region_counts.end(),0);
+}
+
+void CongestionIndex::update(Agent & agent) {
+    update(agent,agent.path);
+}
+
+void CongestionIndex::update(Agent & agent, const Path & path) {
+    int aid=agent.id;
+    int * regions=agent_regions.data()+(size_t)aid*max_path_length;
+    int & n=agent_region_counts[aid];
+
+    for (int i=0;i<n;++i) {
+        add(regions[i],-contributions[aid]);
+    }
+
+    n=0;
+    contributions[aid]=0;
+    if (path.empty()) {
+        return;
+    }
+
+    // disabled agents have negative delays.
+    float delays=std::max(agent.getNumOfDelays(path),0.0f);
+    if (delays==0) {
+        return;
+    }
+
+    int path_length=std::min((int)path.size(),max_path_length);
+    for (int t=0;t<path_length;++t) {
+        int region=get_region(path[t].location);
+        if (std::find(regions,regions+n,region)==regions+n) {
+            regions[n++]=region;
+        }
+    }
+
+    contributions[aid]=delays;
+    for (int i=0;i<n;++i) {
+        add(regions[i],delays);
+    }
+}
+
+void CongestionIndex::update(std::vector<Agent> & agents) {
+    // rebuilt from scratch, which also drops the rounding errors of the incremental updates.
+    reset();
+    for (auto & agent: agents) {
+        update(agent);
+    }
+}
+
+int CongestionIndex::sample(std::mt19937 & MT) const {
+    double total=get_total_heat();
+    if (total<=1e-6) {
+        return -1;
+    }
+
+    // descend the Fenwick tree to the first region whose prefix sum exceeds r.
+    double r=std::uniform_real_distribution<double>(0,total)(MT);
+    int pos=0;
+    int step=1;
+    while (step*2<=n_regions) {
+        step*=2;
+    }
+    for (;step>0;step/=2) {
+        if (pos+step<=n_regions && tree[pos+step]<=r) {
+            pos+=step;
+            r-=tree[pos];
+        }
+    }
+    return std::min(pos,n_regions-1);
+}
+
+void CongestionIndex::get_region(int region, int & x0, int & y0, int & x1, int & y1) const {
+    x0=region%n_region_cols*region_size;
+    y0=region/n_region_cols*region_size;
+    x1=std::min(x0+region_size,instance.num_of_cols);
+    y1=std::min(y0+region_size,instance.num_of_rows);
+}
+
+void CongestionIndex::add(int region, double delta) {
+    for (int i=region+1;i<=n_regions;i+=i&(-i)) {
+        tree[i]+=delta;
+    }
+}
+
+double CongestionIndex::prefix_sum(int n) const {
+    double sum=0;
+    for (int i=n;i>0;i-=i&(-i)) {
+        sum+=tree[i];
+    }
+    return sum;
+}
+
+}
+
+} // namespace LNS
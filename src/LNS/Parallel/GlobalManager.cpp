@@ -3,6 +3,10 @@
 #include "omp.h"
 #include "util/TimeLimiter.h"
 #include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "util/MyLogger.h"
 
 namespace LNS {
 
@@ -16,12 +20,14 @@ GlobalManager::GlobalManager(
     bool ALNS, double decay_factor, double reaction_factor,
     string init_algo_name, string replan_algo_name, bool sipp,
     int window_size_for_CT, int window_size_for_CAT, int window_size_for_PATH, int execution_window,
+    int congestion_region_size,
     bool has_disabled_agents,
     bool fix_ng_bug,
     int screen
 ): 
     async(async),
     instance(instance), path_table(instance.map_size,window_size_for_PATH), HT(HT), map_weights(map_weights),
+    path_store(agents,commit_log,instance.num_of_agents),
     init_algo_name(init_algo_name), replan_algo_name(replan_algo_name),
     window_size_for_CT(window_size_for_CT), window_size_for_CAT(window_size_for_CAT), window_size_for_PATH(window_size_for_PATH),
     screen(screen), agent_infos(agent_infos), has_disabled_agents(has_disabled_agents) {
@@ -37,6 +43,12 @@ GlobalManager::GlobalManager(
 
     cout<<"LNS use "<<num_threads<<" threads"<<endl;
 
+    // the local optimizers keep the congestion index, which only works if each has its own neighbor generator.
+    if (!async && congestion_region_size>0) {
+        cerr<<"the congestion destroy heuristic is only supported in async mode"<<endl;
+        exit(-1);
+    }
+
     // for (auto w: *map_weights){
     //     if (w!=1){
     //         DEV_ERROR("we cannot support weighted map now for LNS! because in that way, we may need two different heuristic table. one for path cost estimation, one for path length estimation.");
@@ -53,9 +65,10 @@ GlobalManager::GlobalManager(
 
     for (auto i=0;i<num_threads;++i) {
         auto local_optimizer=std::make_shared<LocalOptimizer>(
-            instance, agents, HT, map_weights, agent_infos,
+            instance, path_table, agents, path_store, HT, map_weights, agent_infos,
             replan_algo_name, sipp,
             window_size_for_CT, window_size_for_CAT, window_size_for_PATH, execution_window,
+            congestion_region_size,
             has_disabled_agents,
             screen, i*2023+1
         );
@@ -64,7 +77,7 @@ GlobalManager::GlobalManager(
 
     if (!async) {
         neighbor_generator=std::make_shared<NeighborGenerator>(
-            instance, HT, path_table, agents, agent_infos,
+            instance, HT, path_table, agents, path_store, agent_infos, nullptr,
             neighbor_size, destroy_strategy, 
             ALNS, decay_factor, reaction_factor, 
             num_threads, fix_ng_bug, screen, 0
@@ -72,17 +85,22 @@ GlobalManager::GlobalManager(
     } else {
         for (auto i=0;i<num_threads;++i) {
             auto neighbor_generator=std::make_shared<NeighborGenerator>(
-                instance, HT, local_optimizers[i]->path_table, local_optimizers[i]->agents, agent_infos,
+                instance, HT, path_table, agents, path_store, agent_infos,
+                local_optimizers[i]->congestion_index.get(),
                 neighbor_size, destroy_strategy, 
                 ALNS, decay_factor, reaction_factor, 
                 num_threads, fix_ng_bug, screen, i*2023+1314
             );
             neighbor_generators.push_back(neighbor_generator);
         }
-        updating_queues.resize(num_threads);
-        updating_queue_locks.resize(num_threads);
-        for (auto & lock: updating_queue_locks) {
-            omp_init_lock(&lock);
+
+        agent_stamps.reset(new std::atomic<uint32_t>[instance.num_of_agents]);
+        for (int i=0;i<instance.num_of_agents;++i) {
+            agent_stamps[i].store(0,std::memory_order_relaxed);
+        }
+        location_stamps.reset(new std::atomic<uint32_t>[instance.map_size]);
+        for (int i=0;i<instance.map_size;++i) {
+            location_stamps[i].store(0,std::memory_order_relaxed);
         }
     }
 }
@@ -95,6 +113,7 @@ void GlobalManager::reset() {
     sum_of_distances=0;
 
     iteration_stats.clear();
+    warm_started=false;
     path_table.reset();
     for (auto & agent: agents) {
         agent.reset();
@@ -108,11 +127,7 @@ void GlobalManager::reset() {
         for (auto & neighbor_generator: neighbor_generators) {
             neighbor_generator->reset();
         }
-        for (int i=0;i<num_threads;++i) {
-            omp_set_lock(&(updating_queue_locks[i]));
-            updating_queues[i].clear();
-            omp_unset_lock(&(updating_queue_locks[i]));
-        }
+        commit_log.clear();
     }
 
     // call reset of local_optimizers
@@ -123,31 +138,23 @@ void GlobalManager::reset() {
 
 }
 
-GlobalManager::~GlobalManager() {
-    if (async) {
-        for (auto & lock: updating_queue_locks) {
-            omp_destroy_lock(&lock);
-        }
-    }
-}
-
 void GlobalManager::update(Neighbor & neighbor, bool recheck) {
 
     if (neighbor.succ){
         // before we update, we check if the solution is valid. because in the parallel setting, we may have later update that makes the solution invalid.
 
         if (recheck) {
-            g_timer.record_p("manager_update_s");
+            g_timer.record_p(timer_prefix+"manager_update_s");
         } else {
-            g_timer.record_p("init_manager_update_s");
+            g_timer.record_p(timer_prefix+"init_manager_update_s");
         }
 
         if (recheck) {
-            g_timer.record_p("recheck_s");
+            g_timer.record_p(timer_prefix+"recheck_s");
             // re-check validness
             bool valid=true;
-            for (auto & aid: neighbor.agents) {
-                auto & path=neighbor.m_paths[aid];
+            for (int j=0;j<neighbor.agents.size();++j) {
+                auto & path=neighbor.m_paths[j];
                 for (int i=0;i<path.size()-1;++i) {
                     int from=path[i].location;
                     int to=path[i+1].location;
@@ -183,55 +190,206 @@ void GlobalManager::update(Neighbor & neighbor, bool recheck) {
 
             // re-update old_sum_of_costs here.
             neighbor.old_sum_of_costs=old_sum_of_costs;
-            for (auto & id: neighbor.agents) {
-                neighbor.m_old_paths[id]=agents[id].path;
+            for (int i=0;i<neighbor.agents.size();++i) {
+                neighbor.m_old_paths[i]=agents[neighbor.agents[i]].path;
             }
 
-            g_timer.record_d("recheck_s","recheck");
+            g_timer.record_d(timer_prefix+"recheck_s",timer_prefix+"recheck");
 
         }
 
         update(neighbor);
 
         if (recheck) {
-            g_timer.record_d("manager_update_s","manager_update");
+            g_timer.record_d(timer_prefix+"manager_update_s",timer_prefix+"manager_update");
         } else {
-            g_timer.record_d("init_manager_update_s","init_manager_update");
+            g_timer.record_d(timer_prefix+"init_manager_update_s",timer_prefix+"init_manager_update");
         }
     }
 }
 
 void GlobalManager::update(Neighbor & neighbor) {
     // apply update
-    g_timer.record_p("path_table_delete_s");
-    for (auto & aid: neighbor.agents) {
+    g_timer.record_p(timer_prefix+"path_table_delete_s");
+    for (int i=0;i<neighbor.agents.size();++i) {
         bool verbose=false;
         // if (neighbor.agents.size()<10){
         //     verbose=true;
         // } 
-        path_table.deletePath(aid, neighbor.m_old_paths[aid],verbose);
+        path_table.deletePath(neighbor.agents[i], neighbor.m_old_paths[i],verbose);
     }
-    g_timer.record_d("path_table_delete_s","path_table_delete");
+    g_timer.record_d(timer_prefix+"path_table_delete_s",timer_prefix+"path_table_delete");
 
     // std::cerr<<std::endl;
-    g_timer.record_p("path_table_insert_s");
-    for (auto & aid: neighbor.agents) {
+    g_timer.record_p(timer_prefix+"path_table_insert_s");
+    for (int i=0;i<neighbor.agents.size();++i) {
+        int aid=neighbor.agents[i];
         // update agents' paths here
-        agents[aid].path = neighbor.m_paths[aid];
+        agents[aid].path = neighbor.m_paths[i];
         bool verbose=false;
         // if (neighbor.agents.size()<10){
         //     verbose=true;
         // } 
         // update path table here
-        path_table.insertPath(aid, neighbor.m_paths[aid],verbose);
+        path_table.insertPath(aid, neighbor.m_paths[i],verbose);
     }
-    g_timer.record_d("path_table_insert_s","path_table_insert");
+    g_timer.record_d(timer_prefix+"path_table_insert_s",timer_prefix+"path_table_insert");
 
         // std::cerr<<std::endl;
     // update costs here
     sum_of_costs += neighbor.sum_of_costs - neighbor.old_sum_of_costs;
 }
 
+// take a stamp if no one else holds it, i.e., it is even.
+static inline bool try_acquire_stamp(std::atomic<uint32_t> & stamp) {
+    uint32_t version=stamp.load(std::memory_order_relaxed);
+    if (version&1) {
+        return false;
+    }
+    return stamp.compare_exchange_strong(version,version+1,std::memory_order_acquire,std::memory_order_relaxed);
+}
+
+static inline void release_stamp(std::atomic<uint32_t> & stamp) {
+    stamp.fetch_add(1,std::memory_order_release);
+}
+
+commit_result GlobalManager::commit(Neighbor & neighbor, float & cost_delta, uint64_t & wait_ns) {
+    ++commit_stats.n_attempts;
+
+    // reused by the later commits of the same thread.
+    static thread_local std::vector<int> owned_agents;
+    static thread_local std::vector<int> locations;
+    owned_agents.clear();
+    size_t n_owned_locations=0;
+    auto release_all=[&]() {
+        for (int aid: owned_agents) {
+            release_stamp(agent_stamps[aid]);
+        }
+        for (size_t i=0;i<n_owned_locations;++i) {
+            release_stamp(location_stamps[locations[i]]);
+        }
+        owned_agents.clear();
+        n_owned_locations=0;
+    };
+
+    std::chrono::steady_clock::time_point backoff_start;
+    for (int attempt=0;;++attempt) {
+        if (attempt>0) {
+            ++commit_stats.n_aborts;
+            if (attempt>max_commit_retries) {
+                ++commit_stats.n_dropped;
+                wait_ns+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-backoff_start).count();
+                neighbor.succ=false;
+                return DROPPED;
+            }
+            if (attempt==1) {
+                backoff_start=std::chrono::steady_clock::now();
+            }
+            std::this_thread::yield();
+        }
+
+        // 1. own the agents, then their current global paths can be read.
+        bool owned=true;
+        for (int aid: neighbor.agents) {
+            if (!try_acquire_stamp(agent_stamps[aid])) {
+                owned=false;
+                break;
+            }
+            owned_agents.push_back(aid);
+        }
+        if (!owned) {
+            release_all();
+            continue;
+        }
+
+        // 2. own every location whose cells the validation reads or the update writes.
+        locations.clear();
+        for (int i=0;i<neighbor.agents.size();++i) {
+            for (auto & node: path_store.get(neighbor.agents[i]).nodes) {
+                locations.push_back(node.location);
+            }
+            for (auto & node: neighbor.m_paths[i].nodes) {
+                locations.push_back(node.location);
+            }
+        }
+        std::sort(locations.begin(),locations.end());
+        locations.erase(std::unique(locations.begin(),locations.end()),locations.end());
+        for (int loc: locations) {
+            if (!try_acquire_stamp(location_stamps[loc])) {
+                owned=false;
+                break;
+            }
+            ++n_owned_locations;
+        }
+        if (!owned) {
+            release_all();
+            continue;
+        }
+        break;
+    }
+
+    if (backoff_start!=std::chrono::steady_clock::time_point()) {
+        wait_ns+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-backoff_start).count();
+    }
+
+    // 3. re-check validness and cost as update(neighbor,true) does. nothing it reads can change meanwhile.
+    bool valid=true;
+    for (int j=0;j<neighbor.agents.size();++j) {
+        auto & path=neighbor.m_paths[j];
+        for (int i=0;i<(int)path.size()-1;++i) {
+            // : we need to ignore the conflicts with agents in the neighbor.
+            if (path_table.constrained(path[i].location,path[i+1].location,i+1,neighbor.agents)) {
+                valid=false;
+                break;
+            }
+        }
+        if (!valid) break;
+    }
+
+    float old_sum_of_costs=0;
+    for (auto & aid: neighbor.agents) {
+        old_sum_of_costs+=path_store.get(aid).path_cost;
+    }
+    if (!valid || old_sum_of_costs<=neighbor.sum_of_costs) {
+        release_all();
+        ++commit_stats.n_invalid;
+        neighbor.succ=false;
+        return valid?NOT_CHEAPER:INVALID;
+    }
+
+    // take the slot while still owning everything, so that the neighbors touching the same agents or locations are
+    // logged in the order they are applied.
+    size_t version;
+    if (!commit_log.reserve(version)) {
+        release_all();
+        ++commit_stats.n_dropped;
+        neighbor.succ=false;
+        return DROPPED;
+    }
+
+    // 4. apply it and publish it to the local optimizers before anyone else can own the same agents or locations.
+    // the agents' paths are not written: they are pointed to the new paths in the log entry.
+    neighbor.old_sum_of_costs=old_sum_of_costs;
+    for (int i=0;i<neighbor.agents.size();++i) {
+        int aid=neighbor.agents[i];
+        neighbor.m_old_paths[i]=path_store.get(aid);
+        path_table.deletePath(aid, neighbor.m_old_paths[i]);
+    }
+    for (int i=0;i<neighbor.agents.size();++i) {
+        path_table.insertPath(neighbor.agents[i], neighbor.m_paths[i]);
+    }
+    cost_delta=neighbor.sum_of_costs-neighbor.old_sum_of_costs;
+    commit_log.publish(version,neighbor);
+    // the neighbor holds the buffers of an old entry now, but owned_agents are its agents.
+    for (int aid: owned_agents) {
+        path_store.set(aid,version);
+    }
+
+    release_all();
+    ++commit_stats.n_commits;
+    return ACCEPTED;
+}
+
 bool GlobalManager::run(TimeLimiter & time_limiter) {
     if (async) {
         return _run_async(time_limiter);
@@ -250,7 +408,7 @@ bool GlobalManager::_run_async(TimeLimiter & time_limiter) {
 
     double elapse=0;
 
-    g_timer.record_p("lns_init_sol_s");
+    g_timer.record_p(timer_prefix+"lns_init_sol_s");
     sum_of_distances = 0;
     for (const auto & agent : agents)
     {
@@ -259,23 +417,9 @@ bool GlobalManager::_run_async(TimeLimiter & time_limiter) {
 
     // 0. get initial solution
     Neighbor init_neighbor;
-    init_neighbor.agents.resize(agents.size());
-    for (int i=0;i<agents.size();++i) {
-        init_neighbor.agents[i]=i;
-    }
-    getInitialSolution(init_neighbor);
-
-    update(init_neighbor,false);
-
-    // synchonize to local optimizer
-    ONLYDEV(g_timer.record_p("init_loc_opt_update_s");)
-    #pragma omp parallel for
-    for (int i=0;i<num_threads;++i) {
-        local_optimizers[i]->update(init_neighbor);
-    }
-    ONLYDEV(g_timer.record_d("init_loc_opt_update_s","init_loc_opt_update");)
+    init_solution(init_neighbor);
 
-    bool runtime=g_timer.record_d("lns_init_sol_s","lns_init_sol");
+    bool runtime=g_timer.record_d(timer_prefix+"lns_init_sol_s",timer_prefix+"lns_init_sol");
 
     elapse=time_limiter.get_elapse();
     iteration_stats.emplace_back(agents.size(), initial_sum_of_costs, runtime, init_algo_name);
@@ -294,10 +438,22 @@ bool GlobalManager::_run_async(TimeLimiter & time_limiter) {
         return false;
     }
 
-    g_timer.record_p("lns_opt_s");
+    g_timer.record_p(timer_prefix+"lns_opt_s");
+    commit_stats.reset();
+    double elapse_before_opt=time_limiter.get_elapse();
 
     //std::cout<<"num_threads: "<<num_threads<<" "<<neighbor_generators.size()<<std::endl;
 
+    thread_stats.resize(num_threads);
+    for (auto & stats: thread_stats) {
+        stats.num_of_failures=0;
+        stats.iterations.clear();
+    }
+
+    if (!priority_agents.empty()) {
+        replan_priority_agents(time_limiter);
+    }
+
 
     #pragma omp parallel for
     for (int i=0;i<num_threads;++i) {
@@ -313,7 +469,7 @@ bool GlobalManager::_run_async(TimeLimiter & time_limiter) {
                 break;
 
             // 1. generate neighbor
-            Neighbor neighbor=neighbor_generators[i]->generate(time_limiter,i);
+            Neighbor & neighbor=neighbor_generators[i]->generate(time_limiter,i);
                 // for (auto aid:neighbor.agents) {
                 //     cout<<aid<<" ";
                 // }
@@ -333,69 +489,107 @@ bool GlobalManager::_run_async(TimeLimiter & time_limiter) {
             //     }
             // }
 
+            std::chrono::steady_clock::time_point replan_start;
+            if (telemetry!=nullptr) {
+                replan_start=std::chrono::steady_clock::now();
+            }
             local_optimizers[i]->optimize(neighbor, time_limiter);
             if (time_limiter.timeout())
                 break;
 
+            float replan_ms=0;
+            if (telemetry!=nullptr) {
+                replan_ms=std::chrono::duration<float,std::milli>(std::chrono::steady_clock::now()-replan_start).count();
+            }
+
             // cout<<"optimized"<<endl;
 
             // 3. update path table, statistics & maybe adjust strategies
-            #pragma omp critical
+            // the destroy weights are per thread in async mode.
+            neighbor_generators[i]->update(neighbor);
+            if (time_limiter.timeout())
+                break;
+
+            // commit() swaps an accepted neighbor into the commit log, so read it before.
+            int group_size=(int)neighbor.agents.size();
+            int selected_neighbor=neighbor.selected_neighbor;
+            float cost_delta=0;
+            uint64_t wait_ns=0;
+            commit_result result;
+            if (neighbor.succ) {
+                result=commit(neighbor,cost_delta,wait_ns);
+            } else {
+                // runPP stops as soon as the new paths cost no less than the old ones.
+                result=neighbor.sum_of_costs>=neighbor.old_sum_of_costs?REPLAN_NOT_CHEAPER:REPLAN_FAILED;
+            }
+            bool committed=result==ACCEPTED;
+
             {
-                // for (int i=0;i<1;++i) {
-                    // if (time_limiter.timeout())
-                    //     break;
-
-                    // update alns
-                    // auto & neighbor_ptr=neighbor_generators[i]->neighbors[i];
-                    // auto & neighbor=*neighbor_ptr;
-                    if (!time_limiter.timeout()){
-                        neighbor_generators[i]->update(neighbor);
-                    }
-                    // if (time_limiter.timeout())
-                    //     break;
+                commit_stats.wait_ns+=wait_ns;
 
-                    if (!time_limiter.timeout()){
-                        update(neighbor,true);
-                    }
-                    // if (time_limiter.timeout())
-                    //     break;
-
-                    if (!time_limiter.timeout()){
-                        if (!neighbor.succ) {
-                            ++num_of_failures;
-                        } else {
-                            for (int j=0;j<num_threads;++j) {
-                                updating_queues[j].push_back(neighbor);
-                            }
-                        }
-
-                        local_optimizers[i]->updating_queue=updating_queues[i];
-                        updating_queues[i].clear();
-
-                        elapse=time_limiter.get_elapse();
-                        if (screen >= 1)
-                            cout << "Iteration " << iteration_stats.size() << ", "
-                                << "group size = " << neighbor.agents.size() << ", "
-                                << "solution cost = " << sum_of_costs << ", "
-                                << "remaining time = " << time_limiter.time_limit-elapse << endl;
-                        iteration_stats.emplace_back(neighbor.agents.size(), sum_of_costs, elapse, replan_algo_name);
-                    }
-                // }
+                auto & stats=thread_stats[i];
+                if (!committed) {
+                    ++stats.num_of_failures;
+                }
+
+                double iteration_elapse=time_limiter.get_elapse();
+                if (screen >= 1)
+                    cout << "Thread " << i << " iteration " << stats.iterations.size() << ", "
+                        << "group size = " << group_size << ", "
+                        << "cost delta = " << cost_delta << ", "
+                        << "remaining time = " << time_limiter.time_limit-iteration_elapse << endl;
+                stats.iterations.push_back({group_size, cost_delta, iteration_elapse});
             }
 
-            // synchonize to local optimizer
+            if (telemetry!=nullptr) {
+                TelemetryRecord record;
+                record.thread=i;
+                record.iteration=ctr-1;
+                record.elapse=(float)time_limiter.get_elapse();
+                record.neighbor_size=group_size;
+                record.selected_neighbor=selected_neighbor;
+                record.n_expanded=local_optimizers[i]->n_expanded;
+                record.replan_ms=replan_ms;
+                record.result=result;
+                record.commit_wait_ms=(float)((double)wait_ns/1e6);
+                record.cost_delta=cost_delta;
+                telemetry->record(i,record);
+            }
+
+            // synchonize to local optimizer, without blocking the other threads' commits.
             if (time_limiter.timeout())
                 break;
-            for (auto & _neighbor: local_optimizers[i]->updating_queue) {
-                if (time_limiter.timeout())
-                    break;
-                local_optimizers[i]->update(_neighbor);
-            }
-            local_optimizers[i]->updating_queue.clear();
+            local_optimizers[i]->sync(commit_log, time_limiter);
         }
     }
-    g_timer.record_d("lns_opt_s","lns_opt");
+    g_timer.record_d(timer_prefix+"lns_opt_s",timer_prefix+"lns_opt");
+
+    // the solution is read from agents after the run.
+    path_store.flush();
+
+    // merge the threads' statistics in the order the iterations finished.
+    std::vector<ThreadIteration> iterations;
+    for (auto & stats: thread_stats) {
+        num_of_failures+=stats.num_of_failures;
+        iterations.insert(iterations.end(),stats.iterations.begin(),stats.iterations.end());
+    }
+    std::sort(iterations.begin(),iterations.end(),[](const ThreadIteration & a, const ThreadIteration & b) {
+        return a.elapse<b.elapse;
+    });
+    for (auto & iteration: iterations) {
+        sum_of_costs+=iteration.cost_delta;
+        iteration_stats.emplace_back(iteration.group_size, sum_of_costs, iteration.elapse, replan_algo_name);
+    }
+
+    double opt_time=std::max(time_limiter.get_elapse()-elapse_before_opt,1e-9);
+    DEV_DEBUG("{}LNS commits: {} attempts, {:.1f} commits/s, {} committed, {} invalid, {} aborts ({:.1f}%), {} dropped, {:.3f}ms waiting",
+        timer_prefix, commit_stats.n_attempts.load(), (double)commit_stats.n_commits/opt_time, commit_stats.n_commits.load(), commit_stats.n_invalid.load(),
+        commit_stats.n_aborts.load(), 100.0*(double)commit_stats.n_aborts/(double)std::max(commit_stats.n_attempts+commit_stats.n_aborts,(size_t)1),
+        commit_stats.n_dropped.load(), (double)commit_stats.wait_ns/1e6);
+
+    if (telemetry!=nullptr) {
+        telemetry->flush();
+    }
 
     average_group_size = - iteration_stats.front().num_of_agents;
     for (const auto& data : iteration_stats)
@@ -425,7 +619,7 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
 
     double elapse=0;
 
-    g_timer.record_p("lns_init_sol_s");
+    g_timer.record_p(timer_prefix+"lns_init_sol_s");
     sum_of_distances = 0;
     for (const auto & agent : agents)
     {
@@ -434,23 +628,10 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
 
     // 0. get initial solution
     Neighbor init_neighbor;
-    init_neighbor.agents.resize(agents.size());
-    for (int i=0;i<agents.size();++i) {
-        init_neighbor.agents[i]=i;
-    }
-    getInitialSolution(init_neighbor);
-
-    update(init_neighbor,false);
-    // synchonize to local optimizer
-    ONLYDEV(g_timer.record_p("init_loc_opt_update_s");)
-    #pragma omp parallel for
-    for (int i=0;i<num_threads;++i) {
-        local_optimizers[i]->update(init_neighbor);
-    }
-    ONLYDEV(g_timer.record_d("init_loc_opt_update_s","init_loc_opt_update");)
+    init_solution(init_neighbor);
         
 
-    bool runtime=g_timer.record_d("lns_init_sol_s","lns_init_sol");
+    bool runtime=g_timer.record_d(timer_prefix+"lns_init_sol_s",timer_prefix+"lns_init_sol");
 
     elapse=time_limiter.get_elapse();
     iteration_stats.emplace_back(agents.size(), initial_sum_of_costs, runtime, init_algo_name);
@@ -469,15 +650,15 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
         return false;
     }
 
-    g_timer.record_p("lns_opt_s");
+    g_timer.record_p(timer_prefix+"lns_opt_s");
     while (true) {
         if (time_limiter.timeout())
             break;
 
         // 1. generate neighbors
-        g_timer.record_p("neighbor_generate_s");
+        g_timer.record_p(timer_prefix+"neighbor_generate_s");
         neighbor_generator->generate_parallel(time_limiter);
-        g_timer.record_d("neighbor_generate_s","neighbor_generate");
+        g_timer.record_d(timer_prefix+"neighbor_generate_s",timer_prefix+"neighbor_generate");
 
         if (time_limiter.timeout())
             break;
@@ -489,15 +670,14 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
 
         // in the single-thread setting, local_optimizer directly modify paths
         // but we should first recover the path table, then redo it after all local optimizers finishes.
-        g_timer.record_p("loc_opt_s");
+        g_timer.record_p(timer_prefix+"loc_opt_s");
         #pragma omp parallel for
         for (auto i=0;i<neighbor_generator->neighbors.size();++i) {
-            // cerr<<i<<" "<<neighbor_generator.neighbors[i]->agents.size()<<endl;
-            auto & neighbor_ptr = neighbor_generator->neighbors[i];
-            auto & neighbor = *neighbor_ptr;
+            // cerr<<i<<" "<<neighbor_generator.neighbors[i].agents.size()<<endl;
+            auto & neighbor = neighbor_generator->neighbors[i];
             local_optimizers[i]->optimize(neighbor, time_limiter);
         }
-        g_timer.record_d("loc_opt_s","loc_opt");
+        g_timer.record_d(timer_prefix+"loc_opt_s",timer_prefix+"loc_opt");
 
         if (time_limiter.timeout())
             break;
@@ -505,36 +685,34 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
         // : validate solution
 
         // 3. update path_table, statistics & maybe adjust strategies
-        g_timer.record_p("neighbor_update_s");
+        g_timer.record_p(timer_prefix+"neighbor_update_s");
         // : it seems we should not modify neighbor in the previous update
-        for (auto & neighbor_ptr: neighbor_generator->neighbors){
+        for (auto & neighbor: neighbor_generator->neighbors){
             if (time_limiter.timeout()) {
                 break;
             } 
-            auto & neighbor=*neighbor_ptr;
             neighbor_generator->update(neighbor);
         }
-        g_timer.record_d("neighbor_update_s","neighbor_update");
+        g_timer.record_d(timer_prefix+"neighbor_update_s",timer_prefix+"neighbor_update");
 
         if (time_limiter.timeout()) {
             break;
         } 
 
 
-        for (auto & neighbor_ptr: neighbor_generator->neighbors){
+        for (auto & neighbor: neighbor_generator->neighbors){
             if (time_limiter.timeout()) {
                 break;
             } 
-            auto & neighbor=*neighbor_ptr;
             update(neighbor,true);
 
             // synchonize to local optimizer
-            ONLYDEV(g_timer.record_p("loc_opt_update_s");)
+            ONLYDEV(g_timer.record_p(timer_prefix+"loc_opt_update_s");)
             #pragma omp parallel for
             for (int i=0;i<num_threads;++i) {
                 local_optimizers[i]->update(neighbor);
             }
-            ONLYDEV(g_timer.record_d("loc_opt_update_s","loc_opt_update");)
+            ONLYDEV(g_timer.record_d(timer_prefix+"loc_opt_update_s",timer_prefix+"loc_opt_update");)
 
             if (!neighbor.succ) {
                 ++num_of_failures;
@@ -549,7 +727,7 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
             iteration_stats.emplace_back(neighbor.agents.size(), sum_of_costs, elapse, replan_algo_name);
         }
     }
-    g_timer.record_d("lns_opt_s","lns_opt");
+    g_timer.record_d(timer_prefix+"lns_opt_s",timer_prefix+"lns_opt");
 
     // : validate solution
 
@@ -570,29 +748,115 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
     return true;
 }
 
+void GlobalManager::init_solution(Neighbor & init_neighbor) {
+    if (warm_started) {
+        // the paths are in the path tables already, only the costs need to be summed up.
+        initial_sum_of_costs=0;
+        for (auto & agent: agents) {
+            initial_sum_of_costs+=agent.path.path_cost;
+        }
+        sum_of_costs=initial_sum_of_costs;
+        init_neighbor.succ=true;
+        return;
+    }
+
+    init_neighbor.agents.resize(agents.size());
+    for (int i=0;i<agents.size();++i) {
+        init_neighbor.agents[i]=i;
+    }
+    init_neighbor.reset_paths();
+    getInitialSolution(init_neighbor);
+
+    update(init_neighbor,false);
+
+    // synchonize to local optimizer
+    ONLYDEV(g_timer.record_p(timer_prefix+"init_loc_opt_update_s");)
+    #pragma omp parallel for
+    for (int i=0;i<num_threads;++i) {
+        local_optimizers[i]->update(init_neighbor);
+    }
+    ONLYDEV(g_timer.record_d(timer_prefix+"init_loc_opt_update_s",timer_prefix+"init_loc_opt_update");)
+}
+
+void GlobalManager::advance(int steps, const std::vector<int> & changed_agents, std::vector<Path> & new_paths) {
+    path_table.advance(steps, agents, changed_agents, new_paths);
+
+    // the costs of the extended paths change, too.
+    int k=0;
+    for (int i=0;i<agents.size();++i) {
+        check_initial_path(i, agents[i].path);
+        if (k<changed_agents.size() && changed_agents[k]==i) {
+            ++k;
+            continue;
+        }
+        agents[i].path.path_cost=agents[i].getEstimatedPathLength(agents[i].path,instance.goal_locations[i],HT);
+    }
+
+    // it only touches the changed cells, which is cheaper than starting a parallel region.
+    ONLYDEV(g_timer.record_p(timer_prefix+"init_loc_opt_update_s");)
+    for (int i=0;i<num_threads;++i) {
+        local_optimizers[i]->advance();
+    }
+    ONLYDEV(g_timer.record_d(timer_prefix+"init_loc_opt_update_s",timer_prefix+"init_loc_opt_update");)
+
+    if (async) {
+        commit_log.clear();
+    }
+
+    initial_sum_of_costs=MAX_COST;
+    sum_of_costs=MAX_COST;
+    warm_started=true;
+}
+
+void GlobalManager::replan_priority_agents(TimeLimiter & time_limiter) {
+    Neighbor neighbor;
+    neighbor.agents=priority_agents;
+    neighbor.reset_paths();
+    priority_agents.clear();
+
+    local_optimizers[0]->optimize(neighbor, time_limiter);
+
+    // the other threads are not started yet, so the commit can only fail if the new paths are not cheaper.
+    float cost_delta=0;
+    uint64_t wait_ns=0;
+    bool committed=neighbor.succ && commit(neighbor,cost_delta,wait_ns)==ACCEPTED;
+    auto & stats=thread_stats[0];
+    if (!committed) {
+        ++stats.num_of_failures;
+    }
+    stats.iterations.push_back({(int)neighbor.agents.size(), cost_delta, time_limiter.get_elapse()});
+    if (screen >= 1)
+        cout << "replanned " << neighbor.agents.size() << " priority agents: "
+            << (committed?"committed":"not committed") << ", cost delta = " << cost_delta << endl;
+}
+
+void GlobalManager::check_initial_path(int i, Path & path) {
+    if (path.back().location!=instance.goal_locations[i] && path.size()<=window_size_for_CT) {
+        cerr<<"A precomputed agent "<<i<<"'s path "<<path.size()
+            <<" should be longer than window size for CT "<<window_size_for_CT
+            <<" unless it arrives at its goal:"<<path.back().location
+            <<" vs "<<instance.goal_locations[i]<<endl;
+        exit(-1);
+    }
+
+    if (path.back().location!=instance.goal_locations[i] && path.size()!=window_size_for_PATH+1) {
+        cerr<<"we require agent either arrives at its goal earlier or has a planned path of length window_size_for_PATH. "<<path.size()<<" vs "<<window_size_for_PATH<<endl;
+        exit(-1);
+    }
+}
+
 void GlobalManager::getInitialSolution(Neighbor & neighbor) {
     // currently, we only support initial solution directly passed in.
     neighbor.old_sum_of_costs=0;
     neighbor.sum_of_costs=0;
     for (int i=0;i<agents.size();++i) {
         // cerr<<agents[i].id<<" "<< agents[i].path.size()-1<<endl;
-        if (agents[i].path.back().location!=instance.goal_locations[i] && agents[i].path.size()<=window_size_for_CT) {
-            cerr<<"A precomputed agent "<<i<<"'s path "<<agents[i].path.size()
-                <<" should be longer than window size for CT "<<window_size_for_CT
-                <<" unless it arrives at its goal:"<<agents[i].path.back().location
-                <<" vs "<<instance.goal_locations[i]<<endl;
-            exit(-1);
-        }
-
-        if (agents[i].path.back().location!=instance.goal_locations[i] && agents[i].path.size()!=window_size_for_PATH+1) {
-            cerr<<"we require agent either arrives at its goal earlier or has a planned path of length window_size_for_PATH. "<<agents[i].path.size()<<" vs "<<window_size_for_PATH<<endl;
-            exit(-1);
-        }
+        check_initial_path(i, agents[i].path);
 
         neighbor.sum_of_costs+=agents[i].path.path_cost;
 
+        // the slot of agent i is i.
         neighbor.m_paths[i]=agents[i].path;
-        neighbor.m_old_paths[i]=Path();
         // cerr<<agents[i].id<<" "<< agents[i].path.size()-1<<endl;
     }
 
@@ -7,46 +7,72 @@ namespace LNS {
 namespace Parallel {
 
 LocalOptimizer::LocalOptimizer(
-    Instance & instance, std::vector<Agent> & agents, std::shared_ptr<HeuristicTable> HT, 
-    std::shared_ptr<vector<float> > map_weights, std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos,
+    Instance & instance, const PathTable & global_path_table, std::vector<Agent> & agents, const PathStore & path_store,
+    std::shared_ptr<HeuristicTable> HT, std::shared_ptr<vector<float> > map_weights, std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos,
     string replan_algo_name, bool sipp,
     int window_size_for_CT, int window_size_for_CAT, int window_size_for_PATH, int execution_window,
+    int congestion_region_size,
     bool has_disabled_agents,
     int screen,
     int random_seed
 ):
-    instance(instance), path_table(instance.map_size,window_size_for_CT), HT(HT), map_weights(map_weights), agent_infos(agent_infos),
+    instance(instance), path_table(&global_path_table,window_size_for_CT), agents(agents), path_store(path_store), HT(HT), map_weights(map_weights), agent_infos(agent_infos),
     replan_algo_name(replan_algo_name),
     window_size_for_CT(window_size_for_CT), window_size_for_CAT(window_size_for_CAT), window_size_for_PATH(window_size_for_PATH),
     has_disabled_agents(has_disabled_agents),
     screen(screen), MT(random_seed) {
 
     // : for agent_id, we just use 0 to initialize the path planner. but we need to change it (also starts and goals) everytime before planning
-    path_planner = std::make_shared<TimeSpaceAStarPlanner>(instance, HT, map_weights, execution_window);
+    if (sipp) {
+        sipp_planner = std::make_shared<SIPPPlanner>(instance, HT, map_weights, execution_window);
+    } else {
+        path_planner = std::make_shared<TimeSpaceAStarPlanner>(instance, HT, map_weights, execution_window);
+    }
 
-    for (int i=0;i<instance.num_of_agents;++i) {
-        this->agents.emplace_back(i,instance,HT,agent_infos);
+    if (congestion_region_size>0) {
+        congestion_index = std::make_shared<CongestionIndex>(instance, congestion_region_size, window_size_for_PATH+1);
     }
 
 }
 
 void LocalOptimizer::reset() {
     path_table.reset();
+    log_version=0;
+    if (congestion_index!=nullptr) {
+        congestion_index->reset();
+    }
     // for (auto & agent: agents) {
     //     agent.reset();
     // }
 }
 
-void LocalOptimizer::update(Neighbor & neighbor) {
-    if (neighbor.succ) {
-        for (auto & aid: neighbor.agents) {
-            path_table.deletePath(aid, neighbor.m_old_paths[aid]);
+void LocalOptimizer::update(const Neighbor & neighbor) {
+    if (neighbor.succ && congestion_index!=nullptr) {
+        for (int i=0;i<neighbor.agents.size();++i) {
+            int aid=neighbor.agents[i];
+            congestion_index->update(agents[aid], neighbor.m_paths[i]);
         }
+    }
+}
 
-        for (auto & aid: neighbor.agents) {
-            path_table.insertPath(aid, neighbor.m_paths[aid]);
-            agents[aid].path = neighbor.m_paths[aid];
-        }
+bool LocalOptimizer::sync(const CommitLog & log, const TimeLimiter & time_limiter) {
+    if (congestion_index==nullptr) {
+        return true;
+    }
+    // entries still being written by other threads are picked up next time.
+    while (const Neighbor * neighbor=log.try_get(log_version)) {
+        if (time_limiter.timeout())
+            return false;
+        update(*neighbor);
+        ++log_version;
+    }
+    return true;
+}
+
+void LocalOptimizer::advance() {
+    log_version=0;
+    if (congestion_index!=nullptr) {
+        congestion_index->update(agents);
     }
 }
 
@@ -54,21 +80,22 @@ void LocalOptimizer::prepare(Neighbor & neighbor) {
     // store the neighbor information
     //ONLYDEV(g_timer.record_p("store_neighbor_info_s");)
     neighbor.old_sum_of_costs = 0;
-    for (auto & aid: neighbor.agents)
+    for (int i=0;i<neighbor.agents.size();++i)
     {
-        auto & agent=agents[aid];
+        int aid=neighbor.agents[i];
         if (replan_algo_name == "PP")
-            neighbor.m_old_paths[aid] = agent.path;
+            neighbor.m_old_paths[i] = path_store.get(aid);
         // path_table.deletePath(neighbor.agents[i], agent.path);
-        neighbor.old_sum_of_costs += agent.path.path_cost;
-        path_table.deletePath(aid, neighbor.m_old_paths[aid]);
-    }   
+        neighbor.old_sum_of_costs += neighbor.m_old_paths[i].path_cost;
+        path_table.hide(aid, neighbor.m_old_paths[i]);
+    }
 
     //ONLYDEV(g_timer.record_d("store_neighbor_info_s","store_neighbor_info_e","store_neighbor_info");)    
 }
 
 void LocalOptimizer::optimize(Neighbor & neighbor, const TimeLimiter & time_limiter) {
 
+    n_expanded=0;
     prepare(neighbor);
 
     // replan
@@ -95,23 +122,27 @@ void LocalOptimizer::optimize(Neighbor & neighbor, const TimeLimiter & time_limi
 bool LocalOptimizer::runPP(Neighbor & neighbor, const TimeLimiter & time_limiter)
 {
     //ONLYDEV(g_timer.record_p("run_pp_s");)
-    auto shuffled_agents = neighbor.agents;
-    std::shuffle(shuffled_agents.begin(), shuffled_agents.end(), MT);
+    // the slots of the agents in the order of planning.
+    shuffled_slots.resize(neighbor.agents.size());
+    for (int i=0;i<shuffled_slots.size();++i) {
+        shuffled_slots[i]=i;
+    }
+    std::shuffle(shuffled_slots.begin(), shuffled_slots.end(), MT);
 
     if (has_disabled_agents) {
-        std::stable_sort(shuffled_agents.begin(), shuffled_agents.end(), [&](int a, int b) {
-            return (*agent_infos)[a].disabled<(*agent_infos)[b].disabled; // not disabled first.
+        std::stable_sort(shuffled_slots.begin(), shuffled_slots.end(), [&](int a, int b) {
+            return (*agent_infos)[neighbor.agents[a]].disabled<(*agent_infos)[neighbor.agents[b]].disabled; // not disabled first.
         });
     }
     // TODO: we need also to remove the cost of disabled agents.
 
     if (screen >= 2) {
-        for (auto aid : shuffled_agents)
-            cout << aid << "(" << agents[aid].getNumOfDelays()<<"), ";
+        for (auto slot : shuffled_slots)
+            cout << neighbor.agents[slot] << "(" << agents[neighbor.agents[slot]].getNumOfDelays(neighbor.m_old_paths[slot])<<"), ";
         cout << endl;
     }
-    int remaining_agents = (int)shuffled_agents.size();
-    auto p = shuffled_agents.begin();
+    int remaining_agents = (int)shuffled_slots.size();
+    auto p = shuffled_slots.begin();
     neighbor.sum_of_costs = 0;
     CBSNode node;
     int suboptimality=1.2;
@@ -125,11 +156,13 @@ bool LocalOptimizer::runPP(Neighbor & neighbor, const TimeLimiter & time_limiter
     //     constraint_table.length_min=window_size_for_PATH;
     // }
 
-    while (p != shuffled_agents.end()) {
+    while (p != shuffled_slots.end()) {
         if (time_limiter.timeout())
             break;
 
-        int id = *p;
+        int slot = *p;
+        int id = neighbor.agents[slot];
+        auto & path = neighbor.m_paths[slot];
         int start_pos=instance.start_locations[id];
         int start_orient=instance.start_orientations[id];
         int goal_pos=instance.goal_locations[id];
@@ -140,67 +173,64 @@ bool LocalOptimizer::runPP(Neighbor & neighbor, const TimeLimiter & time_limiter
                  << "Agent " << agents[id].id << endl;
         if (search_priority==1) {
             //ONLYDEV(g_timer.record_p("findPath_s");)
-            path_planner->findPath(start_pos,start_orient,goal_pos,constraint_table, time_limiter);
-            neighbor.m_paths[id] = path_planner->path;
+            if (sipp_planner!=nullptr) {
+                sipp_planner->findPath(start_pos,start_orient,goal_pos,constraint_table, time_limiter);
+                path = sipp_planner->path;
+                n_expanded += sipp_planner->n_expanded;
+            } else {
+                path_planner->findPath(start_pos,start_orient,goal_pos,constraint_table, time_limiter);
+                path = path_planner->path;
+                n_expanded += path_planner->n_expanded;
+            }
             //ONLYDEV(g_timer.record_d("findPath_s","findPath_e","findPath");)
         } else if (search_priority==2) {
             std::cerr<<"not supported now, need double checks"<<std::endl;
             exit(-1);
             // vector<Path *> paths(agents.size(),nullptr);
             // int min_f_val;
-            // tie(neighbor.m_paths[id],min_f_val) = path_planner->findSuboptimalPath(node, constraint_table, paths, agents[id].id, 0,suboptimality);
+            // tie(path,min_f_val) = path_planner->findSuboptimalPath(node, constraint_table, paths, agents[id].id, 0,suboptimality);
         }
-        if (neighbor.m_paths[id].empty()) break;
+        if (path.empty()) break;
         
         // always makes a fixed length.
         // : this might not be a smart choice, but it keeps everything consistent.
-        // if (neighbor.m_paths[id].size()>constraint_table.window_size_for_PATH+1) {
-        //     neighbor.m_paths[id].nodes.resize(constraint_table.window_size_for_PATH+1);
+        // if (path.size()>constraint_table.window_size_for_PATH+1) {
+        //     path.nodes.resize(constraint_table.window_size_for_PATH+1);
         // }
 
         // do we need to pad here?
         // assume hold goal location
-        // if (neighbor.m_paths[id].size()<constraint_table.window_size_for_PATH+1) {
-        //     neighbor.m_paths[id].nodes.resize(constraint_table.window_size_for_PATH+1,neighbor.m_paths[id].nodes.back());
+        // if (path.size()<constraint_table.window_size_for_PATH+1) {
+        //     path.nodes.resize(constraint_table.window_size_for_PATH+1,path.nodes.back());
         // }
 
-        if (neighbor.m_paths[id].back().location!=agents[id].getGoalLocation()) {
-            if (neighbor.m_paths[id].size()!=constraint_table.window_size_for_PATH+1) {
-                std::cerr<<"agent "<<agents[id].id<<"'s path length "<<neighbor.m_paths[id].size()<<" should be equal to window size for path "<<constraint_table.window_size_for_PATH<< "if it doesn't arrive at its goal"<<endl;
+        if (path.back().location!=agents[id].getGoalLocation()) {
+            if (path.size()!=constraint_table.window_size_for_PATH+1) {
+                std::cerr<<"agent "<<agents[id].id<<"'s path length "<<path.size()<<" should be equal to window size for path "<<constraint_table.window_size_for_PATH<< "if it doesn't arrive at its goal"<<endl;
                 exit(-1);
             } 
         }
 
-        // float _path = agents[id].getEstimatedPathLength(neighbor.m_paths[id], goal_pos, HT);
-        // if (_path!=neighbor.m_paths[id].path_cost) {
-        //     std::cerr<<"path cost "<<neighbor.m_paths[id].path_cost<<" is not equal to estimated path cost "<<_path<<std::endl;
+        // float _path = agents[id].getEstimatedPathLength(path, goal_pos, HT);
+        // if (_path!=path.path_cost) {
+        //     std::cerr<<"path cost "<<path.path_cost<<" is not equal to estimated path cost "<<_path<<std::endl;
         //     exit(-1);
         // }
-        neighbor.m_paths[id].path_cost = agents[id].getEstimatedPathLength(neighbor.m_paths[id], goal_pos, HT);
-        neighbor.sum_of_costs += neighbor.m_paths[id].path_cost;
+        path.path_cost = agents[id].getEstimatedPathLength(path, goal_pos, HT);
+        neighbor.sum_of_costs += path.path_cost;
 
         if (neighbor.sum_of_costs >= neighbor.old_sum_of_costs){
             // because it is not inserted into path table yet.
-            neighbor.m_paths[id].clear();
+            path.clear();
             break;
         }
         remaining_agents--;
-        path_table.insertPath(agents[id].id, neighbor.m_paths[id]);
+        path_table.insertPath(agents[id].id, path);
         ++p;
     }
 
-    // remove any insertion from new paths
-    for (auto & aid: neighbor.agents) {
-        path_table.deletePath(aid, neighbor.m_paths[aid]);
-    }
-
-    // restore old paths
-    if (!neighbor.m_old_paths.empty())
-    {
-        for (auto & aid : neighbor.agents) {
-            path_table.insertPath(aid, neighbor.m_old_paths[aid]);
-        }
-    }
+    // remove any insertion from new paths and show the old paths again.
+    path_table.clear_view();
     //ONLYDEV(g_timer.record_d("run_pp_s","run_pp_e","run_pp");)
 
 
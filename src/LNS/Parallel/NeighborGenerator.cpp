@@ -11,18 +11,19 @@ namespace Parallel {
 
 NeighborGenerator::NeighborGenerator(
     Instance & instance, std::shared_ptr<HeuristicTable> HT, PathTable & path_table, 
-    std::vector<Agent> & agents, std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos,
+    std::vector<Agent> & agents, const PathStore & path_store, std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos,
+    CongestionIndex * congestion_index,
     int neighbor_size, destroy_heuristic destroy_strategy, 
     bool ALNS, double decay_factor, double reaction_factor, 
     int num_threads, bool fix_ng_bug, int screen, int random_seed
 ):
     instance(instance), HT(HT), path_table(path_table), 
-    agents(agents), agent_infos(agent_infos),
+    agents(agents), path_store(path_store), agent_infos(agent_infos), congestion_index(congestion_index),
     neighbor_size(neighbor_size), destroy_strategy(destroy_strategy),
     ALNS(ALNS), decay_factor(decay_factor), reaction_factor(reaction_factor),
-    num_threads(num_threads), fix_ng_bug(fix_ng_bug), screen(screen), MT(random_seed) {
+    num_threads(num_threads), fix_ng_bug(fix_ng_bug), screen(screen) {
 
-    destroy_weights.assign(DESTORY_COUNT,1);
+    reset_destroy_weights();
 
     // if (intersections.empty())
     // {
@@ -34,12 +35,23 @@ NeighborGenerator::NeighborGenerator(
     // }
 
     tabu_list_list.resize(num_threads);
+    for (int i = 0; i < num_threads; i++)
+        MTs.emplace_back(random_seed + i);
+    search_buffers.resize(num_threads);
     neighbors.resize(num_threads);
 
 }
 
-void NeighborGenerator::reset() {
+void NeighborGenerator::reset_destroy_weights() {
     destroy_weights.assign(DESTORY_COUNT,1);
+    if (congestion_index==nullptr) {
+        // never chosen by ALNS.
+        destroy_weights[3]=0;
+    }
+}
+
+void NeighborGenerator::reset() {
+    reset_destroy_weights();
     for (auto & tabu_list:tabu_list_list) {
         tabu_list.clear();
     }
@@ -66,17 +78,17 @@ void NeighborGenerator::update(Neighbor & neighbor){
 }
 
 void NeighborGenerator::generate_parallel(const TimeLimiter & time_limiter) {
-    // : since here we use parallel, we need a random seed generator that support parallelization, that is why we only could use rand() but not rand(), but we can fix this later.
+    // each idx draws from its own MTs[idx], so the threads neither share a generator nor take the global lock of rand().
     #pragma omp parallel for
     for (int i = 0; i < num_threads; i++) {
         generate(time_limiter,i);
     }
 }
 
-Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
-    std::shared_ptr<Neighbor> neighbor_ptr = std::make_shared<Neighbor>();
-    Neighbor & neighbor = *neighbor_ptr;
-    //Neighbor neighbor;
+Neighbor & NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
+    Neighbor & neighbor = neighbors[idx];
+    neighbor.agents.clear();
+    neighbor.succ = false;
     // cout<<"start generate neighbor"<<endl;
     bool succ=false;
     while (!succ){
@@ -84,7 +96,7 @@ Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
             break;
 
         if (ALNS)
-            chooseDestroyHeuristicbyALNS();
+            chooseDestroyHeuristicbyALNS(idx);
 
         // ONLYDEV(g_timer.record_p("generate_neighbor_s");)
         switch (destroy_strategy)
@@ -97,10 +109,16 @@ Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
                 }
             case INTERSECTION:
                 {
-                    succ = generateNeighborByIntersection(neighbor);
+                    succ = generateNeighborByIntersection(neighbor,idx);
                     neighbor.selected_neighbor = 1;
                     break;
                 }
+            case CONGESTION:
+                {
+                    succ = generateNeighborByCongestion(neighbor,idx);
+                    neighbor.selected_neighbor = 3;
+                    break;
+                }
             case RANDOMAGENTS:
                 // : this implementation is too bad
                 // neighbor.agents.resize(agents.size());
@@ -114,13 +132,9 @@ Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
                 // succ = true;
                 // neighbor.selected_neighbor = 2;
                 {
-                    auto s=std::set<int>();
-                    while (s.size()<neighbor_size) {
-                        s.insert(rand()%agents.size());
+                    while (neighbor.agents.size()<neighbor_size) {
+                        insert_sorted(neighbor.agents, (int)(MTs[idx]()%agents.size()));
                     }
-                    for (auto i:s) {
-                        neighbor.agents.push_back(i);
-                    } 
                     succ = true;
                     neighbor.selected_neighbor = 2;
                     break;
@@ -153,25 +167,26 @@ Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
     //     }
     // }
 
-    neighbors[idx]=neighbor_ptr;
+    neighbor.reset_paths();
 
     return neighbor;
 
 
 }
 
-void NeighborGenerator::chooseDestroyHeuristicbyALNS() {
-    int selected_neighbor=rouletteWheel();
+void NeighborGenerator::chooseDestroyHeuristicbyALNS(int idx) {
+    int selected_neighbor=rouletteWheel(idx);
     switch (selected_neighbor)
     {
         case 0 : destroy_strategy = RANDOMWALK; break;
         case 1 : destroy_strategy = INTERSECTION; break;
         case 2 : destroy_strategy = RANDOMAGENTS; break;
+        case 3 : destroy_strategy = CONGESTION; break;
         default : cerr << "ERROR" << endl; exit(-1);
     }
 }
 
-int NeighborGenerator::rouletteWheel()
+int NeighborGenerator::rouletteWheel(int idx)
 {
     double sum = 0;
     for (const auto& h : destroy_weights)
@@ -183,7 +198,8 @@ int NeighborGenerator::rouletteWheel()
             cout << h / sum << ",";
         cout << endl;
     }
-    double r = (double) rand() / RAND_MAX;
+    // the generators run in parallel, so it uses their own MTs instead of rand(), which takes a global lock.
+    double r = std::uniform_real_distribution<double>(0,1)(MTs[idx]);
     double threshold = destroy_weights[0];
     int selected_neighbor = 0;
     while (threshold < r * sum)
@@ -207,23 +223,25 @@ bool NeighborGenerator::generateNeighborByRandomWalk(Neighbor & neighbor, int id
     if (a < 0)
         return false;
     
-    set<int> neighbors_set;
-    neighbors_set.insert(a);
-    randomWalk(a, 0, neighbors_set, neighbor_size);
+    // collected in place, it is sorted like a set.
+    auto & neighbors_set = neighbor.agents;
+    neighbors_set.clear();
+    insert_sorted(neighbors_set, a);
+    randomWalk(a, 0, neighbors_set, neighbor_size, idx);
 
     // : we iterate for at most 10 iterations (not shown in the pseudo-code) to 
     // address the situation where the agent density is too low for us to collect N agents
     int count = 0;
     while (neighbors_set.size() < neighbor_size && count < 10) {
-        int t = rand() % agents[a].path.size();
-        randomWalk(a, t, neighbors_set, neighbor_size);
+        int t = (int)(MTs[idx]() % path_store.get(a).size());
+        randomWalk(a, t, neighbors_set, neighbor_size, idx);
         count++;
         // select the next agent randomly
-        int idx = rand() % neighbors_set.size();
+        int k = (int)(MTs[idx]() % neighbors_set.size());
         int i = 0;
         for (auto n : neighbors_set)
         {
-            if (i == idx)
+            if (i == k)
             {
                 a = i;
                 break;
@@ -246,53 +264,59 @@ bool NeighborGenerator::generateNeighborByRandomWalk(Neighbor & neighbor, int id
     //     }
     // }
 
-    if (neighbors_set.size() < 2)
+    if (neighbors_set.size() < 2) {
+        neighbors_set.clear();
         return false;
+    }
 
-    neighbor.agents.assign(neighbors_set.begin(), neighbors_set.end());
     if (screen >= 2)
         cout << "Generate " << neighbor.agents.size() << " neighbors by random walks of agent " << a
              << "(" << HT->get(agents[a].getStartLocation(),agents[a].getStartOrientation(),agents[a].getGoalLocation())
-             << "->" << agents[a].path.size() - 1 << ")" << endl;
+             << "->" << path_store.get(a).size() - 1 << ")" << endl;
 
     return true;
 }
 
-bool NeighborGenerator::generateNeighborByIntersection(Neighbor & neighbor) {
-    set<int> neighbors_set;
-    auto pt = intersections.begin();
-    std::advance(pt, rand() % intersections.size());
-    int location = *pt;
-    path_table.get_agents(neighbors_set, neighbor_size, location);
+bool NeighborGenerator::generateNeighborByIntersection(Neighbor & neighbor, int idx) {
+    // collected in place, it is sorted like a set.
+    auto & neighbors_set = neighbor.agents;
+    neighbors_set.clear();
+    int location = intersections[MTs[idx]() % intersections.size()];
+    path_table.get_agents(neighbors_set, neighbor_size, location, MTs[idx]);
     if (neighbors_set.size() < neighbor_size)
     {
-        set<int> closed;
-        closed.insert(location);
-        std::queue<int> open;
-        open.push(location);
-        while (!open.empty() && (int) neighbors_set.size() < neighbor_size)
+        // a BFS, open is a FIFO queue from its head.
+        auto & closed = search_buffers[idx].closed;
+        auto & open = search_buffers[idx].open;
+        closed.clear();
+        insert_sorted(closed, location);
+        open.clear();
+        open.push_back(location);
+        size_t head = 0;
+        while (head < open.size() && (int) neighbors_set.size() < neighbor_size)
         {
-            int curr = open.front();
-            open.pop();
-            for (auto next : instance.getNeighbors(curr))
+            int curr = open[head++];
+            int next_locs[4];
+            int n_next_locs = instance.getNeighbors(curr, next_locs);
+            for (int k = 0; k < n_next_locs; ++k)
             {
-                if (closed.count(next) > 0)
+                int next = next_locs[k];
+                if (contains_sorted(closed, next))
                     continue;
-                open.push(next);
-                closed.insert(next);
+                open.push_back(next);
+                insert_sorted(closed, next);
                 if (instance.getDegree(next) >= 3)
                 {
-                    path_table.get_agents(neighbors_set, neighbor_size, next);
+                    path_table.get_agents(neighbors_set, neighbor_size, next, MTs[idx]);
                     if ((int) neighbors_set.size() == neighbor_size)
                         break;
                 }
             }
         }
     }
-    neighbor.agents.assign(neighbors_set.begin(), neighbors_set.end());
     if (neighbor.agents.size() > neighbor_size)
     {
-        std::shuffle(neighbor.agents.begin(), neighbor.agents.end(),MT);
+        std::shuffle(neighbor.agents.begin(), neighbor.agents.end(),MTs[idx]);
         neighbor.agents.resize(neighbor_size);
     }
     if (screen >= 2)
@@ -300,6 +324,70 @@ bool NeighborGenerator::generateNeighborByIntersection(Neighbor & neighbor) {
     return true;
 }
 
+bool NeighborGenerator::generateNeighborByCongestion(Neighbor & neighbor, int idx) {
+    if (congestion_index==nullptr)
+        return false;
+
+    int region = congestion_index->sample(MTs[idx]);
+    if (region < 0)
+        return false;
+
+    // collected in place, it is sorted like a set.
+    auto & neighbors_set = neighbor.agents;
+    neighbors_set.clear();
+    int n_cols = congestion_index->n_region_cols;
+    int n_rows = congestion_index->n_region_rows;
+    int rx = region % n_cols;
+    int ry = region / n_cols;
+    for (int ring = 0; ring <= max_congestion_rings && (int) neighbors_set.size() < neighbor_size; ++ring)
+    {
+        for (int y = std::max(ry - ring, 0); y <= std::min(ry + ring, n_rows - 1); ++y)
+        {
+            for (int x = std::max(rx - ring, 0); x <= std::min(rx + ring, n_cols - 1); ++x)
+            {
+                // only the regions on the ring
+                if (std::max(std::abs(x - rx), std::abs(y - ry)) != ring)
+                    continue;
+                get_region_agents(neighbors_set, y * n_cols + x, idx);
+                if ((int) neighbors_set.size() >= neighbor_size)
+                    break;
+            }
+            if ((int) neighbors_set.size() >= neighbor_size)
+                break;
+        }
+    }
+
+    if (neighbors_set.size() < 2) {
+        neighbors_set.clear();
+        return false;
+    }
+
+    if (neighbor.agents.size() > neighbor_size)
+    {
+        std::shuffle(neighbor.agents.begin(), neighbor.agents.end(),MTs[idx]);
+        neighbor.agents.resize(neighbor_size);
+    }
+    if (screen >= 2)
+        cout << "Generate " << neighbor.agents.size() << " neighbors by congestion of region " << region << endl;
+    return true;
+}
+
+void NeighborGenerator::get_region_agents(vector<int> & neighbors_set, int region, int idx) {
+    int x0, y0, x1, y1;
+    congestion_index->get_region(region, x0, y0, x1, y1);
+    int w = x1 - x0;
+    int n_cells = w * (y1 - y0);
+    int offset = (int)(MTs[idx]() % (unsigned)n_cells);
+    for (int i = 0; i < n_cells && (int) neighbors_set.size() < neighbor_size; ++i)
+    {
+        int cell = (offset + i) % n_cells;
+        int loc = (y0 + cell / w) * instance.num_of_cols + x0 + cell % w;
+        if (instance.isObstacle(loc))
+            continue;
+        path_table.get_agents(neighbors_set, neighbor_size, loc, MTs[idx]);
+    }
+}
+
 int NeighborGenerator::findMostDelayedAgent(int idx){
     int a = -1;
     float max_delays = -1;
@@ -308,13 +396,13 @@ int NeighborGenerator::findMostDelayedAgent(int idx){
     {
         // : currently we just use index to split threads
         if (i%num_threads!=idx) continue;
-        if (tabu_list.find(i) != tabu_list.end())
+        if (contains_sorted(tabu_list, i))
             continue;
         if ((*agent_infos)[i].disabled) {
-            tabu_list.insert(i);
+            insert_sorted(tabu_list, i);
             continue;
         }
-        float delays = agents[i].getNumOfDelays();
+        float delays = agents[i].getNumOfDelays(path_store.get(i));
         if (max_delays < delays)
         {
             a = i;
@@ -326,15 +414,15 @@ int NeighborGenerator::findMostDelayedAgent(int idx){
         tabu_list.clear();
         return -1;
     }
-    tabu_list.insert(a);
+    insert_sorted(tabu_list, a);
     // : this is a bug
     if (tabu_list.size() == (agents.size()/num_threads))
         tabu_list.clear();
     return a;
 }
 
-std::list<std::pair<int,int> > NeighborGenerator::getSuccessors(int pos, int orient) {
-    std::list<std::pair<int,int> > successors;
+int NeighborGenerator::getSuccessors(int pos, int orient, std::pair<int,int> * successors) {
+    int n_successors=0;
 
     int & cols=instance.num_of_cols;
     int & rows=instance.num_of_rows;
@@ -351,7 +439,7 @@ std::list<std::pair<int,int> > NeighborGenerator::getSuccessors(int pos, int ori
         if (x+1<cols){
             next_pos=pos+1;
             if (map[next_pos]==0) {
-                successors.emplace_back(next_pos,next_orient);
+                successors[n_successors++]={next_pos,next_orient};
             }
         }
     } else if (orient==1) {
@@ -359,7 +447,7 @@ std::list<std::pair<int,int> > NeighborGenerator::getSuccessors(int pos, int ori
         if (y+1<rows) {
             next_pos=pos+cols;
             if (map[next_pos]==0) {
-                successors.emplace_back(next_pos,next_orient);
+                successors[n_successors++]={next_pos,next_orient};
             }
         }
     } else if (orient==2) {
@@ -367,7 +455,7 @@ std::list<std::pair<int,int> > NeighborGenerator::getSuccessors(int pos, int ori
         if (x-1>=0) {
             next_pos=pos-1;
             if (map[next_pos]==0) {
-                successors.emplace_back(next_pos,next_orient);
+                successors[n_successors++]={next_pos,next_orient};
             }
         }
     } else if (orient==3) {
@@ -375,7 +463,7 @@ std::list<std::pair<int,int> > NeighborGenerator::getSuccessors(int pos, int ori
         if (y-1>=0) {
             next_pos=pos-cols;
             if (map[next_pos]==0) {
-                successors.emplace_back(next_pos,next_orient);
+                successors[n_successors++]={next_pos,next_orient};
             }
         }
     } else {
@@ -389,23 +477,26 @@ std::list<std::pair<int,int> > NeighborGenerator::getSuccessors(int pos, int ori
 
     // CR
     next_orient=(orient+1+n_orients)%n_orients;
-    successors.emplace_back(next_pos, next_orient);
+    successors[n_successors++]={next_pos, next_orient};
 
     // CCR
     next_orient=(orient-1+n_orients)%n_orients;
-    successors.emplace_back(next_pos, next_orient);
+    successors[n_successors++]={next_pos, next_orient};
 
     // W
     next_orient=orient;
-    successors.emplace_back(next_pos, next_orient);
+    successors[n_successors++]={next_pos, next_orient};
     
-    return successors;
+    return n_successors;
 }
 
 // a random walk with path that is shorter than upperbound and has conflicting with neighbor_size agents
-void NeighborGenerator::randomWalk(int agent_id, int start_timestep, set<int>& conflicting_agents, int neighbor_size)
+void NeighborGenerator::randomWalk(int agent_id, int start_timestep, vector<int>& conflicting_agents, int neighbor_size, int idx)
 {
-    auto & path = agents[agent_id].path;
+    auto & path = path_store.get(agent_id);
+    // in async mode, the path may have been replaced by a shorter one since start_timestep was drawn.
+    if (start_timestep >= (int)path.size())
+        return;
     int loc = path[start_timestep].location;
     int orient = path[start_timestep].orientation;
     auto & agent = agents[agent_id];
@@ -415,15 +506,14 @@ void NeighborGenerator::randomWalk(int agent_id, int start_timestep, set<int>& c
         // int slack=1;
         for (int t = start_timestep; t < path.size(); ++t)
         {
-            auto successors=getSuccessors(loc,orient);
-            while (!successors.empty())
+            std::pair<int,int> successors[max_successors];
+            int n_successors=getSuccessors(loc,orient,successors);
+            while (n_successors>0)
             {
-                int step = rand() % successors.size();
-                auto iter = successors.begin();
-                advance(iter, step);
+                int step = (int)(MTs[idx]() % (unsigned)n_successors);
 
-                int next_loc = iter->first;
-                int next_orient = iter->second;
+                int next_loc = successors[step].first;
+                int next_orient = successors[step].second;
                 
                 float action_cost = agent.get_action_cost(loc, orient, next_loc, next_orient, HT);
                 float next_h_val = HT->get(next_loc, next_orient,instance.goal_locations[agent_id]);
@@ -437,9 +527,11 @@ void NeighborGenerator::randomWalk(int agent_id, int start_timestep, set<int>& c
                     partial_path_cost += action_cost;
                     break;
                 }
-                successors.erase(iter);
+                // erase it, keeping the order of the rest.
+                std::copy(successors+step+1, successors+n_successors, successors+step);
+                --n_successors;
             }
-            if (successors.empty() || conflicting_agents.size() >= neighbor_size)
+            if (n_successors==0 || conflicting_agents.size() >= neighbor_size)
                 break;
         }
     // } else {
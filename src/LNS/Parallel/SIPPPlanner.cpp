@@ -0,0 +1,213 @@
+#include "LNS/Parallel/SIPPPlanner.h"
+
+namespace LNS {
+
+namespace Parallel {
+
+using State=TimeSpaceAStarState;
+
+SIPPPlanner::SIPPPlanner(Instance & instance, std::shared_ptr<HeuristicTable> HT, std::shared_ptr<vector<float> > weights, int execution_window):
+    instance(instance), HT(HT), weights(weights), execution_window(execution_window) {
+    interval_offsets.resize(instance.map_size);
+    interval_counts.resize(instance.map_size);
+    interval_generations.resize(instance.map_size,0);
+};
+
+void SIPPPlanner::findPath(int start_pos, int start_orient, int goal_pos, ConstraintTable & constraint_table, const TimeLimiter & time_limiter) {
+    clear();
+
+    path_table=constraint_table.path_table_for_CT;
+    window=constraint_table.window_size_for_PATH;
+    horizon=std::min(constraint_table.window_size_for_CT,path_table->n_slices-1);
+
+    // the same as the time-space A*: the start is never arrived, because we need at least length 2 path.
+    State * start_state = state_pool.allocate();
+    *start_state = State(start_pos, start_orient, 0, 0, HT->get(start_pos, start_orient, goal_pos), 0, false, nullptr);
+    start_state->closed=false;
+    open_list.push(start_state);
+    all_states.insert(State::make_key(start_pos, start_orient, 0, false), start_state);
+
+    while (!open_list.empty() && !time_limiter.timeout()) {
+
+        State * curr=open_list.pop();
+        curr->closed=true;
+        ++n_expanded;
+
+        // it is safe at curr->t by construction.
+        if (execution_window==1 && curr->pos==goal_pos && curr->t>=1) {
+            buildPath(curr);
+            return;
+        }
+
+        if (curr->t>=window) {
+            buildPath(curr);
+            return;
+        }
+
+        getSuccessors(curr, goal_pos);
+        for (int i=0;i<successors.size();++i) {
+            auto & next_state=successors[i];
+            ++n_generated;
+            auto old_state = all_states.find(successor_keys[i]);
+            if (old_state==nullptr) {
+                State * new_state=state_pool.allocate();
+                *new_state=next_state;
+                new_state->closed=false;
+                all_states.insert(successor_keys[i], new_state);
+                open_list.push(new_state);
+            } else if (!old_state->closed && (next_state.f<old_state->f || (next_state.f==old_state->f && next_state.t<old_state->t))) {
+                // an expanded state is never updated, because the waits of its successors start from its time.
+                old_state->copy(&next_state);
+                open_list.increase(old_state);
+            }
+        }
+    }
+}
+
+void SIPPPlanner::clear() {
+    open_list.clear();
+    all_states.reset();
+    state_pool.reset();
+    path.clear();
+    n_expanded = 0;
+    n_generated = 0;
+
+    // the path table changes between searches, e.g., PP inserts each new path.
+    intervals.clear();
+    ++generation;
+    if (generation==0) {
+        std::fill(interval_generations.begin(),interval_generations.end(),0);
+        generation=1;
+    }
+}
+
+const SIPPPlanner::SafeInterval * SIPPPlanner::get_safe_intervals(int loc, int & n) {
+    if (interval_generations[loc]!=generation) {
+        interval_generations[loc]=generation;
+        interval_offsets[loc]=(int)intervals.size();
+        // nothing can arrive at t=0, so every cell is safe then, the same as the time-space A* never checking the start.
+        int begin=0;
+        for (int t=1;t<=horizon;++t) {
+            bool safe=path_table->get(loc,t)==NO_AGENT;
+            if (safe && begin<0) {
+                begin=t;
+            } else if (!safe && begin>=0) {
+                intervals.push_back({begin,t});
+                begin=-1;
+            }
+        }
+        if (begin<0) {
+            begin=horizon+1;
+        }
+        intervals.push_back({begin,MAX_TIMESTEP});
+        interval_counts[loc]=(int)intervals.size()-interval_offsets[loc];
+    }
+    n=interval_counts[loc];
+    return intervals.data()+interval_offsets[loc];
+}
+
+void SIPPPlanner::buildPath(State * curr) {
+    path.clear();
+    path.path_cost = curr->f;
+    path.nodes.resize(curr->t+1);
+
+    // a state holds its cell until the next state arrives.
+    int t_next=curr->t+1;
+    for (auto s=curr;s!=nullptr;s=s->prev) {
+        for (int t=s->t;t<t_next;++t) {
+            path.nodes[t]=PathEntry(s->pos,s->orient);
+        }
+        t_next=s->t;
+    }
+}
+
+void SIPPPlanner::getSuccessors(State * curr, int goal_pos) {
+    successors.clear();
+    successor_keys.clear();
+
+    int & cols=instance.num_of_cols;
+    int & rows=instance.num_of_rows;
+    auto & map=instance.my_map;
+    auto & weights=*(this->weights);
+    int pos=curr->pos;
+    int orient=curr->orient;
+    int t=curr->t;
+
+    int n_curr_intervals;
+    const SafeInterval * curr_intervals=get_safe_intervals(pos,n_curr_intervals);
+    int curr_interval=0;
+    while (curr_intervals[curr_interval].end<=t) {
+        ++curr_interval;
+    }
+    int curr_end=curr_intervals[curr_interval].end;
+
+    float stay_weight=weights[pos*n_dirs+4];
+    // any action that stays at pos for a step, the same as W in the time-space A*.
+    bool arrived_after_stay=curr->arrived | (pos==goal_pos);
+
+    // CR and CCR
+    if (t+1<curr_end) {
+        add_successor(pos, (orient+1)%n_orients, t+1, curr->g+stay_weight, arrived_after_stay, curr_interval, curr, goal_pos);
+        add_successor(pos, (orient+n_orients-1)%n_orients, t+1, curr->g+stay_weight, arrived_after_stay, curr_interval, curr, goal_pos);
+    }
+
+    // W until the end of the window
+    if (curr_end>window) {
+        add_successor(pos, orient, window, curr->g+(float)(window-t)*stay_weight, arrived_after_stay, terminal_interval, curr, goal_pos);
+    }
+
+    // W and then FW, arriving at each safe interval of the next cell reachable before pos becomes unsafe
+    int x=pos%cols;
+    int y=pos/cols;
+    int next_pos;
+    if (orient==0) {
+        if (x+1>=cols) return;
+        next_pos=pos+1;
+    } else if (orient==1) {
+        if (y+1>=rows) return;
+        next_pos=pos+cols;
+    } else if (orient==2) {
+        if (x-1<0) return;
+        next_pos=pos-1;
+    } else if (orient==3) {
+        if (y-1<0) return;
+        next_pos=pos-cols;
+    } else {
+        std::cerr<<"SIPPPlanner: invalid orient: "<<orient<<endl;
+        exit(-1);
+    }
+    if (map[next_pos]!=0) {
+        return;
+    }
+
+    float move_weight=weights[pos*n_dirs+orient];
+    int latest_departure=std::min(curr_end,window)-1;
+    int n_next_intervals;
+    const SafeInterval * next_intervals=get_safe_intervals(next_pos,n_next_intervals);
+    for (int k=0;k<n_next_intervals;++k) {
+        auto & interval=next_intervals[k];
+        if (interval.begin>latest_departure+1) {
+            break;
+        }
+        int arrival=std::max(t+1,interval.begin);
+        int latest_arrival=std::min(latest_departure+1,interval.end-1);
+        // only right at the beginning of the interval, the agent leaving next_pos may be coming to pos.
+        if (arrival<=horizon) {
+            int agent=path_table->get(next_pos,arrival-1);
+            if (agent!=NO_AGENT && path_table->get(pos,arrival)==agent) {
+                ++arrival;
+            }
+        }
+        if (arrival>latest_arrival) {
+            continue;
+        }
+
+        bool arrived=(arrival-1>t?arrived_after_stay:curr->arrived) | (next_pos==goal_pos);
+        float g=curr->g+(float)(arrival-1-t)*stay_weight+move_weight;
+        add_successor(next_pos, orient, arrival, g, arrived, k, curr, goal_pos);
+    }
+}
+
+}
+
+} // namespace LNS
@@ -0,0 +1,36 @@
+#include "LNS/Parallel/Telemetry.h"
+
+namespace LNS {
+
+namespace Parallel {
+
+// indexed by Neighbor::selected_neighbor
+static const char * destroy_names[]={"RANDOMWALK","INTERSECTION","RANDOMAGENTS","CONGESTION"};
+// indexed by commit_result
+static const char * result_names[]={"accepted","invalid","not_cheaper","dropped","replan_not_cheaper","replan_failed"};
+
+Telemetry::Telemetry(const string & path, int num_threads): out(path), buffers(num_threads) {
+    if (!out.is_open()) {
+        std::cerr<<"Telemetry: cannot open "<<path<<endl;
+        exit(-1);
+    }
+    out<<"run,thread,iteration,time,neighbor_size,destroy,expanded,replan_ms,result,commit_wait_ms,cost_delta\n";
+}
+
+void Telemetry::flush() {
+    for (auto & buffer: buffers) {
+        for (auto & r: buffer) {
+            bool known=r.selected_neighbor>=0 && r.selected_neighbor<(int)(sizeof(destroy_names)/sizeof(destroy_names[0]));
+            out<<run<<','<<r.thread<<','<<r.iteration<<','<<r.elapse<<','<<r.neighbor_size<<','
+                <<(known?destroy_names[r.selected_neighbor]:"UNKNOWN")<<','<<r.n_expanded<<','<<r.replan_ms<<','
+                <<result_names[r.result]<<','<<r.commit_wait_ms<<','<<r.cost_delta<<'\n';
+        }
+        buffer.clear();
+    }
+    out.flush();
+    ++run;
+}
+
+}
+
+} // namespace LNS
@@ -12,9 +12,10 @@ void TimeSpaceAStarPlanner::findPath(int start_pos, int start_orient, int goal_p
     clear();
 
     // at the beginning, we alway assume the agent havn't arrived its goal, even its start location are the same as the goal location. because we need at least length 2 path.
-    State * start_state = new State(start_pos, start_orient, 0, 0, HT->get(start_pos, start_orient, goal_pos), 0, false, nullptr);
+    State * start_state = state_pool.allocate();
+    *start_state = State(start_pos, start_orient, 0, 0, HT->get(start_pos, start_orient, goal_pos), 0, false, nullptr);
     start_state->closed=false;
-    start_state->open_list_handle=open_list.push(start_state);
+    open_list.push(start_state);
     all_states.insert(start_state);
 
     // assert(constraint_table.length_min==0); // the length_min should be at least 1 (otherwise the agent can't reach its goal location
@@ -22,8 +23,7 @@ void TimeSpaceAStarPlanner::findPath(int start_pos, int start_orient, int goal_p
 
     while (!open_list.empty() && !time_limiter.timeout()) {
 
-        State * curr=open_list.top();
-        open_list.pop();
+        State * curr=open_list.pop();
         curr->closed=true;
         ++n_expanded;
 
@@ -41,23 +41,24 @@ void TimeSpaceAStarPlanner::findPath(int start_pos, int start_orient, int goal_p
         getSuccessors(curr, goal_pos, constraint_table);
         for (auto & next_state: successors) {
             ++n_generated;
-            auto iter = all_states.find(next_state);
-            if (iter==all_states.end()) {
+            auto old_state = all_states.find(next_state.key());
+            if (old_state==nullptr) {
                 // new state
-                all_states.insert(next_state);
-                next_state->closed=false;
-                next_state->open_list_handle=open_list.push(next_state);
+                State * new_state=state_pool.allocate();
+                *new_state=next_state;
+                new_state->closed=false;
+                all_states.insert(new_state);
+                open_list.push(new_state);
             } else {
                 // old state
-                auto old_state=(*iter);
                 if (
-                    next_state->num_of_conflicts<old_state->num_of_conflicts || (
-                        next_state->num_of_conflicts==old_state->num_of_conflicts
-                        && next_state->f<old_state->f
+                    next_state.num_of_conflicts<old_state->num_of_conflicts || (
+                        next_state.num_of_conflicts==old_state->num_of_conflicts
+                        && next_state.f<old_state->f
                     )
                 ) {
                     // we need to update the state
-                    old_state->copy(next_state);
+                    old_state->copy(&next_state);
                     if (old_state->closed) {
                         // if (!old_state->arrived){
                         //     std::cerr<<"reopen"<<std::endl;
@@ -65,13 +66,12 @@ void TimeSpaceAStarPlanner::findPath(int start_pos, int start_orient, int goal_p
                         // }
                         // reopen closed state
                         old_state->closed=false;
-                        old_state->open_list_handle=open_list.push(old_state);
+                        open_list.push(old_state);
                     } else {
                         // update open state
-                        open_list.increase(old_state->open_list_handle);
+                        open_list.increase(old_state);
                     }
                 }
-                delete next_state;
             }
         }
     }
@@ -79,10 +79,8 @@ void TimeSpaceAStarPlanner::findPath(int start_pos, int start_orient, int goal_p
 
 void TimeSpaceAStarPlanner::clear() {
     open_list.clear();
-    for (auto s: all_states) {
-        delete s;
-    }
-    all_states.clear();
+    all_states.reset();
+    state_pool.reset();
     path.clear();
     n_expanded = 0;
     n_generated = 0;
@@ -132,7 +130,7 @@ void TimeSpaceAStarPlanner::getSuccessors(State * curr, int goal_pos, Constraint
                 next_h=curr->arrived?0:HT->get(next_pos, next_orient, goal_pos);
                 next_num_of_conflicts=curr->num_of_conflicts+constraint_table.getNumOfConflictsForStep(curr->pos, next_pos, next_timestep);
                 next_arrived=curr->arrived | (next_pos==goal_pos);
-                successors.push_back(new State(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr));
+                successors.emplace_back(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr);
             }
         }
     } else if (orient==1) {
@@ -145,7 +143,7 @@ void TimeSpaceAStarPlanner::getSuccessors(State * curr, int goal_pos, Constraint
                 next_h=curr->arrived?0:HT->get(next_pos, next_orient, goal_pos);
                 next_num_of_conflicts=curr->num_of_conflicts+constraint_table.getNumOfConflictsForStep(curr->pos, next_pos, next_timestep);
                 next_arrived=curr->arrived | (next_pos==goal_pos);
-                successors.push_back(new State(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr));
+                successors.emplace_back(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr);
             }
         }
     } else if (orient==2) {
@@ -158,7 +156,7 @@ void TimeSpaceAStarPlanner::getSuccessors(State * curr, int goal_pos, Constraint
                 next_h=curr->arrived?0:HT->get(next_pos, next_orient, goal_pos);
                 next_num_of_conflicts=curr->num_of_conflicts+constraint_table.getNumOfConflictsForStep(curr->pos, next_pos, next_timestep);
                 next_arrived=curr->arrived | (next_pos==goal_pos);
-                successors.push_back(new State(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr));
+                successors.emplace_back(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr);
             }
         }
     } else if (orient==3) {
@@ -171,7 +169,7 @@ void TimeSpaceAStarPlanner::getSuccessors(State * curr, int goal_pos, Constraint
                 next_h=curr->arrived?0:HT->get(next_pos, next_orient, goal_pos);
                 next_num_of_conflicts=curr->num_of_conflicts+constraint_table.getNumOfConflictsForStep(curr->pos, next_pos, next_timestep);
                 next_arrived=curr->arrived | (next_pos==goal_pos);
-                successors.push_back(new State(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr));
+                successors.emplace_back(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr);
             }
         }
     } else {
@@ -192,17 +190,17 @@ void TimeSpaceAStarPlanner::getSuccessors(State * curr, int goal_pos, Constraint
         // CR
         next_orient=(orient+1+n_orients)%n_orients;
         next_h=curr->arrived?0:HT->get(next_pos, next_orient, goal_pos);
-        successors.push_back(new State(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr));
+        successors.emplace_back(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr);
 
         // CCR
         next_orient=(orient-1+n_orients)%n_orients;
         next_h=curr->arrived?0:HT->get(next_pos, next_orient, goal_pos);
-        successors.push_back(new State(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr));
+        successors.emplace_back(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr);
 
         // W
         next_orient=orient;
         next_h=curr->arrived?0:HT->get(next_pos, next_orient, goal_pos);
-        successors.push_back(new State(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr));
+        successors.emplace_back(next_pos, next_orient, next_timestep, next_g, next_h, next_num_of_conflicts, next_arrived, curr);
     }
       
 }
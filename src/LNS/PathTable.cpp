@@ -3,63 +3,125 @@
 
 namespace LNS {
 
-void PathTable::insertPath(int agent_id, const Path& _path, bool verbose)
+PathTable::PathTable(int map_size, int window_size): window_size(window_size), map_size(map_size), goals(map_size, MAX_TIMESTEP)
+{
+    if (map_size > 0 && window_size <= 0) {
+        std::cerr << "PathTable requires a positive window size, but got " << window_size << std::endl;
+        exit(-1);
+    }
+    n_slices = window_size + 1;
+    table = vector<std::atomic<int> >((size_t)n_slices * map_size);
+    for (auto & cell : table)
+        cell.store(NO_AGENT, std::memory_order_relaxed);
+}
+
+PathTable::PathTable(const PathTable * shared, int window_size): window_size(window_size), map_size(shared->map_size), goals(shared->map_size, MAX_TIMESTEP), shared(shared)
+{
+    if (window_size <= 0 || window_size > shared->window_size) {
+        std::cerr << "a view of a PathTable requires a window size in (0," << shared->window_size << "], but got " << window_size << std::endl;
+        exit(-1);
+    }
+    n_slices = window_size + 1;
+    view_heads.assign(map_size, -1);
+}
+
+void PathTable::add_view_cells(int agent_id, const Parallel::Path & path, bool local)
+{
+    int T = get_path_length(path.nodes.size());
+    for (int t = 0; t < T; t++)
+    {
+        int loc = path.nodes[t].location;
+        view_cells.push_back({loc, t, agent_id, local, view_heads[loc]});
+        view_heads[loc] = (int)view_cells.size() - 1;
+    }
+}
+
+void PathTable::hide(int agent_id, const Parallel::Path & path)
+{
+    add_view_cells(agent_id, path, false);
+}
+
+void PathTable::clear_view()
+{
+    for (auto & cell : view_cells)
+        view_heads[cell.loc] = -1;
+    view_cells.clear();
+}
+
+void PathTable::reset()
+{
+    for (auto & cell : table)
+        cell.store(NO_AGENT, std::memory_order_relaxed);
+    if (shared == nullptr)
+        goals.assign(map_size, MAX_TIMESTEP);
+    makespan = 0;
+    base_slice = 0;
+    clear_view();
+}
+
+void PathTable::advance(int steps)
+{
+    if (steps >= n_slices) {
+        for (auto & cell : table)
+            cell.store(NO_AGENT, std::memory_order_relaxed);
+        base_slice = 0;
+    } else {
+        for (int t = 0; t < steps; ++t) {
+            // the slice of timestep 0 becomes the empty slice at the end of the window.
+            for (int loc = 0; loc < map_size; ++loc)
+                set(loc, 0, NO_AGENT);
+            base_slice = (base_slice + 1) % n_slices;
+        }
+    }
+    // goals are not maintained in the lifelong setting, see insertPath.
+    makespan = max(makespan - steps, 0);
+}
+
+void PathTable::insertPath(int agent_id, const Path& path, bool verbose)
 {
 
     if (verbose) {
         std::cerr<<"insertPath for agent "<<agent_id<<" paths: ";
-        for (auto p : _path) {
+        for (auto p : path) {
             std::cerr<<p.location<<" ";
         }
         std::cerr<<std::endl;
     }
 
-    if (_path.empty())
+    if (path.empty())
         return;
     
-    int T = (int) _path.size();
-    if (window_size>0 && window_size+1<_path.size()) {
-        T = window_size+1;
-    }
-    Path path(_path.begin(), _path.begin() + T);
-
-    for (int t = 0; t < (int)path.size(); t++)
+    int T = get_path_length(path.size());
+    for (int t = 0; t < T; t++)
     {
-        if (table[path[t].location].size() <= t)
-            table[path[t].location].resize(t + 1, NO_AGENT);
-        // assert(table[path[t].location][t] == NO_AGENT);
-        table[path[t].location][t] = agent_id;
+        // assert(at(path[t].location, t) == NO_AGENT);
+        set(path[t].location, t, agent_id);
     }
-    assert(goals[path.back().location] == MAX_TIMESTEP);
-    goals[path.back().location] = (int) path.size() - 1;
-    makespan = max(makespan, (int) path.size() - 1);
+    assert(goals[path[T - 1].location] == MAX_TIMESTEP);
+    goals[path[T - 1].location] = T - 1;
+    makespan = max(makespan, T - 1);
 }
 
-void PathTable::deletePath(int agent_id, const Path& _path,bool verbose)
+void PathTable::deletePath(int agent_id, const Path& path,bool verbose)
 {
     if (verbose) {
         std::cerr<<"deletePath for agent "<<agent_id<<" paths: ";
-        for (auto p : _path) {
+        for (auto p : path) {
             std::cerr<<p.location<<" ";
         }
         std::cerr<<std::endl;
     }
 
-    if (_path.empty())
+    if (path.empty())
         return;
     
-    int T = (int) _path.size();
-    if (window_size>0 && window_size+1<_path.size()) {
-        T = window_size+1;
-    }
-    Path path(_path.begin(), _path.begin() + T);
-    
-    for (int t = 0; t < (int)path.size() ; t++)
+    int T = get_path_length(path.size());
+    for (int t = 0; t < T; t++)
     {
-        assert(table[path[t].location].size() > t && table[path[t].location][t] == agent_id);
-        table[path[t].location][t] = NO_AGENT;
+        assert(get(path[t].location, t) == agent_id);
+        set(path[t].location, t, NO_AGENT);
     }
-    goals[path.back().location] = MAX_TIMESTEP;
+    goals[path[T - 1].location] = MAX_TIMESTEP;
 
     // : when we use window size, we ignore this for now, maybe we can use a better data structure such as ordered_set/heap to maintain the makespan. 
     // if (makespan == (int) path.size() - 1) // re-compute makespan
@@ -88,25 +150,20 @@ void PathTable::insertPath(int agent_id, const Parallel::Path& _path, bool verbo
 
     if (_path.nodes.empty())
         return;
-    
-    int T = (int) _path.nodes.size();
-    if (window_size>0 && window_size+1<_path.nodes.size()) {
-        T = window_size+1;
-    }
 
+    if (shared != nullptr) {
+        add_view_cells(agent_id, _path, true);
+        return;
+    }
+    
+    int T = get_path_length(_path.nodes.size());
     auto & path=_path.nodes;
 
-
     for (int t = 0; t < T; t++)
     {
-        if (table[path[t].location].size() <= t)
-            table[path[t].location].resize(t + 1, NO_AGENT);
-        // assert(table[path[t].location][t] == NO_AGENT);
-            
-        // cerr<<t<<","<<table[path[t].location][t]<<" ";
-        table[path[t].location][t] = agent_id;
+        // assert(at(path[t].location, t) == NO_AGENT);
+        set(path[t].location, t, agent_id);
     }
-    // cerr<<endl;
 
     // : check whether we need maintain goals and makespan in the life-long setting
     // assert(goals[path.back().location] == MAX_TIMESTEP);
@@ -126,49 +183,121 @@ void PathTable::deletePath(int agent_id, const Parallel::Path& _path,bool verbos
 
     if (_path.nodes.empty())
         return;
-    
-    int T = (int) _path.nodes.size();
-    if (window_size>0 && window_size+1<_path.nodes.size()) {
-        T = window_size+1;
-    }
 
+    if (shared != nullptr) {
+        // unlink the inserted cells, which stay unused in view_cells until clear_view().
+        int T = get_path_length(_path.nodes.size());
+        for (int t = 0; t < T; t++)
+        {
+            int * link = &view_heads[_path.nodes[t].location];
+            while (*link >= 0)
+            {
+                auto & cell = view_cells[*link];
+                if (cell.local && cell.agent == agent_id && cell.t == t)
+                {
+                    *link = cell.next;
+                    break;
+                }
+                link = &cell.next;
+            }
+        }
+        return;
+    }
+    
+    int T = get_path_length(_path.nodes.size());
     auto & path=_path.nodes;
     
     for (int t = 0; t < T ; t++)
     {
-        assert(table[path[t].location].size() > t && table[path[t].location][t] == agent_id);
-        table[path[t].location][t] = NO_AGENT;
+        assert(get(path[t].location, t) == agent_id);
+        set(path[t].location, t, NO_AGENT);
     }
     // : check whether we need maintain goals and makespan  in the life-long setting
     // goals[path.back().location] = MAX_TIMESTEP;
-
-    // : when we use window size, we ignore this for now, maybe we can use a better data structure such as ordered_set/heap to maintain the makespan. 
-    // if (makespan == (int) path.size() - 1) // re-compute makespan
-    // {
-    //     makespan = 0;
-    //     for (int time : goals)
-    //     {
-    //         if (time < MAX_TIMESTEP && time > makespan)
-    //             makespan = time;
-    //     }
-
-    // }
 }
 
+void PathTable::advance(int steps, std::vector<Parallel::Agent> & agents, const std::vector<int> & changed_agents, const std::vector<Parallel::Path> & new_paths)
+{
+    // every cell belongs to a path, so clearing the dropped timesteps of the paths empties the slices that the
+    // rotation moves to the end of the window.
+    for (int i = 0; i < agents.size(); i++)
+    {
+        auto & old_path = agents[i].path.nodes;
+        int T = std::min(steps, get_path_length(old_path.size()));
+        for (int t = 0; t < T; t++)
+        {
+            assert(get(old_path[t].location, t) == i);
+            set(old_path[t].location, t, NO_AGENT);
+        }
+        old_path.erase(old_path.begin(), old_path.begin() + std::min((size_t)steps, old_path.size()));
+    }
+    base_slice = (base_slice + steps) % n_slices;
 
+    changed_from.resize(changed_agents.size());
+    for (int k = 0; k < changed_agents.size(); k++)
+    {
+        int i = changed_agents[k];
+        auto & old_path = agents[i].path.nodes;
+        auto & new_path = new_paths[i].nodes;
+        int t = 0;
+        int T = (int)std::min(old_path.size(), new_path.size());
+        while (t < T && old_path[t].location == new_path[t].location && old_path[t].orientation == new_path[t].orientation)
+            t++;
+        changed_from[k] = t;
+    }
 
+    // all deletions first, a new path may take a cell that another agent's old path leaves.
+    for (int k = 0; k < changed_agents.size(); k++)
+    {
+        int i = changed_agents[k];
+        auto & old_path = agents[i].path.nodes;
+        int T = get_path_length(old_path.size());
+        for (int t = changed_from[k]; t < T; t++)
+        {
+            assert(get(old_path[t].location, t) == i);
+            set(old_path[t].location, t, NO_AGENT);
+        }
+    }
+    for (int k = 0; k < changed_agents.size(); k++)
+    {
+        int i = changed_agents[k];
+        auto & new_path = new_paths[i].nodes;
+        int T = get_path_length(new_path.size());
+        for (int t = changed_from[k]; t < T; t++)
+        {
+            set(new_path[t].location, t, i);
+        }
+        agents[i].path = new_paths[i];
+    }
+
+    // the other paths are only extended.
+    int k = 0;
+    for (int i = 0; i < agents.size(); i++)
+    {
+        if (k < changed_agents.size() && changed_agents[k] == i)
+        {
+            k++;
+            continue;
+        }
+        auto & path = agents[i].path.nodes;
+        int t = get_path_length(path.size());
+        path.insert(path.end(), new_paths[i].nodes.begin(), new_paths[i].nodes.end());
+        int T = get_path_length(path.size());
+        for (; t < T; t++)
+        {
+            set(path[t].location, t, i);
+        }
+    }
+}
 
 
 bool PathTable::constrained(int from, int to, int to_time) const
 {
-    if (!table.empty())
-    {
-        if (table[to].size() > to_time && table[to][to_time] != NO_AGENT)
-            return true;  // vertex conflict with agent table[to][to_time]
-        else if (table[to].size() >= to_time && table[from].size() > to_time && !table[to].empty() &&
-                 table[to][to_time - 1] != NO_AGENT && table[from][to_time] == table[to][to_time - 1])
-            return true;  // edge conflict with agent table[to][to_time - 1]
-    }
+    if (get(to, to_time) != NO_AGENT)
+        return true;  // vertex conflict with agent get(to, to_time)
+    int agent = get(to, to_time - 1);
+    if (agent != NO_AGENT && get(from, to_time) == agent)
+        return true;  // edge conflict with agent get(to, to_time - 1)
     // if (!goals.empty())
     // {
     //     if (goals[to] <= to_time)
@@ -177,35 +306,19 @@ bool PathTable::constrained(int from, int to, int to_time) const
     return false;
 }
 
-bool PathTable::constrained(int from, int to, int to_time, std::vector<int> & ignored_agents) const
+bool PathTable::constrained(int from, int to, int to_time, const std::vector<int> & ignored_agents) const
 {
-    if (!table.empty())
-    {
-        if (table[to].size() > to_time && table[to][to_time] != NO_AGENT) {
-            bool found=false;
-            for (int i=0;i<ignored_agents.size();++i) {
-                if (table[to][to_time]==ignored_agents[i]) {
-                    found=true;
-                    break;
-                }
-            }
-            if (!found) {
-                return true;  // vertex conflict with agent table[to][to_time]
-            }
+    int agent = get(to, to_time);
+    if (agent != NO_AGENT) {
+        if (!std::binary_search(ignored_agents.begin(), ignored_agents.end(), agent)) {
+            return true;  // vertex conflict with agent get(to, to_time)
         }
-        
-        if (table[to].size() >= to_time && table[from].size() > to_time && !table[to].empty() &&
-                 table[to][to_time - 1] != NO_AGENT && table[from][to_time] == table[to][to_time - 1]) {
-            bool found=false;
-            for (int i=0;i<ignored_agents.size();++i) {
-                if (table[to][to_time-1]==ignored_agents[i]) {
-                    found=true;
-                    break;
-                }
-            }
-            if (!found) {
-                return true;  // edge conflict with agent table[to][to_time - 1]
-            }
+    }
+
+    agent = get(to, to_time - 1);
+    if (agent != NO_AGENT && get(from, to_time) == agent) {
+        if (!std::binary_search(ignored_agents.begin(), ignored_agents.end(), agent)) {
+            return true;  // edge conflict with agent get(to, to_time - 1)
         }
     }
 
@@ -218,53 +331,53 @@ bool PathTable::constrained(int from, int to, int to_time, std::vector<int> & ig
     return false;
 }
 
-void PathTable::getConflictingAgents(int agent_id, set<int>& conflicting_agents, int from, int to, int to_time) const
+void PathTable::getConflictingAgents(int agent_id, vector<int>& conflicting_agents, int from, int to, int to_time) const
 {
-    if (table.empty())
-        return;
-    if (table[to].size() > to_time && table[to][to_time] != NO_AGENT)
-        conflicting_agents.insert(table[to][to_time]); // vertex conflict
-    if (table[to].size() >= to_time && table[from].size() > to_time &&
-        table[to][to_time - 1] != NO_AGENT && table[from][to_time] == table[to][to_time - 1])
-        conflicting_agents.insert(table[from][to_time]); // edge conflict
+    int agent = get(to, to_time);
+    if (agent != NO_AGENT)
+        Parallel::insert_sorted(conflicting_agents, agent); // vertex conflict
+    agent = get(to, to_time - 1);
+    if (agent != NO_AGENT && get(from, to_time) == agent)
+        Parallel::insert_sorted(conflicting_agents, agent); // edge conflict
     // TODO: collect target conflicts as well.
 }
 
-void PathTable::get_agents(set<int>& conflicting_agents, int loc) const
+void PathTable::get_agents(vector<int>& conflicting_agents, int loc) const
 {
     if (loc < 0)
         return;
-    for (auto agent : table[loc])
+    for (int t = 0; t < n_slices; t++)
     {
+        int agent = get(loc, t);
         if (agent >= 0)
-            conflicting_agents.insert(agent);
+            Parallel::insert_sorted(conflicting_agents, agent);
     }
 }
 
-void PathTable::get_agents(set<int>& conflicting_agents, int neighbor_size, int loc) const
+void PathTable::get_agents(vector<int>& conflicting_agents, int neighbor_size, int loc, std::mt19937 & MT) const
 {
-    if (loc < 0 || table[loc].empty())
+    if (loc < 0)
         return;
-    int t_max = (int) table[loc].size() - 1;
-    while (table[loc][t_max] == NO_AGENT && t_max > 0)
+    int t_max = n_slices - 1;
+    while (t_max > 0 && get(loc, t_max) == NO_AGENT)
         t_max--;
     if (t_max == 0)
         return;
-    int t0 = rand() % t_max;
-    if (table[loc][t0] != NO_AGENT)
-        conflicting_agents.insert(table[loc][t0]);
+    int t0 = std::uniform_int_distribution<int>(0, t_max - 1)(MT);
+    if (get(loc, t0) != NO_AGENT)
+        Parallel::insert_sorted(conflicting_agents, get(loc, t0));
     int delta = 1;
     while (t0 - delta >= 0 || t0 + delta <= t_max)
     {
-        if (t0 - delta >= 0 && table[loc][t0 - delta] != NO_AGENT)
+        if (t0 - delta >= 0 && get(loc, t0 - delta) != NO_AGENT)
         {
-            conflicting_agents.insert(table[loc][t0 - delta]);
+            Parallel::insert_sorted(conflicting_agents, get(loc, t0 - delta));
             if((int) conflicting_agents.size() == neighbor_size)
                 return;
         }
-        if (t0 + delta <= t_max && table[loc][t0 + delta] != NO_AGENT)
+        if (t0 + delta <= t_max && get(loc, t0 + delta) != NO_AGENT)
         {
-            conflicting_agents.insert(table[loc][t0 + delta]);
+            Parallel::insert_sorted(conflicting_agents, get(loc, t0 + delta));
             if((int) conflicting_agents.size() == neighbor_size)
                 return;
         }
@@ -275,10 +388,10 @@ void PathTable::get_agents(set<int>& conflicting_agents, int neighbor_size, int
 // get the holding time after the earliest_timestep for a location
 int PathTable::getHoldingTime(int location, int earliest_timestep = 0) const
 {
-    if (table.empty() or (int) table[location].size() <= earliest_timestep)
+    if (n_slices <= earliest_timestep)
         return earliest_timestep;
-    int rst = (int) table[location].size();
-    while (rst > earliest_timestep and table[location][rst - 1] == NO_AGENT)
+    int rst = n_slices;
+    while (rst > earliest_timestep and get(location, rst - 1) == NO_AGENT)
         rst--;
     return rst;
 }
@@ -200,15 +200,15 @@ void ReservationTable::updateSIT(int location)
 
     // : currently, we only deal with the window size in this case.
     // path table
-    if (constraint_table.path_table_for_CT != nullptr and !constraint_table.path_table_for_CT->table.empty())
+    if (constraint_table.path_table_for_CT != nullptr and !constraint_table.path_table_for_CT->empty())
     {
         if (location < constraint_table.map_size) // vertex conflict
         {
-            int T=min((int)constraint_table.path_table_for_CT->table[location].size(), constraint_table.window_size_for_CT+1);
+            int T=min(constraint_table.path_table_for_CT->n_slices, constraint_table.window_size_for_CT+1);
 
             for (int t = 0; t < T; t++)
             {
-                if (constraint_table.path_table_for_CT->table[location][t] != NO_AGENT)
+                if (constraint_table.path_table_for_CT->get(location, t) != NO_AGENT)
                 {
                     insert2SIT(location, t, t+1);
                 }
@@ -220,18 +220,16 @@ void ReservationTable::updateSIT(int location)
         }
         else // edge conflict
         {
-            auto from = location / constraint_table.map_size - 1;
-            auto to = location % constraint_table.map_size;
+            int from = (int)(location / constraint_table.map_size - 1);
+            int to = (int)(location % constraint_table.map_size);
             if (from != to)
             {
-                int t_max = (int) min(constraint_table.path_table_for_CT->table[from].size(),
-                                      constraint_table.path_table_for_CT->table[to].size() + 1);
-                t_max = min(t_max, constraint_table.window_size_for_CT+1);
+                int t_max = min(constraint_table.path_table_for_CT->n_slices, constraint_table.window_size_for_CT+1);
                 for (int t = 1; t < t_max; t++)
                 {
-                    if (constraint_table.path_table_for_CT->table[to][t - 1] != NO_AGENT and
-                        constraint_table.path_table_for_CT->table[to][t - 1] ==
-                        constraint_table.path_table_for_CT->table[from][t])
+                    if (constraint_table.path_table_for_CT->get(to, t - 1) != NO_AGENT and
+                        constraint_table.path_table_for_CT->get(to, t - 1) ==
+                        constraint_table.path_table_for_CT->get(from, t))
                     {
                         insert2SIT(location, t, t+1);
                     }
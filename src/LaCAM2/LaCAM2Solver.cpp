@@ -303,42 +303,100 @@ void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * preco
         Solution best_solution;
         ONLYDEV(g_timer.record_d("lacam2_plan_pre_s","lacam2_plan_pre");)
 
-        // #pragma omp parallel for
-        // for (int i=1;i<2;++i) {
-            
-            int order_strategy=1;
-            string _order_strategy=read_param_json<string>(config,"order_strategy");
-            if (_order_strategy=="early_time") {
-                order_strategy=1;
-            } else if (_order_strategy=="short_dist") {
-                order_strategy=0;
-            } else {
-                cout<<"unknown order strategy: "<<_order_strategy<<endl;
-                exit(-1);
+        int order_strategy=1;
+        string _order_strategy=read_param_json<string>(config,"order_strategy");
+        if (_order_strategy=="early_time") {
+            order_strategy=1;
+        } else if (_order_strategy=="short_dist") {
+            order_strategy=0;
+        } else {
+            cout<<"unknown order strategy: "<<_order_strategy<<endl;
+            exit(-1);
+        }
+
+        // a portfolio of planners solves the same instance in parallel. member 0 is the configured planner with the
+        // shared MT and agent infos, so a portfolio of size 1 plans exactly as before. the others flip the order
+        // strategy and the swap operation in turn and redraw the tie breakers of the agents with their own seeds.
+        // once a member finds a solution within portfolio_bound times the sum of the heuristics, the rest give up.
+        int portfolio_size=read_param_json<int>(config,"portfolio_size",1);
+        float portfolio_bound=read_param_json<float>(config,"portfolio_bound",1.0);
+        if (portfolio_size<1) {
+            cerr<<"invalid portfolio size: "<<portfolio_size<<endl;
+            exit(-1);
+        }
+        if (search_arenas.size()<portfolio_size) {
+            search_arenas.resize(portfolio_size);
+        }
+
+        float cost_bound=0;
+        if (portfolio_size>1) {
+            for (int i=0;i<instance.N;++i) {
+                cost_bound+=HT->get(instance.starts.locs[i]->index,instance.starts.orients[i],instance.goals.locs[i]->index);
+            }
+            cost_bound*=portfolio_bound;
+        }
+        std::atomic<bool> stop(false);
+        int pibt_tile_size=read_param_json<int>(config,"pibt_tile_size",0);
+
+        // every member needs its own instance, because the search changes the goals of disabled agents. they are
+        // copied before the parallel region, where member 0 changes the shared instance.
+        std::vector<std::mt19937> member_MTs;
+        std::vector<std::vector<AgentInfo> > member_agent_infos(portfolio_size);
+        std::vector<std::unique_ptr<Instance> > member_instances(portfolio_size);
+        for (int i=1;i<portfolio_size;++i) {
+            member_MTs.emplace_back((*MT)());
+        }
+        for (int i=1;i<portfolio_size;++i) {
+            auto & member_MT=member_MTs[i-1];
+            member_agent_infos[i]=*agent_infos;
+            for (auto & agent_info: member_agent_infos[i]) {
+                agent_info.tie_breaker=get_random_float(&member_MT,0,1);
+            }
+            member_instances[i].reset(new Instance(instance,member_agent_infos[i]));
+        }
+
+        ONLYDEV(g_timer.record_p("lacam_solve_s");)
+        #pragma omp parallel for schedule(dynamic,1) if(portfolio_size>1)
+        for (int i=0;i<portfolio_size;++i) {
+            Instance * ins=&instance;
+            std::mt19937 * rng=MT;
+            int member_order_strategy=order_strategy;
+            bool member_use_swap=use_swap;
+            if (i>0) {
+                ins=member_instances[i].get();
+                rng=&member_MTs[i-1];
+                member_order_strategy=(order_strategy+i)%2;
+                member_use_swap=use_swap^((i/2)%2==1);
             }
 
-            ONLYDEV(g_timer.record_p("lacam_build_planner_s");)
-            auto planner = Planner(&instance,HT,map_weights,&deadline,MT,0,LaCAM2::OBJ_SUM_OF_LOSS,0.0F,
-                use_swap,
+            auto planner = Planner(ins,HT,map_weights,&deadline,rng,0,LaCAM2::OBJ_SUM_OF_LOSS,0.0F,
+                member_use_swap,
                 use_orient_in_heuristic,
                 use_external_executor,
-                disable_agent_goals
+                disable_agent_goals,
+                &search_arenas[i],
+                portfolio_size>1?&stop:nullptr,
+                pibt_tile_size
             );
-            ONLYDEV(g_timer.record_d("lacam_build_planner_s","lacam_build_planner");)
             auto additional_info = std::string("");
-            ONLYDEV(g_timer.record_p("lacam_solve_s");)
-            auto solution=planner.solve(additional_info,order_strategy);
-            ONLYDEV(g_timer.record_d("lacam_solve_s","lacam_solve");)
-            auto cost=eval_solution(instance,solution);
-            // #pragma omp critical
+            auto solution=planner.solve(additional_info,member_order_strategy);
+            // members stopped by another one have no solution.
+            if (solution.empty()) {
+                continue;
+            }
+            auto cost=eval_solution(*ins,solution);
+            #pragma omp critical
             {
                 if (cost<best_cost) {
                     best_cost=cost;
                     best_solution=solution;
                 }
-                // std::cerr<<i<<precomputed_paths[i]<<endl;
             }
-        // }
+            if (portfolio_size>1 && cost<=cost_bound) {
+                stop=true;
+            }
+        }
+        ONLYDEV(g_timer.record_d("lacam_solve_s","lacam_solve");)
 
         // std::cout<<"old:"<<std::endl;
         // for (int i=0;i<env.num_of_agents;++i) {
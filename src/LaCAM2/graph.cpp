@@ -61,6 +61,7 @@ Graph::Graph(const SharedEnvironment & env): V(Vertices()), width(env.cols), hei
     }
   }
 
+  set_neighbor_orients();
 }
 
 
@@ -140,10 +141,31 @@ Graph::Graph(const std::string& filename) : V(Vertices()), width(0), height(0)
       }
     }
   }
+
+  set_neighbor_orients();
 }
 
 uint Graph::size() const { return V.size(); }
 
+void Graph::set_neighbor_orients()
+{
+  for (auto v : V) {
+    v->neighbor_orients.fill(-1);
+    for (size_t k = 0; k < v->neighbor.size(); ++k) {
+      int diff = (int)v->neighbor[k]->index - (int)v->index;
+      if (diff == 1) {
+        v->neighbor_orients[k] = 0;
+      } else if (diff == (int)width) {
+        v->neighbor_orients[k] = 1;
+      } else if (diff == -1) {
+        v->neighbor_orients[k] = 2;
+      } else {
+        v->neighbor_orients[k] = 3;
+      }
+    }
+  }
+}
+
 bool is_same_config(const Config& C1, const Config& C2)
 {
   const auto N = C1.size();
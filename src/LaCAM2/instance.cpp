@@ -29,6 +29,15 @@ Instance::Instance(
 
 }
 
+Instance::Instance(const Instance & other, std::vector<AgentInfo> & agent_infos):
+      G(other.G),
+      starts(other.starts),
+      goals(other.goals),
+      N(other.N),
+      agent_infos(agent_infos),
+      planning_window(other.planning_window),
+      precomputed_paths(other.precomputed_paths) {}
+
 void Instance::set_starts_and_goals(std::vector<::State> * starts_ptr, std::vector<::State> * goals_ptr) {
   auto & starts=*starts_ptr;
   auto & goals=*goals_ptr;
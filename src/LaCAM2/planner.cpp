@@ -1,4 +1,5 @@
 #include "LaCAM2/planner.hpp"
+#include <cstring>
 
 namespace LaCAM2 {
 
@@ -31,40 +32,45 @@ int get_neighbor_orientation(const Graph & G, int loc1, int loc2, int default_va
 
 }
 
-LNode::LNode(LNode* parent, uint i, const std::tuple<Vertex*,int > & t)
-    : who(), where(), depth(parent == nullptr ? 0 : parent->depth + 1)
+void LNode::init(LNode* _parent, uint i, const std::tuple<Vertex*,int > & t)
 {
-  if (parent != nullptr) {
-    who = parent->who;
-    who.push_back(i);
-    where = parent->where;
-    where.push_back(t);
-  }
+  parent = _parent;
+  who = i;
+  where = std::get<0>(t);
+  orient = std::get<1>(t);
+  depth = parent == nullptr ? 0 : parent->depth + 1;
 }
 
-uint HNode::HNODE_CNT = 0;
+std::atomic<uint> HNode::HNODE_CNT(0);
+
+// map a float to an unsigned int in the same order.
+static inline uint32_t float_key(float x) {
+  uint32_t u;
+  std::memcpy(&u, &x, sizeof(u));
+  return (u >> 31) ? ~u : (u | 0x80000000u);
+}
 
 // for high-level
-HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Instance * ins, HNode* _parent, float _g,
-             float _h, const uint _d, int _order_strategy, bool disable_agent_goals)
-    : C(_C),
-      parent(_parent),
-      neighbor(),
-      g(_g),
-      h(_h),
-      d(_d),
-      f(g + h),
-      priorities(C.size()),
-      order(C.size(), 0),
-      search_tree(std::queue<LNode*>()),
-      order_strategy(_order_strategy)
+void HNode::init(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Instance * ins, HNode* _parent, float _g,
+             float _h, const uint _d, int _order_strategy, bool disable_agent_goals, SearchArena & arena)
 {
+  // the vectors of a recycled node are assigned in place, so they keep their memory.
+  C = _C;
+  parent = _parent;
+  neighbor.clear();
+  g = _g;
+  h = _h;
+  d = _d;
+  f = g + h;
+  search_tree.clear();
+  order_strategy = _order_strategy;
+
   ++HNODE_CNT;
 
   const auto N = C.size();
 
   // update neighbor
-  if (parent != nullptr) parent->neighbor.insert(this);
+  if (parent != nullptr) parent->neighbor.push_back(this);
 
   for (int aid=0;aid<N;++aid) {
     if ((disable_agent_goals && ins->agent_infos[aid].disabled)) {
@@ -72,34 +78,60 @@ HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Insta
     }
   }
 
-  std::vector<std::tuple<bool,bool,bool,float,float,float,int> > scores;
+  // re-key the agents that may have changed since the parent, the others keep their place in the parent's order.
+  // reused by the later nodes of the same thread.
+  static thread_local std::vector<AgentPriority> changed;
+  static thread_local std::vector<char> is_changed;
+  changed.clear();
+  is_changed.assign(N,false);
   for (int i=0;i<N;++i) {
-    const AgentInfo & a=ins->agent_infos[i];
-    bool disabled=a.disabled;
-    bool arrived=C.arrivals[i];
     bool precomputed = ins->precomputed_paths!=nullptr && (*(ins->precomputed_paths))[i].size()>(d+1); // not not precomputed first
-    float h=HT->get(C.locs[i]->index,C.orients[i],ins->goals.locs[i]->index); // smaller h first
-    float elapse=a.elapsed; // larger elapse first
-    float tie_breaker=a.tie_breaker; 
-    scores.emplace_back(disabled,arrived,precomputed,elapse,h,tie_breaker,i);
-  }
+    if (parent!=nullptr && C.locs[i]==parent->C.locs[i] && C.orients[i]==parent->C.orients[i]
+        && C.arrivals[i]==parent->C.arrivals[i]
+        && (ins->precomputed_paths==nullptr || precomputed==((*(ins->precomputed_paths))[i].size()>d))) {
+      continue;
+    }
 
-  std::sort(scores.begin(),scores.end(),[&](std::tuple<bool,bool,bool,float,float,float,int> &score1, std::tuple<bool,bool,bool,float,float,float,int> &score2) {
-    if (std::get<0>(score1)!=std::get<0>(score2)) return std::get<0>(score1)<std::get<0>(score2);
-    if (std::get<1>(score1)!=std::get<1>(score2)) return std::get<1>(score1)<std::get<1>(score2);
-    if (std::get<2>(score1)!=std::get<2>(score2)) return std::get<2>(score1)>std::get<2>(score2);
+    const AgentInfo & a=ins->agent_infos[i];
+    float h=HT->get(C.locs[i]->index,C.orients[i],ins->goals.locs[i]->index); // smaller h first
+    uint32_t h_key=float_key(h);
+    uint32_t elapsed_key=~float_key(a.elapsed); // larger elapse first
+    uint32_t first=0;
+    uint32_t second=0;
     if (order_strategy==0) {
-      if (std::get<4>(score1)!=std::get<4>(score2)) return std::get<4>(score1)<std::get<4>(score2);
-      if (std::get<3>(score1)!=std::get<3>(score2)) return std::get<3>(score1)>std::get<3>(score2);
+      first=h_key;
+      second=elapsed_key;
     } else if (order_strategy==1) {
-      if (std::get<3>(score1)!=std::get<3>(score2)) return std::get<3>(score1)>std::get<3>(score2);
-      if (std::get<4>(score1)!=std::get<4>(score2)) return std::get<4>(score1)<std::get<4>(score2);
+      first=elapsed_key;
+      second=h_key;
     }
-    return std::get<5>(score1)>std::get<5>(score2);
-  });
+    // not disabled first, then not arrived first, then precomputed first.
+    uint64_t flags=((uint64_t)a.disabled<<2)|((uint64_t)C.arrivals[i]<<1)|(uint64_t)!precomputed;
+    changed.push_back({(flags<<32)|first, ((uint64_t)second<<32)|~float_key(a.tie_breaker), (uint)i});
+    is_changed[i]=true;
+  }
+
+  std::sort(changed.begin(),changed.end());
 
+  if (parent==nullptr) {
+    priorities=changed;
+  } else {
+    // the unchanged agents are still sorted in the parent's order.
+    priorities.clear();
+    size_t k=0;
+    for (auto & p: parent->priorities) {
+      if (is_changed[p.id]) continue;
+      while (k<changed.size() && changed[k]<p) {
+        priorities.push_back(changed[k++]);
+      }
+      priorities.push_back(p);
+    }
+    priorities.insert(priorities.end(),changed.begin()+k,changed.end());
+  }
+
+  order.resize(N);
   for (int i=0;i<N;++i) {
-    order[i]=std::get<6>(scores[i]);
+    order[i]=priorities[i].id;
   }
 
 
@@ -164,7 +196,9 @@ HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Insta
 
   // });
 
-  search_tree.push(new LNode());
+  LNode* L_init = arena.lnodes.allocate();
+  L_init->init();
+  search_tree.push(L_init);
 
   // if (ins->precomputed_paths!=nullptr) {
   //   // low-level tree
@@ -187,17 +221,10 @@ HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Insta
   // }
 }
 
-HNode::~HNode()
-{
-  while (!search_tree.empty()) {
-    delete search_tree.front();
-    search_tree.pop();
-  }
-}
-
 Planner::Planner(Instance* _ins, const std::shared_ptr<HeuristicTable> & HT, const std::shared_ptr<std::vector<float> > & map_weights, const Deadline* _deadline,
                  std::mt19937* _MT, const int _verbose,
-                 const Objective _objective, const float _restart_rate, bool use_swap, bool use_orient_in_heuristic, bool use_external_executor, bool disable_agent_goals)
+                 const Objective _objective, const float _restart_rate, bool use_swap, bool use_orient_in_heuristic, bool use_external_executor, bool disable_agent_goals,
+                 SearchArena* _arena, const std::atomic<bool>* _stop_flag, int _pibt_tile_size)
     : ins(_ins),
       deadline(_deadline),
       MT(_MT),
@@ -210,7 +237,6 @@ Planner::Planner(Instance* _ins, const std::shared_ptr<HeuristicTable> & HT, con
       map_weights(map_weights),
       loop_cnt(0),
       C_next(N),
-      tie_breakers(V_size, 0),
       A(N, nullptr),
       occupied_now(V_size, nullptr),
       occupied_next(V_size, nullptr),
@@ -218,8 +244,37 @@ Planner::Planner(Instance* _ins, const std::shared_ptr<HeuristicTable> & HT, con
       use_orient_in_heuristic(use_orient_in_heuristic),
       executor(_ins->G.height,_ins->G.width),
       use_external_executor(use_external_executor),
-      disable_agent_goals(disable_agent_goals)
+      disable_agent_goals(disable_agent_goals),
+      arena(_arena),
+      stop_flag(_stop_flag),
+      pibt_tile_size(_pibt_tile_size),
+      n_tiles(0)
 {
+  if (arena == nullptr) {
+    own_arena.reset(new SearchArena());
+    arena = own_arena.get();
+  }
+
+  if (pibt_tile_size > 0) {
+    const int width = ins->G.width;
+    const int n_tile_cols = (width + pibt_tile_size - 1) / pibt_tile_size;
+    const int n_tile_rows = (ins->G.height + pibt_tile_size - 1) / pibt_tile_size;
+    n_tiles = n_tile_cols * n_tile_rows;
+    auto get_tile = [&](Vertex* v) {
+      return (v->index / width / pibt_tile_size) * n_tile_cols + v->index % width / pibt_tile_size;
+    };
+    vertex_tiles.resize(V_size);
+    for (auto v : ins->G.V) {
+      vertex_tiles[v->id] = get_tile(v);
+      for (auto u : v->neighbor) {
+        if (get_tile(u) != vertex_tiles[v->id]) {
+          vertex_tiles[v->id] = -1;
+          break;
+        }
+      }
+    }
+    tile_agents.resize(n_tiles);
+  }
 }
 
 Planner::~Planner() {}
@@ -232,12 +287,12 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
   for (auto i = 0; i < N; ++i) A[i] = new Agent(i);
 
   // setup search
+  // all nodes are taken from the arena and released together at the end.
   auto OPEN = std::stack<HNode*>();
-  auto EXPLORED = std::unordered_map<Config, HNode*, ConfigHasher, Config::ConfigEqual>();
   // insert initial node, 'H': high-level node
-  auto H_init = new HNode(ins->starts, HT, ins, nullptr, 0, get_h_value(ins->starts), 0, order_strategy, disable_agent_goals);
+  auto H_init = arena->hnodes.allocate();
+  H_init->init(ins->starts, HT, ins, nullptr, 0, get_h_value(ins->starts), 0, order_strategy, disable_agent_goals, *arena);
   OPEN.push(H_init);
-  EXPLORED[H_init->C] = H_init;
 
   std::vector<Config> solution;
   auto C_new = Config(N);  // for new configuration
@@ -250,7 +305,7 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
   }
 
   // DFS
-  while (!OPEN.empty() && !is_expired(deadline)) {
+  while (!OPEN.empty() && !is_expired(deadline) && !(stop_flag != nullptr && stop_flag->load(std::memory_order_relaxed))) {
     loop_cnt += 1;
 
     // do not pop here!
@@ -306,7 +361,6 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
 
     // create successors at the high-level search
     const auto res = get_new_config(H, L);
-    delete L;  // free
     if (!res) continue;
 
     // create successors at the high-level search
@@ -415,8 +469,9 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
 
     // no check explored list
     // insert new search node
-    const auto H_new = new HNode(
-        C_new, HT, ins, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new), H->d + 1, order_strategy, disable_agent_goals);
+    const auto H_new = arena->hnodes.allocate();
+    H_new->init(
+        C_new, HT, ins, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new), H->d + 1, order_strategy, disable_agent_goals, *arena);
     // EXPLORED[H_new->C] = H_new;
     if (H_goal == nullptr || H_new->f < H_goal->f) OPEN.push(H_new);
 
@@ -448,11 +503,11 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
       "optimal=" + std::to_string(H_goal != nullptr && OPEN.empty()) + "\n";
   additional_info += "objective=" + std::to_string(objective) + "\n";
   additional_info += "loop_cnt=" + std::to_string(loop_cnt) + "\n";
-  additional_info += "num_node_gen=" + std::to_string(EXPLORED.size()) + "\n";
+  additional_info += "num_node_gen=" + std::to_string(arena->hnodes.size()) + "\n";
 
   // memory management
   for (auto a : A) delete a;
-  for (auto itr : EXPLORED) delete itr.second;
+  arena->reset();
 
   return solution;
 }
@@ -461,7 +516,8 @@ void Planner::rewrite(HNode* H_from, HNode* H_to, HNode* H_goal,
                       std::stack<HNode*>& OPEN)
 {
   // update neighbors
-  H_from->neighbor.insert(H_to);
+  if (std::find(H_from->neighbor.begin(), H_from->neighbor.end(), H_to) == H_from->neighbor.end())
+    H_from->neighbor.push_back(H_to);
 
   // Dijkstra update
   std::queue<HNode*> Q({H_from});  // queue is sufficient
@@ -604,7 +660,11 @@ void Planner::expand_lowlevel_tree(HNode* H, LNode* L)
   // randomize
   if (MT != nullptr) std::shuffle(successors.begin(), successors.end(), *MT);
   // insert
-  for (auto s : successors) H->search_tree.push(new LNode(L, i, s));
+  for (auto s : successors) {
+    auto L_new = arena->lnodes.allocate();
+    L_new->init(L, i, s);
+    H->search_tree.push(L_new);
+  }
 }
 
 bool Planner::get_new_config(HNode* H, LNode* L)
@@ -632,10 +692,10 @@ bool Planner::get_new_config(HNode* H, LNode* L)
   //   }
   // }
 
-  // add constraints
-  for (uint k = 0; k < L->depth; ++k) {
-    const auto i = L->who[k];        // agent
-    const auto l = std::get<0>(L->where[k])->id;  // loc
+  // add constraints, from the deepest one up. any two conflicting constraints fail in either order.
+  for (auto L_k = L; L_k->parent != nullptr; L_k = L_k->parent) {
+    const auto i = L_k->who;        // agent
+    const auto l = L_k->where->id;  // loc
 
     // check vertex collision
     if (occupied_next[l] != nullptr){
@@ -653,10 +713,14 @@ bool Planner::get_new_config(HNode* H, LNode* L)
     }
 
     // set occupied_next
-    A[i]->v_next = std::get<0>(L->where[k]);
+    A[i]->v_next = L_k->where;
     occupied_next[l] = A[i];
   }
 
+  if (pibt_tile_size > 0) {
+    return tiled_PIBT(H);
+  }
+
   // perform PIBT
   for (auto k : H->order) {
     auto a = A[k];
@@ -670,6 +734,35 @@ bool Planner::get_new_config(HNode* H, LNode* L)
 }
 
 
+// an agent inside a tile only reaches the vertices of its tile, also by priority inheritance, because their
+// neighbors are in the tile as well, and the agents there next to another tile are already planned. so tiles don't
+// share any entry of occupied_now, occupied_next or C_next, and the result doesn't depend on the threads.
+bool Planner::tiled_PIBT(HNode* H)
+{
+  for (auto & agents : tile_agents) agents.clear();
+
+  for (auto k : H->order) {
+    auto a = A[k];
+    const int tile = vertex_tiles[a->v_now->id];
+    if (tile >= 0) {
+      tile_agents[tile].push_back(a);
+    } else if (a->v_next == nullptr && !funcPIBT(a, H)) {
+      return false;
+    }
+  }
+
+  int n_failed = 0;
+  #pragma omp parallel for schedule(dynamic,1) reduction(+:n_failed)
+  for (int tile = 0; tile < n_tiles; ++tile) {
+    for (auto a : tile_agents[tile]) {
+      if (a->v_next == nullptr && !funcPIBT(a, H, true)) {
+        ++n_failed;
+        break;
+      }
+    }
+  }
+  return n_failed == 0;
+}
 
 int get_o_dist(int o1, int o2) {
   return std::min((o2-o1+4)%4,(o1-o2+4)%4);
@@ -700,61 +793,58 @@ float Planner::get_cost_move(int pst, int ped) {
 
 }
 
-bool Planner::funcPIBT(Agent* ai, HNode * H)
+bool Planner::funcPIBT(Agent* ai, HNode * H, bool in_tile)
 {
   const auto i = ai->id;
-  const auto K = ai->v_now->neighbor.size();
-
-  // get candidates for next locations
-  for (auto k = 0; k < K; ++k) {
-    auto u = ai->v_now->neighbor[k];
-    C_next[i][k] = u;
-    if (MT != nullptr)
-      tie_breakers[u->id] = get_random_float(MT);  // set tie-breaker
+  const int K = (int)ai->v_now->neighbor.size();
+
+  // the tie breakers are not used by the scores below. skipping their draws keeps MT as it was, because each float
+  // takes one number from it.
+  if (MT != nullptr && !in_tile) MT->discard(K + 1);
+
+  // score the candidates, the neighbors and staying: on the precomputed path first, then by the estimated cost to
+  // the goal, then by the number of rotations. the score and the index of a candidate are packed into a key, so
+  // sorting the keys also breaks the remaining ties by index, as the stable sort of a few elements did before.
+  const int o0=H->C.orients[i];
+  const int pst=ai->v_now->index;
+  const float cost_rot=(*map_weights)[pst*5+4];
+  const int goal=ins->goals.locs[i]->index;
+  const ::Path * path=nullptr;
+  if (ins->precomputed_paths!=nullptr) {
+    auto & _path=(*ins->precomputed_paths)[i];
+    int j=H->d;
+    if (j<(int)_path.size()-1 && _path[j].location==pst && _path[j].orientation==o0) {
+      path=&_path;
+    }
   }
-  C_next[i][K] = ai->v_now;
-  tie_breakers[ai->v_now->id] = get_random_float(MT);  // set tie-breaker
 
-  // for (int j=0;j<K+1;++j){
-  //     std::cerr<<"check C_next "<<j<<" "<<K<<endl;
-  //     std::cerr<<C_next[i][j]<<endl;
-  // }
-
-  std::vector<std::tuple<int, float, float, Vertex *> > scores;
-
-  int o0=H->C.orients[i];
-  float cost_rot=(*map_weights)[ai->v_now->index*5+4];
+  Vertex * candidates[5];
+  uint64_t keys[5];
   for (int k=0;k<=K;++k) {
-    auto & v=C_next[i][k];
-    int o1=get_neighbor_orientation(ins->G,ai->v_now->index,v->index,o0);
+    Vertex * v=k<K?ai->v_now->neighbor[k]:ai->v_now;
+    candidates[k]=v;
+    int o1=k<K?ai->v_now->neighbor_orients[k]:o0;
     int o_dist1=get_o_dist(o0,o1);
-    float cost1=(float)o_dist1*cost_rot+get_cost_move(ai->v_now->index,v->index);
-    float d1=d1=HT->get(v->index,o1,ins->goals.locs[i]->index)+cost1;
-    int pre_d1=1;
-    if (ins->precomputed_paths!=nullptr){
-      auto & path=(*ins->precomputed_paths)[i];
-      int j=H->d;
-      if (j<path.size()-1 && path[j].location==ai->v_now->index && path[j].orientation==o0) {
-          if (path[j+1].orientation==o1) { // && ((o1==o0 && path[j+1].location==v->index) || (o1!=o0))) {
-            pre_d1=0;
-            // break;
-          }
-        }
-    }
-    scores.emplace_back(pre_d1, d1, o_dist1, v);
+    float cost1=(float)o_dist1*cost_rot+(*map_weights)[pst*5+(k<K?o1:4)];
+    float d1=HT->get(v->index,o1,goal)+cost1;
+    uint64_t pre_d1=(path!=nullptr && (*path)[H->d+1].orientation==o1)?0:1;
+    keys[k]=(pre_d1<<37)|((uint64_t)float_key(d1)<<5)|((uint64_t)o_dist1<<3)|(uint64_t)k;
+  }
+  for (int k=K+1;k<5;++k) {
+    keys[k]=UINT64_MAX;
   }
 
-
-  std::sort(scores.begin(),scores.end(),[&](const std::tuple<int, float, float, Vertex *> & a, const std::tuple<int, float, float, Vertex *> & b) {
-    if (std::get<0>(a)!=std::get<0>(b)) return std::get<0>(a)<std::get<0>(b);
-    if (std::get<1>(a)!=std::get<1>(b)) return std::get<1>(a)<std::get<1>(b);
-    return std::get<2>(a)<std::get<2>(b);
-  });
-
-  // std::sort(scores.begin(),scores.end()); // do we need stable sort?
+  // an optimal sorting network of 5 keys, whose compare-exchanges compile to conditional moves.
+  static constexpr int network[9][2]={{0,1},{3,4},{2,4},{2,3},{0,3},{0,2},{1,4},{1,3},{1,2}};
+  for (auto & c : network) {
+    uint64_t a=keys[c[0]];
+    uint64_t b=keys[c[1]];
+    keys[c[0]]=std::min(a,b);
+    keys[c[1]]=std::max(a,b);
+  }
 
   for (int k=0;k<=K;++k) {
-    C_next[i][k]=std::get<3>(scores[k]);
+    C_next[i][k]=candidates[keys[k]&7];
   }
 
   // sort
@@ -948,7 +1038,7 @@ bool Planner::funcPIBT(Agent* ai, HNode * H)
     ai->v_next = u;
 
     // priority inheritance
-    if (ak != nullptr && ak != ai && ak->v_next == nullptr && !funcPIBT(ak,H))
+    if (ak != nullptr && ak != ai && ak->v_next == nullptr && !funcPIBT(ak,H,in_tile))
       continue;
 
     // success to plan next one step
@@ -229,6 +229,70 @@ std::string MAPFPlanner::load_map_weights(string weights_path)
     return suffix;
 }
 
+void MAPFPlanner::load_weight_updates(string updates_path)
+{
+    printf("MAPFPlanner::load_weight_updates() updates_path:%s \n", updates_path.c_str());
+
+    // [{"timestep": t, "deltas": [[weight_idx, weight], ...]}, ...], where weight_idx is loc*5+dir as in the weight files.
+    std::ifstream f(updates_path);
+    try
+    {
+        nlohmann::json _updates = nlohmann::json::parse(f);
+        for (auto & _update: _updates) {
+            std::vector<WeightDelta> deltas;
+            for (auto & _delta: _update["deltas"]) {
+                int weight_idx=_delta[0].get<int>();
+                if (weight_idx<0 || weight_idx>=map_weights->size()) {
+                    std::cerr<<"weight update index "<<weight_idx<<" is out of the map weights"<<std::endl;
+                    exit(-1);
+                }
+                deltas.push_back({weight_idx,_delta[1].get<float>()});
+            }
+            weight_updates.emplace_back(_update["timestep"].get<int>(),deltas);
+        }
+    }
+    catch (nlohmann::json::exception error)
+    {
+        std::cerr << "Failed to load " << updates_path << std::endl;
+        std::cerr << "Message: " << error.what() << std::endl;
+        exit(1);
+    }
+
+    std::stable_sort(weight_updates.begin(),weight_updates.end(),[](const auto & a, const auto & b) {
+        return a.first<b.first;
+    });
+}
+
+void MAPFPlanner::update_map_weights(const std::vector<WeightDelta> & deltas) {
+    if (heuristics==nullptr) {
+        std::cerr<<"online weight updates need the heuristics of LaCAM2 or LNS"<<std::endl;
+        exit(-1);
+    }
+
+    if (lifelong_solver_name=="RHCR") {
+        std::cerr<<"RHCR plans with unit costs and doesn't support online weight updates"<<std::endl;
+        exit(-1);
+    }
+
+    if (lns_solver!=nullptr && lns_solver->sipp) {
+        std::cerr<<"SIPP needs uniform map weights and doesn't support online weight updates"<<std::endl;
+        exit(-1);
+    }
+
+    // deltas are relative to the weights of the last repair, so a pending one is waited for and swapped in first.
+    // the background LNS reads the heuristics, so it is stopped before and plan() resumes it.
+    if (heuristics_repair.valid()) {
+        if (lns_solver!=nullptr) {
+            lns_solver->stop_background();
+        }
+        heuristics->swap_in(*heuristics_repair.get());
+    }
+    auto table=heuristics;
+    heuristics_repair=std::async(std::launch::async,[table,deltas](){
+        return table->repair(deltas);
+    });
+}
+
 void MAPFPlanner::initialize(int preprocess_time_limit) 
 {
     printf("MAPFPlanner::initialize() \n");
@@ -250,12 +314,21 @@ void MAPFPlanner::initialize(int preprocess_time_limit)
     std::string weights_path=read_param_json<std::string>(config,"map_weights_path");
     std::string suffix=load_map_weights(weights_path);
 
+    std::string weight_updates_path=read_param_json<std::string>(config,"map_weight_updates_path","");
+    if (weight_updates_path!="") {
+        load_weight_updates(weight_updates_path);
+    }
+
     lifelong_solver_name=config["lifelong_solver_name"];
 
     // TODO: memory management is a disaster here...
     if (lifelong_solver_name=="RHCR") {
+        // RHCR searches with unit costs, so its table is built from unit weights to keep the heuristics admissible.
+        auto unit_weights=std::make_shared<std::vector<float> >(map_weights->size(),1);
+        heuristics =std::make_shared<HeuristicTable>(env,unit_weights,consider_rotation,config["heuristics"]);
+        heuristics->preprocess("all_one");
         auto graph = new RHCR::CompetitionGraph(*env);
-        graph->preprocessing(consider_rotation,env->file_storage_path);
+        graph->preprocessing(heuristics);
         auto mapf_solver=rhcr_build_mapf_solver(config["RHCR"],*graph);
         rhcr_solver = std::make_shared<RHCR::RHCRSolver>(*graph,*mapf_solver,env);
         rhcr_config_solver(rhcr_solver,config["RHCR"]);
@@ -267,7 +340,7 @@ void MAPFPlanner::initialize(int preprocess_time_limit)
             exit(-1);
         }
 
-        auto heuristics =std::make_shared<HeuristicTable>(env,map_weights,read_param_json<bool>(config["LaCAM2"],"use_orient_in_heuristic"));
+        heuristics =std::make_shared<HeuristicTable>(env,map_weights,read_param_json<bool>(config["LaCAM2"],"use_orient_in_heuristic"),config["heuristics"]);
         heuristics->preprocess(suffix);
         int max_agents_in_use=read_param_json<int>(config,"max_agents_in_use",-1);
         if (max_agents_in_use==-1) {
@@ -283,7 +356,7 @@ void MAPFPlanner::initialize(int preprocess_time_limit)
             std::cerr<<"In LNS, must not consider rotation when compiled with NO_ROT unset"<<std::endl;
             exit(-1);
         }
-        auto heuristics =std::make_shared<HeuristicTable>(env,map_weights,true);
+        heuristics =std::make_shared<HeuristicTable>(env,map_weights,true,config["heuristics"]);
         heuristics->preprocess(suffix);
         //heuristics->preprocess();
         int max_agents_in_use=read_param_json<int>(config,"max_agents_in_use",-1);
@@ -333,6 +406,22 @@ void MAPFPlanner::plan(int time_limit,vector<Action> & actions)
         return;
     }
 
+    // the solvers are idle between steps, so a finished repair can be swapped in here. the background LNS reads
+    // the heuristics, so it is stopped first and plan() resumes it.
+    if (heuristics_repair.valid() && heuristics_repair.wait_for(std::chrono::seconds(0))==std::future_status::ready) {
+        if (lns_solver!=nullptr) {
+            lns_solver->stop_background();
+        }
+        heuristics->swap_in(*heuristics_repair.get());
+        ONLYDEV(cout<<"repaired heuristics are swapped in"<<endl;)
+    }
+
+    // the weight updates due now are repaired in the background and swapped in at a later step.
+    while (next_weight_update<weight_updates.size() && weight_updates[next_weight_update].first<=env->curr_timestep) {
+        update_map_weights(weight_updates[next_weight_update].second);
+        ++next_weight_update;
+    }
+
     if (lifelong_solver_name=="RHCR") {
         cout<<"using RHCR"<<endl;
         rhcr_solver->plan(*env);
@@ -81,7 +81,11 @@ void RHCRSolver::stop_plan_task(){
 }
 
 void RHCRSolver::initialize(const SharedEnvironment & env){
-    graph.preprocessing(consider_rotation,env.file_storage_path);
+    // the graph is preprocessed with the shared heuristics before the solver is built.
+    if (graph.heuristics.table==nullptr) {
+        std::cerr<<"RHCR: the graph has no heuristics, call CompetitionGraph::preprocessing first"<<std::endl;
+        exit(-1);
+    }
     initialize_solvers();
     need_replan = true;
     timestep=0;
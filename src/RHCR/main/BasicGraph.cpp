@@ -134,125 +134,6 @@ int BasicGraph::get_direction(int from, int to) const
 }
 
 
-
-bool BasicGraph::load_heuristics_table(std::ifstream& myfile)
-{
-    boost::char_separator<char> sep(",");
-    boost::tokenizer< boost::char_separator<char> >::iterator beg;
-    std::string line;
-    
-    getline(myfile, line); //skip "table_size"
-    getline(myfile, line);
-    boost::tokenizer< boost::char_separator<char> > tok(line, sep);
-    beg = tok.begin();
-	int N = atoi ( (*beg).c_str() ); // read number of cols
-	beg++;
-	int M = atoi ( (*beg).c_str() ); // read number of rows
-	if (M != this->size())
-	    return false;
-	for (int i = 0; i < N; i++)
-	{
-		getline (myfile, line);
-        int loc = atoi(line.c_str());
-        getline (myfile, line);        
-        boost::tokenizer< boost::char_separator<char> > tok(line, sep);
-	    beg = tok.begin();
-        std::vector<double> h_table(this->size());
-        for (int j = 0; j < this->size(); j++)
-        {
-            h_table[j] = atof((*beg).c_str());
-            //  why this line? I'll remove it.
-            // if (h_table[j] >= INT_MAX && types[j] != "Obstacle")
-            //     types[j] = "Obstacle";
-            beg++;
-        }
-        heuristics[loc] = h_table;
-    }
-	return true;
-}
-
-
-void BasicGraph::save_heuristics_table(std::string fname)
-{
-    std::ofstream myfile;
-	myfile.open (fname);
-	myfile << "table_size" << std::endl << 
-        heuristics.size() << "," << this->size() << std::endl;
-	for (auto h_values: heuristics) 
-	{
-        myfile << h_values.first << std::endl;
-		for (double h : h_values.second) 
-		{
-            myfile << h << ",";
-		}
-		myfile << std::endl;
-	}
-	myfile.close();
-}
-
-std::vector<double> BasicGraph::compute_heuristics(int root_location)
-{
-    std::vector<double> res(this->size(), DBL_MAX);
-	fibonacci_heap< StateTimeAStarNode*, compare<StateTimeAStarNode::compare_node> > heap;
-    unordered_set< StateTimeAStarNode*, StateTimeAStarNode::Hasher, StateTimeAStarNode::EqNode> nodes;
-
-    State root_state(root_location);
-    if(consider_rotation)
-    {
-        for (auto neighbor : get_reverse_neighbors(root_state))
-        {
-            StateTimeAStarNode* root = new StateTimeAStarNode(State(root_location, -1,
-                    get_direction(neighbor.location, root_state.location)), 0, 0, nullptr, 0);
-            root->open_handle = heap.push(root);  // add root to heap
-            nodes.insert(root);       // add root to hash_table (nodes)
-        }
-    }
-    else
-    {
-        StateTimeAStarNode* root = new StateTimeAStarNode(root_state, 0, 0, nullptr, 0);
-        root->open_handle = heap.push(root);  // add root to heap
-        nodes.insert(root);       // add root to hash_table (nodes)
-    }
-
-	while (!heap.empty()) 
-    {
-        StateTimeAStarNode* curr = heap.top();
-		heap.pop();
-		for (auto next_state : get_reverse_neighbors(curr->state))
-		{
-			double next_g_val = curr->g_val + get_weight(next_state.location, curr->state.location);
-            StateTimeAStarNode* next = new StateTimeAStarNode(next_state, next_g_val, 0, nullptr, 0);
-			auto it = nodes.find(next);
-			if (it == nodes.end()) 
-			{  // add the newly generated node to heap and hash table
-				next->open_handle = heap.push(next);
-				nodes.insert(next);
-			}
-			else 
-			{  // update existing node's g_val if needed (only in the heap)
-				delete(next);  // not needed anymore -- we already generated it before
-                StateTimeAStarNode* existing_next = *it;
-				if (existing_next->g_val > next_g_val) 
-				{
-					existing_next->g_val = next_g_val;
-					heap.increase(existing_next->open_handle);
-				}
-			}
-		}
-	}
-	// iterate over all nodes and populate the distances
-	for (auto it = nodes.begin(); it != nodes.end(); it++)
-	{
-        StateTimeAStarNode* s = *it;
-		res[s->state.location] = std::min(s->g_val, res[s->state.location]);
-		delete (s);
-	}
-	nodes.clear();
-	heap.clear();
-    return res;
-}
-
-
 int BasicGraph::get_Manhattan_distance(int loc1, int loc2) const
 {
     return abs(loc1 / cols - loc2 / cols) + abs(loc1 % cols - loc2 % cols);
@@ -0,0 +1,405 @@
+#include "util/CorridorHeuristics.h"
+#include <omp.h>
+#include <queue>
+#include <cfloat>
+#include <iostream>
+#include <chrono>
+
+// the same as MAX_HEURISTIC
+static const float UNREACHABLE=FLT_MAX/16;
+
+typedef std::pair<float,int> QueueItem;
+typedef std::priority_queue<QueueItem,std::vector<QueueItem>,std::greater<QueueItem> > MinQueue;
+
+CorridorHeuristics::CorridorHeuristics(const SharedEnvironment & env, const std::vector<float> & weights, int n_orientations,
+    const int * empty_locs, const int * loc_idxs, size_t loc_size):
+    env(env), weights(weights), n_orientations(n_orientations), empty_locs(empty_locs), loc_idxs(loc_idxs), loc_size(loc_size) {
+}
+
+int CorridorHeuristics::get_neighbor(int loc, int dir) const {
+    int x=loc%env.cols;
+    int y=loc/env.cols;
+    int next_loc=-1;
+    if (dir==0 && x+1<env.cols) {
+        next_loc=loc+1;
+    } else if (dir==1 && y+1<env.rows) {
+        next_loc=loc+env.cols;
+    } else if (dir==2 && x-1>=0) {
+        next_loc=loc-1;
+    } else if (dir==3 && y-1>=0) {
+        next_loc=loc-env.cols;
+    }
+    if (next_loc==-1 || env.map[next_loc]!=0) {
+        return -1;
+    }
+    return next_loc;
+}
+
+void CorridorHeuristics::compute() {
+    auto start=std::chrono::steady_clock::now();
+
+    classify_cells();
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for (int corridor_id=0;corridor_id<(int)corridors.size();++corridor_id) {
+        compute_corridor_costs(corridor_id);
+    }
+
+    compute_junction_dists();
+
+    double elapse=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    std::cout<<"corridor heuristics: "<<junction_locs.size()<<" junctions, "<<corridors.size()<<" corridors with "
+        <<corridor_cells.size()<<" cells, "<<memory_bytes()/1024/1024<<" MB, computed in "<<elapse<<"s"<<std::endl;
+}
+
+void CorridorHeuristics::classify_cells() {
+    std::vector<char> is_corridor(loc_size,0);
+    for (size_t loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        int degree=0;
+        for (int dir=0;dir<4;++dir) {
+            if (get_neighbor(empty_locs[loc_idx],dir)!=-1) {
+                ++degree;
+            }
+        }
+        is_corridor[loc_idx]=degree==2;
+    }
+
+    // the corridor neighbor of loc_idx other than prev_idx, or -1 if there is none.
+    auto next_in_corridor=[&](int loc_idx, int prev_idx) {
+        for (int dir=0;dir<4;++dir) {
+            int next_loc=get_neighbor(empty_locs[loc_idx],dir);
+            if (next_loc==-1) {
+                continue;
+            }
+            int next_idx=loc_idxs[next_loc];
+            if (next_idx!=prev_idx && is_corridor[next_idx]) {
+                return next_idx;
+            }
+        }
+        return -1;
+    };
+
+    corridor_ids.assign(loc_size,-1);
+    corridor_poses.assign(loc_size,-1);
+    for (size_t loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        if (!is_corridor[loc_idx] || corridor_ids[loc_idx]!=-1) {
+            continue;
+        }
+
+        // walk to one end. a ring without junctions is cut by turning its first cell into a junction.
+        int prev_idx=-1;
+        int curr_idx=(int)loc_idx;
+        bool ring=false;
+        while (true) {
+            int next_idx=next_in_corridor(curr_idx,prev_idx);
+            if (next_idx==-1) {
+                break;
+            }
+            if (next_idx==(int)loc_idx) {
+                ring=true;
+                break;
+            }
+            prev_idx=curr_idx;
+            curr_idx=next_idx;
+        }
+        if (ring) {
+            is_corridor[loc_idx]=0;
+            continue;
+        }
+
+        Corridor corridor;
+        corridor.cell_offset=(int)corridor_cells.size();
+        int corridor_id=(int)corridors.size();
+        prev_idx=-1;
+        while (curr_idx!=-1) {
+            corridor_ids[curr_idx]=corridor_id;
+            corridor_poses[curr_idx]=(int)corridor_cells.size()-corridor.cell_offset;
+            corridor_cells.push_back(curr_idx);
+            int next_idx=next_in_corridor(curr_idx,prev_idx);
+            prev_idx=curr_idx;
+            curr_idx=next_idx;
+        }
+        corridor.length=(int)corridor_cells.size()-corridor.cell_offset;
+        corridors.push_back(corridor);
+    }
+
+    junction_idxs.assign(loc_size,-1);
+    for (size_t loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        if (!is_corridor[loc_idx]) {
+            junction_idxs[loc_idx]=(int)junction_locs.size();
+            junction_locs.push_back((int)loc_idx);
+        }
+    }
+    n_junction_states=junction_locs.size()*n_orientations;
+
+    // the junctions at both ends and the offsets of per-corridor tables
+    size_t exit_cost_size=0;
+    size_t enter_cost_size=0;
+    size_t inner_size=0;
+    for (auto & corridor: corridors) {
+        // the steps out of the corridor. a single-cell corridor has both of them at the same cell.
+        int side=0;
+        for (int end_pos=0;end_pos<corridor.length;end_pos+=std::max(corridor.length-1,1)) {
+            int end_idx=corridor_cells[corridor.cell_offset+end_pos];
+            for (int dir=0;dir<4;++dir) {
+                int next_loc=get_neighbor(empty_locs[end_idx],dir);
+                if (next_loc==-1 || corridor_ids[loc_idxs[next_loc]]==corridor_ids[end_idx]) {
+                    continue;
+                }
+                int junction_idx=junction_idxs[loc_idxs[next_loc]];
+                int entry_dir=(dir+2)%4;
+                corridor.end_poses[side]=end_pos;
+                corridor.exit_dirs[side]=dir;
+                corridor.exit_states[side]=junction_idx*n_orientations+(n_orientations==4?dir:0);
+                corridor.entry_states[side]=junction_idx*n_orientations+(n_orientations==4?entry_dir:0);
+                corridor.entry_move_costs[side]=weights[next_loc*5+entry_dir];
+                ++side;
+            }
+        }
+        if (side!=2) {
+            std::cerr<<"a corridor should have two ends, but it has "<<side<<std::endl;
+            exit(-1);
+        }
+
+        corridor.exit_cost_offset=exit_cost_size;
+        corridor.enter_cost_offset=enter_cost_size;
+        corridor.inner_offset=inner_size;
+        exit_cost_size+=(size_t)corridor.length*n_orientations*2;
+        enter_cost_size+=(size_t)corridor.length*2;
+        inner_size+=(size_t)corridor.length*n_orientations*corridor.length;
+    }
+    exit_costs.assign(exit_cost_size,UNREACHABLE);
+    enter_costs.assign(enter_cost_size,UNREACHABLE);
+    inner_costs.assign(inner_size,UNREACHABLE);
+}
+
+void CorridorHeuristics::compute_corridor_costs(int corridor_id) {
+    const Corridor & corridor=corridors[corridor_id];
+    int length=corridor.length;
+    int n_states=length*n_orientations;
+    std::vector<float> dists(n_states);
+    MinQueue queue;
+
+    // search from every corridor state without leaving the corridor.
+    for (int start_state=0;start_state<n_states;++start_state) {
+        std::fill(dists.begin(),dists.end(),UNREACHABLE);
+        float * exits=exit_costs.data()+corridor.exit_cost_offset+(size_t)start_state*2;
+        float * inner=inner_costs.data()+corridor.inner_offset+(size_t)start_state*length;
+
+        dists[start_state]=0;
+        queue.emplace(0,start_state);
+        while (!queue.empty()) {
+            float g=queue.top().first;
+            int state=queue.top().second;
+            queue.pop();
+            if (g>dists[state]) {
+                continue;
+            }
+
+            int pos=state/n_orientations;
+            int orient=state%n_orientations;
+            int loc=empty_locs[corridor_cells[corridor.cell_offset+pos]];
+            inner[pos]=std::min(inner[pos],g);
+
+            auto relax=[&](int next_state, float next_g) {
+                if (next_g<dists[next_state]) {
+                    dists[next_state]=next_g;
+                    queue.emplace(next_g,next_state);
+                }
+            };
+
+            if (n_orientations==4) {
+                float cost=weights[loc*5+4];
+                relax(pos*4+(orient+1)%4,g+cost);
+                relax(pos*4+(orient+3)%4,g+cost);
+            }
+
+            for (int dir=0;dir<4;++dir) {
+                if (n_orientations==4 && dir!=orient) {
+                    continue;
+                }
+                int next_loc=get_neighbor(loc,dir);
+                if (next_loc==-1) {
+                    continue;
+                }
+                float next_g=g+weights[loc*5+dir];
+                int next_idx=loc_idxs[next_loc];
+                if (corridor_ids[next_idx]==corridor_id) {
+                    relax(corridor_poses[next_idx]*n_orientations+(n_orientations==4?dir:0),next_g);
+                } else {
+                    for (int side=0;side<2;++side) {
+                        if (corridor.end_poses[side]==pos && corridor.exit_dirs[side]==dir) {
+                            exits[side]=std::min(exits[side],next_g);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // entering from a side is the step in followed by the search from the end state.
+    for (int side=0;side<2;++side) {
+        int entry_orient=n_orientations==4?(corridor.exit_dirs[side]+2)%4:0;
+        int end_state=corridor.end_poses[side]*n_orientations+entry_orient;
+        const float * inner=inner_costs.data()+corridor.inner_offset+(size_t)end_state*length;
+        float * enter=enter_costs.data()+corridor.enter_cost_offset+(size_t)side*length;
+        for (int pos=0;pos<length;++pos) {
+            if (inner[pos]<UNREACHABLE) {
+                enter[pos]=corridor.entry_move_costs[side]+inner[pos];
+            }
+        }
+    }
+}
+
+void CorridorHeuristics::compute_junction_dists() {
+    // the contracted graph over junction states: rotations and steps between junctions,
+    // and passing through a corridor from its entry state to one of its exit states.
+    std::vector<std::vector<std::pair<int,float> > > edges(n_junction_states);
+    for (size_t junction_idx=0;junction_idx<junction_locs.size();++junction_idx) {
+        int loc=empty_locs[junction_locs[junction_idx]];
+        for (int orient=0;orient<n_orientations;++orient) {
+            int state=(int)junction_idx*n_orientations+orient;
+            if (n_orientations==4) {
+                float cost=weights[loc*5+4];
+                edges[state].emplace_back((int)junction_idx*4+(orient+1)%4,cost);
+                edges[state].emplace_back((int)junction_idx*4+(orient+3)%4,cost);
+            }
+
+            for (int dir=0;dir<4;++dir) {
+                if (n_orientations==4 && dir!=orient) {
+                    continue;
+                }
+                int next_loc=get_neighbor(loc,dir);
+                if (next_loc==-1) {
+                    continue;
+                }
+                int next_idx=loc_idxs[next_loc];
+                if (junction_idxs[next_idx]!=-1) {
+                    edges[state].emplace_back(junction_idxs[next_idx]*n_orientations+(n_orientations==4?dir:0),weights[loc*5+dir]);
+                }
+            }
+        }
+    }
+
+    for (auto & corridor: corridors) {
+        for (int side=0;side<2;++side) {
+            int entry_orient=n_orientations==4?(corridor.exit_dirs[side]+2)%4:0;
+            int end_state=corridor.end_poses[side]*n_orientations+entry_orient;
+            const float * exits=exit_costs.data()+corridor.exit_cost_offset+(size_t)end_state*2;
+            for (int exit_side=0;exit_side<2;++exit_side) {
+                if (exits[exit_side]<UNREACHABLE) {
+                    edges[corridor.entry_states[side]].emplace_back(corridor.exit_states[exit_side],corridor.entry_move_costs[side]+exits[exit_side]);
+                }
+            }
+        }
+    }
+
+    // only the columns used by get() are kept: junctions in any orientation and the entry states of corridors.
+    // without rotation, an entry state is a junction and shares its column.
+    size_t n_junctions=junction_locs.size();
+    n_junction_columns=n_junctions;
+    for (auto & corridor: corridors) {
+        for (int side=0;side<2;++side) {
+            if (n_orientations==1) {
+                corridor.entry_columns[side]=corridor.entry_states[side];
+            } else {
+                corridor.entry_columns[side]=(int)n_junction_columns++;
+            }
+        }
+    }
+    junction_dists.assign(n_junction_states*n_junction_columns,UNREACHABLE);
+
+    #pragma omp parallel
+    {
+        MinQueue queue;
+        std::vector<float> dists(n_junction_states);
+        #pragma omp for schedule(dynamic,1)
+        for (int start_state=0;start_state<(int)n_junction_states;++start_state) {
+            std::fill(dists.begin(),dists.end(),UNREACHABLE);
+            dists[start_state]=0;
+            queue.emplace(0,start_state);
+            while (!queue.empty()) {
+                float g=queue.top().first;
+                int state=queue.top().second;
+                queue.pop();
+                if (g>dists[state]) {
+                    continue;
+                }
+                for (auto & edge: edges[state]) {
+                    float next_g=g+edge.second;
+                    if (next_g<dists[edge.first]) {
+                        dists[edge.first]=next_g;
+                        queue.emplace(next_g,edge.first);
+                    }
+                }
+            }
+
+            float * row=junction_dists.data()+(size_t)start_state*n_junction_columns;
+            for (size_t junction_idx=0;junction_idx<n_junctions;++junction_idx) {
+                for (int orient=0;orient<n_orientations;++orient) {
+                    row[junction_idx]=std::min(row[junction_idx],dists[junction_idx*n_orientations+orient]);
+                }
+            }
+            if (n_orientations>1) {
+                for (auto & corridor: corridors) {
+                    for (int side=0;side<2;++side) {
+                        row[corridor.entry_columns[side]]=dists[corridor.entry_states[side]];
+                    }
+                }
+            }
+        }
+    }
+}
+
+float CorridorHeuristics::get(int loc_idx1, int orient1, int loc_idx2) const {
+    float cost=UNREACHABLE;
+    int junction_idx2=junction_idxs[loc_idx2];
+    const Corridor * corridor2=junction_idx2==-1?&corridors[corridor_ids[loc_idx2]]:nullptr;
+    const float * enter2=junction_idx2==-1?enter_costs.data()+corridor2->enter_cost_offset+corridor_poses[loc_idx2]:nullptr;
+
+    // from a junction state to the goal, in any orientation if the goal is a junction,
+    // or through the last entry into its corridor otherwise.
+    auto from_junction_state=[&](int state) {
+        const float * dists=junction_dists.data()+(size_t)state*n_junction_columns;
+        if (corridor2==nullptr) {
+            return dists[junction_idx2];
+        }
+        return std::min(dists[corridor2->entry_columns[0]]+enter2[0],dists[corridor2->entry_columns[1]]+enter2[corridor2->length]);
+    };
+
+    int junction_idx1=junction_idxs[loc_idx1];
+    if (junction_idx1!=-1) {
+        cost=from_junction_state(junction_idx1*n_orientations+orient1);
+    } else {
+        // through the first exit from the start corridor
+        int corridor_id1=corridor_ids[loc_idx1];
+        const Corridor & corridor1=corridors[corridor_id1];
+        int state1=corridor_poses[loc_idx1]*n_orientations+orient1;
+        const float * exits=exit_costs.data()+corridor1.exit_cost_offset+(size_t)state1*2;
+        for (int side=0;side<2;++side) {
+            if (exits[side]<UNREACHABLE) {
+                cost=std::min(cost,exits[side]+from_junction_state(corridor1.exit_states[side]));
+            }
+        }
+        // or without leaving the corridor
+        if (corridor2==&corridor1) {
+            cost=std::min(cost,inner_costs[corridor1.inner_offset+(size_t)state1*corridor1.length+corridor_poses[loc_idx2]]);
+        }
+    }
+
+    return cost>=UNREACHABLE?UNREACHABLE:cost;
+}
+
+float CorridorHeuristics::get(int loc_idx1, int loc_idx2) const {
+    float cost=UNREACHABLE;
+    for (int orient=0;orient<n_orientations;++orient) {
+        cost=std::min(cost,get(loc_idx1,orient,loc_idx2));
+    }
+    return cost;
+}
+
+size_t CorridorHeuristics::memory_bytes() const {
+    return sizeof(float)*(exit_costs.size()+enter_costs.size()+inner_costs.size()+junction_dists.size())
+        +sizeof(int)*(junction_idxs.size()+junction_locs.size()+corridor_ids.size()+corridor_poses.size()+corridor_cells.size())
+        +sizeof(Corridor)*corridors.size();
+}
@@ -1,11 +1,42 @@
 #include "util/HeuristicTable.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+HeuristicMode parse_heuristic_mode(const string & name) {
+    if (name=="dense") {
+        return HeuristicMode::DENSE;
+    } else if (name=="lazy") {
+        return HeuristicMode::LAZY;
+    } else if (name=="quantized") {
+        return HeuristicMode::QUANTIZED;
+    } else if (name=="corridor") {
+        return HeuristicMode::CORRIDOR;
+    } else if (name=="landmark") {
+        return HeuristicMode::LANDMARK;
+    }
+    std::cerr<<"unknown heuristic mode: "<<name<<endl;
+    exit(-1);
+}
+
+static std::atomic<size_t> heuristic_table_counter{0};
     
-    
-HeuristicTable::HeuristicTable(SharedEnvironment * _env, const std::shared_ptr<std::vector<float> > & map_weights, bool consider_rotation):
+HeuristicTable::HeuristicTable(SharedEnvironment * _env, const std::shared_ptr<std::vector<float> > & map_weights, bool consider_rotation, nlohmann::json config):
     env(*_env),
     action_model(_env),
+    main_heuristics(nullptr),
+    sub_heuristics(nullptr),
     consider_rotation(consider_rotation),
-    map_weights(map_weights) 
+    map_weights(map_weights),
+    config(config),
+    table_id(heuristic_table_counter++)
 {
     printf("HeuristicTable::HeuristicTable()   Note: env is SharedEnvironment class \n");
     printf("    env - rows:%i cols:%i num_of_agents:%i \n", env.rows, env.cols, env.num_of_agents);
@@ -55,19 +86,135 @@ HeuristicTable::HeuristicTable(SharedEnvironment * _env, const std::shared_ptr<s
     ONLYDEV(assert(loc_idx==loc_size);)
 
     state_size = loc_size*n_orientations;
+
+    mode=parse_heuristic_mode(read_param_json<string>(config,"mode","dense"));
+
+    if (mode==HeuristicMode::LAZY) {
+        // a row holds a float for each state
+        size_t cache_size_mb=read_param_json<size_t>(config,"lazy_cache_size_mb",4096);
+        size_t row_bytes=sizeof(float)*state_size;
+        size_t capacity=std::max((size_t)1,cache_size_mb*1024*1024/row_bytes);
+        row_cache=std::make_unique<HeuristicRowCache>(capacity);
+        printf("    Lazy heuristics: cache capacity %zu rows (%zu MB) \n", capacity, cache_size_mb);
+        return;
+    }
+
+    if (mode==HeuristicMode::CORRIDOR) {
+        corridor_heuristics=std::make_unique<CorridorHeuristics>(env,*map_weights,n_orientations,empty_locs,loc_idxs,loc_size);
+        return;
+    }
+
+    if (mode==HeuristicMode::LANDMARK) {
+        n_landmarks=std::min(read_param_json<int>(config,"landmark_count",16),(int)loc_size);
+        hot_goal_queries=read_param_json<uint32_t>(config,"landmark_hot_goal_queries",20);
+        size_t cache_size_mb=read_param_json<size_t>(config,"landmark_cache_size_mb",1024);
+        if (n_landmarks<=0) {
+            std::cerr<<"landmark_count should be positive: "<<n_landmarks<<endl;
+            exit(-1);
+        }
+        size_t row_bytes=sizeof(float)*state_size;
+        size_t capacity=std::max((size_t)1,cache_size_mb*1024*1024/row_bytes);
+        row_cache=std::make_unique<HeuristicRowCache>(capacity);
+        goal_query_counts.reset(new std::atomic<uint32_t>[loc_size]);
+        hot_goals.reset(new std::atomic<bool>[loc_size]);
+        for (size_t i=0;i<loc_size;++i) {
+            goal_query_counts[i]=0;
+            hot_goals[i]=false;
+        }
+        printf("    Landmark heuristics: %d landmarks, exact rows for goals queried %u times, cache capacity %zu rows (%zu MB) \n",
+            n_landmarks, hot_goal_queries, capacity, cache_size_mb);
+        return;
+    }
+
+    file_format=read_param_json<string>(config,"file_format","gz");
+    chunk_rows=read_param_json<int>(config,"chunk_rows",64);
+    if (chunk_rows<=0) {
+        std::cerr<<"chunk_rows should be positive: "<<chunk_rows<<endl;
+        exit(-1);
+    }
+    if (file_format!="gz" && file_format!="mmap" && file_format!="chunked") {
+        std::cerr<<"unknown heuristic file format: "<<file_format<<endl;
+        exit(-1);
+    }
+
+    if (mode==HeuristicMode::QUANTIZED) {
+        init_quantization(read_param_json<int>(config,"quantized_sub_bits",4));
+    }
+
+    // tables are allocated when they are computed or loaded, a mapped file needs no allocation.
+};
+
+void HeuristicTable::allocate_tables() {
+    if (main_heuristics!=nullptr || main_heuristics_q!=nullptr) {
+        return;
+    }
+
+    if (mode==HeuristicMode::QUANTIZED) {
+        main_heuristics_q = new uint16_t[loc_size*loc_size];
+        std::fill(main_heuristics_q,main_heuristics_q+loc_size*loc_size,QUANT_UNREACHABLE);
+        if (consider_rotation) {
+            sub_heuristics_q = new uint8_t[loc_size*loc_size*sub_bytes];
+            std::fill(sub_heuristics_q,sub_heuristics_q+loc_size*loc_size*sub_bytes,0);
+        }
+        return;
+    }
+
     main_heuristics = new float[loc_size*loc_size];
     std::fill(main_heuristics,main_heuristics+loc_size*loc_size,MAX_HEURISTIC);
     // we keep start_loc, end_loc, start_orient, namely no goal_orient
-    if (consider_rotation)
+    if (consider_rotation) {
         sub_heuristics = new float[state_size*loc_size];
-};
+        // rows that are never filled, e.g. by a partial load, must stay finite.
+        std::fill(sub_heuristics,sub_heuristics+state_size*loc_size,0);
+    }
+}
+
+void HeuristicTable::release_tables() {
+    if (mmap_addr!=nullptr) {
+        munmap(mmap_addr,mmap_size);
+        mmap_addr=nullptr;
+        mmap_size=0;
+    } else {
+        delete [] main_heuristics;
+        delete [] sub_heuristics;
+        delete [] main_heuristics_q;
+        delete [] sub_heuristics_q;
+    }
+    main_heuristics=nullptr;
+    sub_heuristics=nullptr;
+    main_heuristics_q=nullptr;
+    sub_heuristics_q=nullptr;
+}
+
+size_t HeuristicTable::main_table_bytes() const {
+    if (mode==HeuristicMode::QUANTIZED) {
+        return sizeof(uint16_t)*loc_size*loc_size;
+    }
+    return sizeof(float)*loc_size*loc_size;
+}
+
+size_t HeuristicTable::sub_table_bytes() const {
+    if (!consider_rotation) {
+        return 0;
+    }
+    if (mode==HeuristicMode::QUANTIZED) {
+        return sizeof(uint8_t)*sub_bytes*loc_size*loc_size;
+    }
+    return sizeof(float)*state_size*loc_size;
+}
 
 HeuristicTable::~HeuristicTable() {
+    if (mode==HeuristicMode::LAZY || mode==HeuristicMode::LANDMARK) {
+        print_lazy_stats();
+    }
+
     delete [] empty_locs;
     delete [] loc_idxs;
-    delete [] main_heuristics;
-    if (consider_rotation)
-        delete [] sub_heuristics;
+    release_tables();
+    delete [] delta_units;
+    for (auto planner: planner_pool) {
+        delete planner;
+    }
 }
 
 // weights is an array of [loc_size*n_orientations]
@@ -79,12 +226,61 @@ void HeuristicTable::compute_weighted_heuristics(){
     
     ONLYDEV(g_timer.record_p("heu/compute_start");)
 
+    if (mode==HeuristicMode::LANDMARK) {
+        compute_landmarks();
+        ONLYDEV(g_timer.record_d("heu/compute_start","heu/compute_end","heu/compute");)
+        DEV_DEBUG("[end] Compute heuristics. (duration: {:.3f})", g_timer.get_d("heu/compute"));
+        return;
+    }
+
+    if (mode==HeuristicMode::CORRIDOR) {
+        corridor_heuristics->compute();
+        ONLYDEV(g_timer.record_d("heu/compute_start","heu/compute_end","heu/compute");)
+        DEV_DEBUG("[end] Compute heuristics. (duration: {:.3f})", g_timer.get_d("heu/compute"));
+        return;
+    }
+
+    allocate_tables();
+
+    std::vector<int> start_loc_idxs(loc_size);
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        start_loc_idxs[loc_idx]=loc_idx;
+    }
+    compute_rows(start_loc_idxs);
+
+    if (mode==HeuristicMode::QUANTIZED && n_saturated>0) {
+        cout<<"quantized heuristics: "<<n_saturated<<" distances are clamped to the largest representable value"<<endl;
+    }
+
+    ONLYDEV(g_timer.record_d("heu/compute_start","heu/compute_end","heu/compute");)
+
+    DEV_DEBUG("[end] Compute heuristics. (duration: {:.3f})", g_timer.get_d("heu/compute"));
+}
+
+void HeuristicTable::compute_rows(const std::vector<int> & start_loc_idxs) {
     int n_threads=omp_get_max_threads();
     // BS::thread_pool pool(n_threads);
 
     // int n_threads=pool.get_thread_count();
     cout<<"number of threads used for heuristic computation: "<<n_threads<<endl;
+    // small integer weights: the rows of several start locations are computed together, see MultiSourceDial.
+    int max_weight=UTIL::SPATIAL::SpatialAStar::get_max_integer_weight(env,*map_weights);
+    if (max_weight>0 && max_weight<=UTIL::SPATIAL::MultiSourceDial::max_batch_weight) {
+        _compute_weighted_heuristics_batched(start_loc_idxs,n_threads,max_weight);
+    } else {
+        _compute_weighted_heuristics_per_source(start_loc_idxs,n_threads);
+    }
+}
+
+// one search per start location and orientation, on the heap or the bucket queue of SpatialAStar.
+void HeuristicTable::_compute_weighted_heuristics_per_source(const std::vector<int> & start_loc_idxs, int n_threads) {
     float * values = new float[n_threads*n_orientations*state_size];
+    // in quantized mode, rows are computed in float first and then packed.
+    size_t row_buffer_size=loc_size+state_size;
+    float * row_buffers = nullptr;
+    if (mode==HeuristicMode::QUANTIZED) {
+        row_buffers = new float[n_threads*row_buffer_size];
+    }
     UTIL::SPATIAL::SpatialAStar ** planners= new UTIL::SPATIAL::SpatialAStar* [n_threads];
     for (int i=0;i<n_threads;++i) {
         planners[i]=new UTIL::SPATIAL::SpatialAStar(env,n_orientations,*map_weights);
@@ -97,16 +293,27 @@ void HeuristicTable::compute_weighted_heuristics(){
     auto start = std::chrono::steady_clock::now();
 
     // Computes the weights for every location in the map. Size of Map == Rows * Columns
+    int n_rows=(int)start_loc_idxs.size();
     #pragma omp parallel for schedule(dynamic,1)
-    for (int loc_idx=0;loc_idx<loc_size;++loc_idx)
+    for (int i=0;i<n_rows;++i)
     {
+        int loc_idx=start_loc_idxs[i];
         int thread_id=omp_get_thread_num();
 
         int s_idx=thread_id*n_orientations*state_size;
 
         // printf("     _compute_weighted_heuristics() - loc_idx:%i thread_id:%i s_idx:%i \n", loc_idx, thread_id, s_idx);
 
-        _compute_weighted_heuristics(loc_idx, values+s_idx, planners[thread_id]);
+        if (mode==HeuristicMode::QUANTIZED) {
+            float * main_row=row_buffers+thread_id*row_buffer_size;
+            float * sub_row=main_row+loc_size;
+            _compute_weighted_heuristics(loc_idx, values+s_idx, planners[thread_id], main_row, sub_row);
+            store_quantized_row(loc_idx, main_row, sub_row);
+        } else {
+            float * main_row=main_heuristics+(size_t)loc_idx*loc_size;
+            float * sub_row=consider_rotation?sub_heuristics+(size_t)loc_idx*state_size:nullptr;
+            _compute_weighted_heuristics(loc_idx, values+s_idx, planners[thread_id], main_row, sub_row);
+        }
 
 
         #pragma omp critical
@@ -115,8 +322,8 @@ void HeuristicTable::compute_weighted_heuristics(){
             if (ctr%step==0){
                 auto end = std::chrono::steady_clock::now();
                 double elapse=std::chrono::duration<double>(end-start).count();
-                double estimated_remain=elapse/ctr*(loc_size-ctr);
-                cout<< "HeuristicTable::compute_weighted_heuristics() " << ctr<<"/"<<loc_size<<" traversable cells done in "<<elapse<<"s. est time to fin. all: "<<estimated_remain<<"s.  est total time: "<<(estimated_remain+elapse)<<"s." <<endl;
+                double estimated_remain=elapse/ctr*(n_rows-ctr);
+                cout<< "HeuristicTable::compute_weighted_heuristics() " << ctr<<"/"<<n_rows<<" traversable cells done in "<<elapse<<"s. est time to fin. all: "<<estimated_remain<<"s.  est total time: "<<(estimated_remain+elapse)<<"s." <<endl;
             }
         }
 
@@ -129,20 +336,96 @@ void HeuristicTable::compute_weighted_heuristics(){
     }
 
     delete [] values;
+    delete [] row_buffers;
     for (int i=0;i<n_threads;++i) {
         delete planners[i];
     }
     delete planners;
+}
 
-    ONLYDEV(g_timer.record_d("heu/compute_start","heu/compute_end","heu/compute");)
+// with small integer weights, MultiSourceDial searches from the start orientations of several locations at once.
+void HeuristicTable::_compute_weighted_heuristics_batched(const std::vector<int> & start_loc_idxs, int n_threads, int max_weight) {
+    int batch_size=UTIL::SPATIAL::MultiSourceDial::n_lanes/n_orientations;
+    int n_rows=(int)start_loc_idxs.size();
+    int n_batches=(n_rows+batch_size-1)/batch_size;
+    // [thread][lane][state], a lane is the row of a start location in a start orientation.
+    size_t batch_values_size=(size_t)batch_size*n_orientations*state_size;
+    float * batch_values = new float[n_threads*batch_values_size];
+    size_t row_buffer_size=loc_size+state_size;
+    float * row_buffers = nullptr;
+    if (mode==HeuristicMode::QUANTIZED) {
+        row_buffers = new float[n_threads*row_buffer_size];
+    }
+    UTIL::SPATIAL::MultiSourceDial ** planners= new UTIL::SPATIAL::MultiSourceDial* [n_threads];
+    for (int i=0;i<n_threads;++i) {
+        planners[i]=new UTIL::SPATIAL::MultiSourceDial(env,n_orientations,*map_weights,max_weight,empty_locs,loc_idxs,loc_size);
+    }
 
-    DEV_DEBUG("[end] Compute heuristics. (duration: {:.3f})", g_timer.get_d("heu/compute"));
+    cout<<"batched heuristic computation: "<<batch_size<<" locations per search, max weight "<<max_weight<<endl;
+
+    int ctr=0;
+    int step=100;
+    auto start = std::chrono::steady_clock::now();
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for (int batch_idx=0;batch_idx<n_batches;++batch_idx)
+    {
+        int thread_id=omp_get_thread_num();
+        float * values=batch_values+thread_id*batch_values_size;
+
+        const int * batch_loc_idxs=start_loc_idxs.data()+batch_idx*batch_size;
+        int n_locs=std::min(batch_size,n_rows-batch_idx*batch_size);
+        int sources[UTIL::SPATIAL::MultiSourceDial::n_lanes];
+        for (int i=0;i<n_locs;++i) {
+            for (int orient=0;orient<n_orientations;++orient) {
+                sources[i*n_orientations+orient]=batch_loc_idxs[i]*n_orientations+orient;
+            }
+        }
+        std::fill(values,values+(size_t)n_locs*n_orientations*state_size,MAX_HEURISTIC);
+        planners[thread_id]->search(sources,n_locs*n_orientations,values);
+
+        for (int i=0;i<n_locs;++i) {
+            int loc_idx=batch_loc_idxs[i];
+            const float * loc_values=values+(size_t)i*n_orientations*state_size;
+            if (mode==HeuristicMode::QUANTIZED) {
+                float * main_row=row_buffers+thread_id*row_buffer_size;
+                float * sub_row=main_row+loc_size;
+                _fill_weighted_heuristics(loc_values, main_row, sub_row);
+                store_quantized_row(loc_idx, main_row, sub_row);
+            } else {
+                float * main_row=main_heuristics+(size_t)loc_idx*loc_size;
+                float * sub_row=consider_rotation?sub_heuristics+(size_t)loc_idx*state_size:nullptr;
+                _fill_weighted_heuristics(loc_values, main_row, sub_row);
+            }
+        }
+
+        #pragma omp critical
+        {
+            int prev_ctr=ctr;
+            ctr+=n_locs;
+            if (ctr/step!=prev_ctr/step){
+                auto end = std::chrono::steady_clock::now();
+                double elapse=std::chrono::duration<double>(end-start).count();
+                double estimated_remain=elapse/ctr*(n_rows-ctr);
+                cout<< "HeuristicTable::compute_weighted_heuristics() " << ctr<<"/"<<n_rows<<" traversable cells done in "<<elapse<<"s. est time to fin. all: "<<estimated_remain<<"s.  est total time: "<<(estimated_remain+elapse)<<"s." <<endl;
+            }
+        }
+    }
+
+    delete [] batch_values;
+    delete [] row_buffers;
+    for (int i=0;i<n_threads;++i) {
+        delete planners[i];
+    }
+    delete [] planners;
 }
 
 void HeuristicTable::_compute_weighted_heuristics(
     int start_loc_idx,
     float * values,
-    UTIL::SPATIAL::SpatialAStar * planner
+    UTIL::SPATIAL::SpatialAStar * planner,
+    float * main_row,
+    float * sub_row
 ) 
 {
     // printf("HeuristicTable::_compute_weighted_heuristics() start_loc_idx:%i \n", start_loc_idx);
@@ -154,17 +437,11 @@ void HeuristicTable::_compute_weighted_heuristics(
         
         for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
             int loc=empty_locs[loc_idx];
-            UTIL::SPATIAL::State * state=planner->all_states+loc;
-            if (loc!=state->pos) {
-                std::cerr<<"loc: "<<loc<<" state->pos: "<<state->pos<<endl;
-                exit(-1);
-            }
-            float cost=state->g;
+            float cost=planner->get_g(loc);
             if (cost==-1) {
                 cost=MAX_HEURISTIC;
             }
-            size_t main_idx=start_loc_idx*loc_size+loc_idx;
-            main_heuristics[main_idx]=cost;
+            main_row[loc_idx]=cost;
         }
     } else {
         std::fill(values,values+n_orientations*state_size,MAX_HEURISTIC);
@@ -174,12 +451,7 @@ void HeuristicTable::_compute_weighted_heuristics(
             for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
                 for (int orient=0;orient<n_orientations;++orient) {
                     int loc=empty_locs[loc_idx];
-                    UTIL::SPATIAL::State * state=planner->all_states+loc*n_orientations+orient;
-                    // if (loc!=state->pos || orient!=state->orient) {
-                    //     std::cerr<<"start_loc: "<<start_loc<<" loc: "<<loc<<" state->pos: "<<state->pos<<" orient: "<<orient<<" state->orient: "<<state->orient<<endl;
-                    //     exit(-1);
-                    // }
-                    float cost=state->g;
+                    float cost=planner->get_g(loc*n_orientations+orient);
                     if (cost==-1) {
                         cost=MAX_HEURISTIC;
                     }
@@ -190,41 +462,337 @@ void HeuristicTable::_compute_weighted_heuristics(
 
                     size_t value_idx=start_orient*state_size+loc_idx*n_orientations+orient;
                     values[value_idx]=cost;
-
-                    size_t main_idx=start_loc_idx*loc_size+loc_idx;
-                    if (cost<main_heuristics[main_idx]){
-                        main_heuristics[main_idx]=cost;
-                    }
                 }
             }
         }
 
-        for (int start_orient=0;start_orient<n_orientations;++start_orient){
-            for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
-                float cost=MAX_HEURISTIC;
-                for (int orient=0;orient<n_orientations;++orient) {
-                    size_t value_idx=start_orient*state_size+loc_idx*n_orientations+orient;
-                    auto value=values[value_idx];
-                    if (value<cost) {
-                        cost=value;
-                    }
+        _fill_weighted_heuristics(values, main_row, sub_row);
+    }
+}
+
+void HeuristicTable::_fill_weighted_heuristics(const float * values, float * main_row, float * sub_row) {
+    if (!consider_rotation) {
+        std::copy(values,values+loc_size,main_row);
+        return;
+    }
+
+    std::fill(main_row,main_row+loc_size,MAX_HEURISTIC);
+    for (int start_orient=0;start_orient<n_orientations;++start_orient){
+        for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            for (int orient=0;orient<n_orientations;++orient) {
+                float cost=values[start_orient*state_size+loc_idx*n_orientations+orient];
+                if (cost<main_row[loc_idx]){
+                    main_row[loc_idx]=cost;
                 }
-                size_t sub_idx=(start_loc_idx*loc_size+loc_idx)*n_orientations+start_orient;
-                size_t main_idx=start_loc_idx*loc_size+loc_idx;
-                float diff=cost-main_heuristics[main_idx];
-                if (diff<0) {
-                    std::cerr<<"diff: "<<diff<<" < 0"<<endl;
-                    exit(-1);
+            }
+        }
+    }
+
+    for (int start_orient=0;start_orient<n_orientations;++start_orient){
+        for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            float cost=MAX_HEURISTIC;
+            for (int orient=0;orient<n_orientations;++orient) {
+                size_t value_idx=start_orient*state_size+loc_idx*n_orientations+orient;
+                auto value=values[value_idx];
+                if (value<cost) {
+                    cost=value;
                 }
+            }
+            float diff=cost-main_row[loc_idx];
+            if (diff<0) {
+                std::cerr<<"diff: "<<diff<<" < 0"<<endl;
+                exit(-1);
+            }
+
+            if (diff>MAX_HEURISTIC) {
+                std::cerr<<"diff: "<<diff<<" > "<<MAX_HEURISTIC<<endl;
+                exit(-1);
+            }
+            sub_row[loc_idx*n_orientations+start_orient]=diff;
+        }
+    }
+}
+
+void HeuristicTable::init_quantization(int _sub_bits) {
+    // bound the largest finite distance through a reference cell r: d(u,v)<=d(u,r)+d(r,v).
+    UTIL::SPATIAL::SpatialAStar planner(env,n_orientations,*map_weights);
+    int ref_loc=empty_locs[loc_size/2];
+
+    auto get_max_cost=[&]() {
+        float max_cost=0;
+        for (int i=0;i<planner.max_states;++i) {
+            if (planner.is_reached(i)) {
+                max_cost=std::max(max_cost,planner.all_states[i].g);
+            }
+        }
+        return max_cost;
+    };
+
+    planner.reset();
+    planner.search_for_all(ref_loc,consider_rotation?0:-1);
+    float max_from_ref=get_max_cost();
+    planner.reset();
+    planner.search_for_all_backward(ref_loc);
+    float max_to_ref=get_max_cost();
+
+    float max_stay=0;
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        max_stay=std::max(max_stay,(*map_weights)[empty_locs[loc_idx]*5+4]);
+    }
+
+    // the reference search starts with orientation 0, other start orientations may need 2 more rotations.
+    float bound=max_from_ref+max_to_ref+2*max_stay;
+    // use a power of two, so that scaling is exact in float and integer weights stay exact as long as they fit.
+    quant_unit=std::ldexp(1.0f,(int)std::ceil(std::log2(std::max(bound,1.0f)/(float)(QUANT_UNREACHABLE-1))));
+
+    if (consider_rotation) {
+        // the best start orientation is at most two rotations away, so a delta is at most 2*stay weight of loc1.
+        // with 2 bits, a delta is stored in whole rotations (0,1,2), which is exact for the common case 
+        // that only the turning differs. with 4 bits, it is stored in 1/7 rotations (0..14).
+        if (_sub_bits!=2 && _sub_bits!=4) {
+            std::cerr<<"quantized_sub_bits must be 2 or 4"<<endl;
+            exit(-1);
+        }
+        sub_bits=_sub_bits;
+        sub_bytes=n_orientations*sub_bits/8;
+        float rotation_fraction=sub_bits==2?1.0f:1.0f/7;
+        delta_units=new float[loc_size];
+        for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            float stay=(*map_weights)[empty_locs[loc_idx]*5+4];
+            delta_units[loc_idx]=stay>0?stay*rotation_fraction:1;
+        }
+    }
+
+    printf("    Quantized heuristics: distance bound %f, unit %f, %d bits per orientation delta \n", bound, quant_unit, sub_bits);
+}
+
+void HeuristicTable::store_quantized_row(int start_loc_idx, const float * main_row, const float * sub_row) {
+    size_t saturated=0;
+    const float max_q=(float)(QUANT_UNREACHABLE-1);
+    const int max_dq=(1<<sub_bits)-1;
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        size_t pair_idx=(size_t)start_loc_idx*loc_size+loc_idx;
+        float cost=main_row[loc_idx];
+        if (cost>=MAX_HEURISTIC) {
+            main_heuristics_q[pair_idx]=QUANT_UNREACHABLE;
+            continue;
+        }
+
+        // always round down to keep the heuristic admissible
+        float q=std::floor(cost/quant_unit);
+        if (q>max_q) {
+            q=max_q;
+            ++saturated;
+        }
+        main_heuristics_q[pair_idx]=(uint16_t)q;
+
+        if (consider_rotation) {
+            uint8_t * bytes=sub_heuristics_q+pair_idx*sub_bytes;
+            std::fill(bytes,bytes+sub_bytes,0);
+            for (int orient=0;orient<n_orientations;++orient) {
+                int dq=std::min(max_dq,(int)std::floor(sub_row[loc_idx*n_orientations+orient]/delta_units[start_loc_idx]));
+                int offset=orient*sub_bits;
+                bytes[offset>>3]|=(uint8_t)(dq<<(offset&7));
+            }
+        }
+    }
 
-                if (diff>MAX_HEURISTIC) {
-                    std::cerr<<"diff: "<<diff<<" > "<<MAX_HEURISTIC<<endl;
-                    exit(-1);
+    if (saturated>0) {
+        #pragma omp atomic
+        n_saturated+=saturated;
+    }
+}
+
+std::vector<int> HeuristicTable::get_affected_rows(const std::vector<WeightDelta> & deltas) const {
+    // the edges whose weights change, between states loc_idx*n_orientations+orient.
+    struct Change {
+        int from;
+        int to;
+        float old_weight;
+        float new_weight;
+    };
+    std::vector<Change> changes;
+    const int offsets[4]={1,env.cols,-1,-env.cols};
+    for (auto & delta: deltas) {
+        int pos=delta.weight_idx/5;
+        int dir=delta.weight_idx%5;
+        float old_weight=(*map_weights)[delta.weight_idx];
+        if (env.map[pos]!=0 || old_weight==delta.weight) {
+            continue;
+        }
+        int loc_idx=loc_idxs[pos];
+        if (dir<4) {
+            int x=pos%env.cols;
+            int y=pos/env.cols;
+            bool inside=dir==0?x+1<env.cols:(dir==1?y+1<env.rows:(dir==2?x-1>=0:y-1>=0));
+            if (!inside || env.map[pos+offsets[dir]]!=0) {
+                continue;
+            }
+            int next_loc_idx=loc_idxs[pos+offsets[dir]];
+            int orient=consider_rotation?dir:0;
+            changes.push_back({loc_idx*n_orientations+orient,next_loc_idx*n_orientations+orient,old_weight,delta.weight});
+        } else if (consider_rotation) {
+            // searches without rotation never use the stay weight.
+            for (int orient=0;orient<n_orientations;++orient) {
+                int state=loc_idx*n_orientations+orient;
+                changes.push_back({state,loc_idx*n_orientations+(orient+1)%n_orientations,old_weight,delta.weight});
+                changes.push_back({state,loc_idx*n_orientations+(orient+n_orientations-1)%n_orientations,old_weight,delta.weight});
+            }
+        }
+    }
+
+    // with rotation, the table only has costs to locations, so the costs to the states of the changed edges
+    // come from backward searches with the old weights. [state][start state]
+    std::vector<int> end_states;
+    for (auto & change: changes) {
+        end_states.push_back(change.from);
+        end_states.push_back(change.to);
+    }
+    std::sort(end_states.begin(),end_states.end());
+    end_states.erase(std::unique(end_states.begin(),end_states.end()),end_states.end());
+    std::vector<std::vector<float> > costs_to_states;
+    if (consider_rotation) {
+        costs_to_states.resize(end_states.size());
+        #pragma omp parallel
+        {
+            UTIL::SPATIAL::SpatialAStar planner(env,n_orientations,*map_weights);
+            #pragma omp for schedule(dynamic,1)
+            for (size_t i=0;i<end_states.size();++i) {
+                planner.reset();
+                planner.search_for_all_backward(empty_locs[end_states[i]/n_orientations],end_states[i]%n_orientations);
+                auto & costs=costs_to_states[i];
+                costs.resize(state_size);
+                for (size_t state=0;state<state_size;++state) {
+                    float cost=planner.get_g(empty_locs[state/n_orientations]*n_orientations+(int)(state%n_orientations));
+                    costs[state]=cost==-1?MAX_HEURISTIC:cost;
                 }
-                sub_heuristics[sub_idx]=diff;
             }
         }
     }
+    auto get_end_state_idx=[&](int state) {
+        return std::lower_bound(end_states.begin(),end_states.end(),state)-end_states.begin();
+    };
+
+    // a row can only change if a cheaper edge improves the cost of its head, or a more expensive edge is tight,
+    // i.e., on a shortest path. both are judged by the old costs.
+    std::vector<char> affected(loc_size,0);
+    #pragma omp parallel for schedule(static)
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        const float * main_row=main_heuristics+(size_t)loc_idx*loc_size;
+        for (int start_orient=0;start_orient<n_orientations && !affected[loc_idx];++start_orient) {
+            int start_state=loc_idx*n_orientations+start_orient;
+            for (auto & change: changes) {
+                float cost_from, cost_to;
+                if (consider_rotation) {
+                    cost_from=costs_to_states[get_end_state_idx(change.from)][start_state];
+                    cost_to=costs_to_states[get_end_state_idx(change.to)][start_state];
+                } else {
+                    cost_from=main_row[change.from];
+                    cost_to=main_row[change.to];
+                }
+                if (cost_from>=MAX_HEURISTIC) {
+                    continue;
+                }
+                // float sums are not exact, so close calls count as affected.
+                float eps=1e-5f*std::max(1.0f,cost_from);
+                bool improved=change.new_weight<change.old_weight && cost_from+change.new_weight<cost_to+eps;
+                bool tight=change.new_weight>change.old_weight && cost_from+change.old_weight<=cost_to+eps;
+                if (improved || tight) {
+                    affected[loc_idx]=1;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<int> rows;
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        if (affected[loc_idx]) {
+            rows.push_back(loc_idx);
+        }
+    }
+    return rows;
+}
+
+std::shared_ptr<HeuristicTable> HeuristicTable::repair(const std::vector<WeightDelta> & deltas) {
+    auto weights=std::make_shared<std::vector<float> >(*map_weights);
+    for (auto & delta: deltas) {
+        if (delta.weight_idx<0 || delta.weight_idx>=(int)weights->size()) {
+            std::cerr<<"invalid weight index: "<<delta.weight_idx<<endl;
+            exit(-1);
+        }
+        (*weights)[delta.weight_idx]=delta.weight;
+    }
+
+    auto start=std::chrono::steady_clock::now();
+    // the constructor takes a mutable env for the action model, which doesn't modify it.
+    auto repaired=std::make_shared<HeuristicTable>(const_cast<SharedEnvironment *>(&env),weights,consider_rotation,config);
+    if (mode==HeuristicMode::DENSE) {
+        std::vector<int> rows=get_affected_rows(deltas);
+        repaired->allocate_tables();
+        memcpy(repaired->main_heuristics,main_heuristics,main_table_bytes());
+        if (consider_rotation) {
+            memcpy(repaired->sub_heuristics,sub_heuristics,sub_table_bytes());
+        }
+        if (!rows.empty()) {
+            repaired->compute_rows(rows);
+        }
+        double elapse=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        cout<<"heuristics repaired: "<<rows.size()<<"/"<<loc_size<<" rows are affected by "<<deltas.size()<<" weight changes, "<<elapse<<"s"<<endl;
+    } else if (mode==HeuristicMode::QUANTIZED || mode==HeuristicMode::LANDMARK) {
+        // quantization and landmarks depend on all weights, so they are computed again.
+        repaired->compute_weighted_heuristics();
+    }
+    return repaired;
+}
+
+void HeuristicTable::swap_in(HeuristicTable & repaired) {
+    if (repaired.mode!=mode || repaired.consider_rotation!=consider_rotation || repaired.loc_size!=loc_size) {
+        std::cerr<<"the repaired heuristic table doesn't match"<<endl;
+        exit(-1);
+    }
+
+    // the weights are shared with the planners, so they are updated in place.
+    *map_weights=*repaired.map_weights;
+
+    if (mode==HeuristicMode::DENSE || mode==HeuristicMode::QUANTIZED) {
+        // the old tables are released with the repaired table.
+        std::swap(main_heuristics,repaired.main_heuristics);
+        std::swap(sub_heuristics,repaired.sub_heuristics);
+        std::swap(main_heuristics_q,repaired.main_heuristics_q);
+        std::swap(sub_heuristics_q,repaired.sub_heuristics_q);
+        std::swap(mmap_addr,repaired.mmap_addr);
+        std::swap(mmap_size,repaired.mmap_size);
+        std::swap(delta_units,repaired.delta_units);
+        std::swap(quant_unit,repaired.quant_unit);
+        std::swap(sub_bits,repaired.sub_bits);
+        std::swap(sub_bytes,repaired.sub_bytes);
+        std::swap(n_saturated,repaired.n_saturated);
+    } else if (mode==HeuristicMode::CORRIDOR) {
+        // corridor tables are fast to compute but keep a reference to the weights, so they are rebuilt here.
+        corridor_heuristics=std::make_unique<CorridorHeuristics>(env,*map_weights,n_orientations,empty_locs,loc_idxs,loc_size);
+        corridor_heuristics->compute();
+    } else if (mode==HeuristicMode::LANDMARK) {
+        landmark_locs.swap(repaired.landmark_locs);
+        landmark_to.swap(repaired.landmark_to);
+        landmark_from.swap(repaired.landmark_from);
+        landmark_to_goal.swap(repaired.landmark_to_goal);
+        landmark_from_goal.swap(repaired.landmark_from_goal);
+    }
+
+    if (row_cache!=nullptr) {
+        row_cache->clear();
+    }
+    {
+        // the planners pick their open list by the weights when they are created.
+        std::lock_guard<std::mutex> lock(planner_pool_mtx);
+        for (auto planner: planner_pool) {
+            delete planner;
+        }
+        planner_pool.clear();
+    }
+    // invalidate the per-thread memo of the last lazy row.
+    table_id=heuristic_table_counter++;
 }
 
 void HeuristicTable::dump_main_heuristics(int start_loc, string file_path_prefix) 
@@ -244,7 +812,7 @@ void HeuristicTable::dump_main_heuristics(int start_loc, string file_path_prefix
             int target_loc_idx=loc_idxs[target_loc];
             float h=MAX_HEURISTIC;
             if (target_loc_idx!=-1){
-                h=main_heuristics[start_loc_idx*loc_size+target_loc_idx];
+                h=get(start_loc,target_loc);
             }
             fout<<h;
             if (j!=env.cols-1) {
@@ -410,6 +978,216 @@ void HeuristicTable::dump_main_heuristics(int start_loc, string file_path_prefix
 
 // }
 
+// consecutive queries from a thread usually share the goal (e.g., a single-agent search),
+// so remember the last row to skip the cache lock.
+struct LastRow {
+    size_t table_id=(size_t)-1;
+    int goal_loc=-1;
+    HeuristicRowCache::RowPtr row;
+};
+static thread_local LastRow last;
+
+const HeuristicRow & HeuristicTable::get_lazy_row(int goal_loc) {
+    if (last.table_id==table_id && last.goal_loc==goal_loc) {
+        return *last.row;
+    }
+
+    auto row=row_cache->find(goal_loc);
+    if (row==nullptr) {
+        // two threads may compute the same row at the same time. it is a waste but harmless.
+        row=row_cache->insert(compute_goal_row(goal_loc));
+    }
+
+    last.table_id=table_id;
+    last.goal_loc=goal_loc;
+    last.row=row;
+    return *last.row;
+}
+
+const HeuristicRow * HeuristicTable::get_hot_goal_row(int goal_loc) {
+    if (last.table_id==table_id && last.goal_loc==goal_loc) {
+        ++row_cache->n_hits;
+        return last.row.get();
+    }
+
+    int goal_idx=loc_idxs[goal_loc];
+    HeuristicRowCache::RowPtr row;
+    if (hot_goals[goal_idx]) {
+        row=row_cache->find(goal_loc,false);
+        if (row==nullptr) {
+            // evicted, the goal has to become hot again.
+            hot_goals[goal_idx]=false;
+            ++row_cache->n_misses;
+        } else {
+            ++row_cache->n_hits;
+        }
+    } else {
+        ++row_cache->n_misses;
+    }
+
+    if (row==nullptr) {
+        if (goal_query_counts[goal_idx].fetch_add(1)+1<hot_goal_queries) {
+            return nullptr;
+        }
+        goal_query_counts[goal_idx]=0;
+        row=row_cache->insert(compute_goal_row(goal_loc));
+        hot_goals[goal_idx]=true;
+    }
+
+    last.table_id=table_id;
+    last.goal_loc=goal_loc;
+    last.row=row;
+    return last.row.get();
+}
+
+void HeuristicTable::compute_landmarks() {
+    size_t n=(size_t)n_landmarks;
+    landmark_to.assign(state_size*n,MAX_HEURISTIC);
+    landmark_from.assign(state_size*n,MAX_HEURISTIC);
+    landmark_to_goal.assign(loc_size*n,MAX_HEURISTIC);
+    landmark_from_goal.assign(loc_size*n,MAX_HEURISTIC);
+
+    UTIL::SPATIAL::SpatialAStar planner(env,n_orientations,*map_weights);
+    // the cost from each location to its closest landmark so far. the next landmark is the farthest location.
+    std::vector<float> min_dists(loc_size,MAX_HEURISTIC);
+
+    auto farthest_loc_idx=[&]() {
+        int farthest=0;
+        for (size_t loc_idx=1;loc_idx<loc_size;++loc_idx) {
+            if (min_dists[loc_idx]<MAX_HEURISTIC && (min_dists[farthest]>=MAX_HEURISTIC || min_dists[loc_idx]>min_dists[farthest])) {
+                farthest=(int)loc_idx;
+            }
+        }
+        return farthest;
+    };
+
+    // the first landmark is the farthest location from an arbitrary one.
+    planner.reset();
+    planner.search_for_all_backward(empty_locs[0]);
+    for (size_t loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        for (int orient=0;orient<n_orientations;++orient) {
+            float cost=planner.get_g(empty_locs[loc_idx]*n_orientations+orient);
+            if (cost!=-1) {
+                min_dists[loc_idx]=std::min(min_dists[loc_idx],cost);
+            }
+        }
+    }
+
+    for (size_t i=0;i<n;++i) {
+        int landmark_idx=farthest_loc_idx();
+        int landmark_loc=empty_locs[landmark_idx];
+        landmark_locs.push_back(landmark_loc);
+        if (i==0) {
+            std::fill(min_dists.begin(),min_dists.end(),MAX_HEURISTIC);
+        }
+
+        planner.reset();
+        planner.search_for_all_backward(landmark_loc);
+        for (size_t loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            for (int orient=0;orient<n_orientations;++orient) {
+                float cost=planner.get_g(empty_locs[loc_idx]*n_orientations+orient);
+                if (cost==-1) {
+                    continue;
+                }
+                size_t state_idx=loc_idx*n_orientations+orient;
+                landmark_to[state_idx*n+i]=cost;
+                float & to_goal=landmark_to_goal[loc_idx*n+i];
+                to_goal=to_goal>=MAX_HEURISTIC?cost:std::max(to_goal,cost);
+                min_dists[loc_idx]=std::min(min_dists[loc_idx],cost);
+            }
+        }
+
+        planner.reset();
+        planner.search_for_all(landmark_loc,n_orientations==1?-1:0);
+        for (size_t loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            for (int orient=0;orient<n_orientations;++orient) {
+                float cost=planner.get_g(empty_locs[loc_idx]*n_orientations+orient);
+                if (cost==-1) {
+                    continue;
+                }
+                size_t state_idx=loc_idx*n_orientations+orient;
+                landmark_from[state_idx*n+i]=cost;
+                float & from_goal=landmark_from_goal[loc_idx*n+i];
+                from_goal=std::min(from_goal,cost);
+            }
+        }
+    }
+
+    cout<<"landmark heuristics: "<<n<<" landmarks, "
+        <<sizeof(float)*(landmark_to.size()+landmark_from.size()+landmark_to_goal.size()+landmark_from_goal.size())/1024/1024<<" MB"<<endl;
+}
+
+// by the triangle inequality, d(s,g) >= d(s,L)-d(g,L) and d(s,g) >= d(L,g)-d(L,s) for every landmark L.
+// a goal is reached in any orientation, so the goal side takes the loosest value over orientations.
+float HeuristicTable::get_landmark_bound(int loc_idx1, int orient1, int loc_idx2) const {
+    if (orient1==-1) {
+        float bound=get_landmark_bound(loc_idx1,0,loc_idx2);
+        for (int orient=1;orient<n_orientations;++orient) {
+            bound=std::min(bound,get_landmark_bound(loc_idx1,orient,loc_idx2));
+        }
+        return bound;
+    }
+
+    size_t n=(size_t)n_landmarks;
+    size_t state_idx=(size_t)loc_idx1*n_orientations+orient1;
+    const float * to1=landmark_to.data()+state_idx*n;
+    const float * from1=landmark_from.data()+state_idx*n;
+    const float * to2=landmark_to_goal.data()+(size_t)loc_idx2*n;
+    const float * from2=landmark_from_goal.data()+(size_t)loc_idx2*n;
+
+    float bound=0;
+    for (size_t i=0;i<n;++i) {
+        if (to1[i]<MAX_HEURISTIC && to2[i]<MAX_HEURISTIC) {
+            bound=std::max(bound,to1[i]-to2[i]);
+        }
+        if (from1[i]<MAX_HEURISTIC && from2[i]<MAX_HEURISTIC) {
+            bound=std::max(bound,from2[i]-from1[i]);
+        }
+    }
+    return bound;
+}
+
+HeuristicRowCache::RowPtr HeuristicTable::compute_goal_row(int goal_loc) {
+    UTIL::SPATIAL::SpatialAStar * planner=nullptr;
+    {
+        std::lock_guard<std::mutex> lock(planner_pool_mtx);
+        if (!planner_pool.empty()) {
+            planner=planner_pool.back();
+            planner_pool.pop_back();
+        }
+    }
+    if (planner==nullptr) {
+        planner=new UTIL::SPATIAL::SpatialAStar(env,n_orientations,*map_weights);
+    }
+
+    planner->reset();
+    planner->search_for_all_backward(goal_loc);
+
+    auto row=std::make_shared<HeuristicRow>(goal_loc,state_size,MAX_HEURISTIC);
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        int loc=empty_locs[loc_idx];
+        for (int orient=0;orient<n_orientations;++orient) {
+            float cost=planner->get_g(loc*n_orientations+orient);
+            if (cost!=-1) {
+                row->values[loc_idx*n_orientations+orient]=cost;
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(planner_pool_mtx);
+        planner_pool.push_back(planner);
+    }
+
+    return row;
+}
+
+void HeuristicTable::print_lazy_stats() {
+    cout<<(mode==HeuristicMode::LANDMARK?"landmark heuristics (exact rows of hot goals): ":"lazy heuristics: ")<<row_cache->size()<<"/"<<row_cache->capacity<<" rows cached, "
+        <<row_cache->n_hits<<" hits, "<<row_cache->n_misses<<" misses, "
+        <<row_cache->n_evictions<<" evictions"<<endl;
+}
+
 // TODO add check
 float HeuristicTable::get(int loc1, int loc2) {
     int loc_idx1=loc_idxs[loc1];
@@ -419,7 +1197,37 @@ float HeuristicTable::get(int loc1, int loc2) {
         return MAX_HEURISTIC;
     }
 
+    if (mode==HeuristicMode::LAZY) {
+        const float * values=get_lazy_row(loc2).values.data()+loc_idx1*n_orientations;
+        float cost=values[0];
+        for (int orient=1;orient<n_orientations;++orient) {
+            cost=std::min(cost,values[orient]);
+        }
+        return cost;
+    }
+
+    if (mode==HeuristicMode::CORRIDOR) {
+        return corridor_heuristics->get(loc_idx1,loc_idx2);
+    }
+
+    if (mode==HeuristicMode::LANDMARK) {
+        const HeuristicRow * row=get_hot_goal_row(loc2);
+        if (row==nullptr) {
+            return get_landmark_bound(loc_idx1,-1,loc_idx2);
+        }
+        const float * values=row->values.data()+loc_idx1*n_orientations;
+        float cost=values[0];
+        for (int orient=1;orient<n_orientations;++orient) {
+            cost=std::min(cost,values[orient]);
+        }
+        return cost;
+    }
+
     size_t idx=loc_idx1*loc_size+loc_idx2;
+    if (mode==HeuristicMode::QUANTIZED) {
+        uint16_t q=main_heuristics_q[idx];
+        return q==QUANT_UNREACHABLE?MAX_HEURISTIC:(float)q*quant_unit;
+    }
     return main_heuristics[idx];
 }
 
@@ -436,6 +1244,22 @@ float HeuristicTable::get(int loc1, int orient1, int loc2) {
         return MAX_HEURISTIC;
     }
 
+    if (mode==HeuristicMode::LAZY) {
+        return get_lazy_row(loc2).values[loc_idx1*n_orientations+orient1];
+    }
+
+    if (mode==HeuristicMode::CORRIDOR) {
+        return corridor_heuristics->get(loc_idx1,orient1,loc_idx2);
+    }
+
+    if (mode==HeuristicMode::LANDMARK) {
+        const HeuristicRow * row=get_hot_goal_row(loc2);
+        if (row==nullptr) {
+            return get_landmark_bound(loc_idx1,orient1,loc_idx2);
+        }
+        return row->values[loc_idx1*n_orientations+orient1];
+    }
+
     // size_t idx=((loc_idx1*loc_size+loc_idx2)*n_orientations+orient1)*n_orientations;
     // char min_v=CHAR_MAX;
     // for (int i=0;i<n_orientations;++i) {
@@ -444,6 +1268,13 @@ float HeuristicTable::get(int loc1, int orient1, int loc2) {
     //     }
     // }
     size_t main_idx=loc_idx1*loc_size+loc_idx2;
+    if (mode==HeuristicMode::QUANTIZED) {
+        uint16_t q=main_heuristics_q[main_idx];
+        if (q==QUANT_UNREACHABLE) {
+            return MAX_HEURISTIC;
+        }
+        return (float)q*quant_unit+get_quantized_delta(loc_idx1,main_idx,orient1);
+    }
     size_t sub_idx=(loc_idx1*loc_size+loc_idx2)*n_orientations+orient1;
     return main_heuristics[main_idx]+sub_heuristics[sub_idx];
 } 
@@ -497,16 +1328,61 @@ void HeuristicTable::preprocess(string suffix) {
     }
     string fpath;
     if (consider_rotation) {
-        fpath=folder+fname+"_weighted_heuristics_v4_"+suffix+".gz";
+        fpath=folder+fname+"_weighted_heuristics_v4_"+suffix;
     } else {
-        fpath=folder+fname+"_weighted_heuristics_no_rotation_v4_"+suffix+".gz";
+        fpath=folder+fname+"_weighted_heuristics_no_rotation_v4_"+suffix;
+    }
+    if (mode==HeuristicMode::QUANTIZED) {
+        fpath+="_quantized"+std::to_string(sub_bits);
+    }
+
+    if (mode==HeuristicMode::LAZY) {
+        // rows are computed on demand in get().
+        DEV_DEBUG("lazy heuristics: skip precomputation.");
+        return;
     }
 
+    if (mode==HeuristicMode::CORRIDOR || mode==HeuristicMode::LANDMARK) {
+        // these tables are small and fast to compute, so they are not cached in files.
+        compute_weighted_heuristics();
+        return;
+    }
+
+    if (file_format=="mmap") {
+        // the file is written once and then shared read-only by every process on the host.
+        fpath+=".heu";
+        if (boost::filesystem::exists(fpath) && load_mmap(fpath)) {
+            return;
+        }
+        compute_weighted_heuristics();
+        // replace the private copy with the mapped file, so that the memory can be shared.
+        if (save_mmap(fpath)) {
+            load_mmap(fpath);
+        }
+        return;
+    }
+
+    if (file_format=="chunked") {
+        // blocks are compressed independently and (de)compressed in parallel.
+        fpath+=".heuz";
+        if (boost::filesystem::exists(fpath) && load_chunked(fpath)) {
+            return;
+        }
+        compute_weighted_heuristics();
+        save_chunked(fpath);
+        return;
+    }
+
+    fpath+=".gz";
     if (boost::filesystem::exists(fpath)) {
         load(fpath);
     } else {
         compute_weighted_heuristics();
-        // ONLYDEV(save(fpath));
+        // only the unit-weight table is written, which RHCR always uses and used to cache. the weighted tables are
+        // recomputed at every start as before; use mmap or chunked to cache them.
+        if (suffix=="all_one") {
+            save(fpath);
+        }
     }
 }
 
@@ -514,8 +1390,10 @@ void HeuristicTable::save(const string & fpath) {
     DEV_DEBUG("[start] Save heuristics to {}.", fpath);
     ONLYDEV(g_timer.record_p("heu/save_start");)
 
+    // write to a temporary file and rename it, so that other processes never see a partial file.
+    string tmp_fpath=fpath+".tmp."+std::to_string(getpid());
     std::ofstream fout;
-    fout.open(fpath,std::ios::binary|std::ios::out);
+    fout.open(tmp_fpath,std::ios::binary|std::ios::out);
 
     boost::iostreams::filtering_streambuf<boost::iostreams::output> outbuf;
     outbuf.push(boost::iostreams::zlib_compressor());
@@ -529,15 +1407,31 @@ void HeuristicTable::save(const string & fpath) {
     // save empty locs
     out.write((char*)empty_locs,sizeof(int)*loc_size);
 
-    // save main heuristics
-    out.write((char *)main_heuristics,sizeof(float)*loc_size*loc_size);
+    if (mode==HeuristicMode::QUANTIZED) {
+        // save quantization parameters
+        out.write((char *)&quant_unit,sizeof(float));
+        out.write((char *)&sub_bits,sizeof(int));
 
-    // save sub heuristics
-    if (consider_rotation)
-        out.write((char *)sub_heuristics,sizeof(float)*state_size*loc_size);
+        out.write((char *)main_heuristics_q,sizeof(uint16_t)*loc_size*loc_size);
+        if (consider_rotation)
+            out.write((char *)sub_heuristics_q,sizeof(uint8_t)*sub_bytes*loc_size*loc_size);
+    } else {
+        // save main heuristics
+        out.write((char *)main_heuristics,sizeof(float)*loc_size*loc_size);
+
+        // save sub heuristics
+        if (consider_rotation)
+            out.write((char *)sub_heuristics,sizeof(float)*state_size*loc_size);
+    }
 
     boost::iostreams::close(outbuf);
     fout.close();
+
+    if (!fout || std::rename(tmp_fpath.c_str(),fpath.c_str())!=0) {
+        std::cerr<<"failed to save heuristics to "<<fpath<<endl;
+        std::remove(tmp_fpath.c_str());
+        return;
+    }
     
     ONLYDEV(g_timer.record_d("heu/save_start","heu/save_end","heu/save");)
 
@@ -547,6 +1441,7 @@ void HeuristicTable::save(const string & fpath) {
 void HeuristicTable::load(const string & fpath) {
     DEV_DEBUG("[start] load heuristics from {}.",fpath);
     ONLYDEV(g_timer.record_p("heu/load_start");)
+    allocate_tables();
     std::ifstream fin;
     fin.open(fpath,std::ios::binary|std::ios::in);
 
@@ -578,14 +1473,391 @@ void HeuristicTable::load(const string & fpath) {
         }
     }
 
-    // load main heurisitcs
-    in.read((char *)main_heuristics,sizeof(float)*loc_size*loc_size);
-    
-    // load sub heuristics
-    if (consider_rotation)
-        in.read((char *)sub_heuristics,sizeof(float)*state_size*loc_size);
+    delete [] _empty_locs;
+
+    if (mode==HeuristicMode::QUANTIZED) {
+        // check quantization parameters, they are derived from the map weights.
+        float _quant_unit;
+        int _sub_bits;
+        in.read((char *)&_quant_unit,sizeof(float));
+        in.read((char *)&_sub_bits,sizeof(int));
+        if (_quant_unit!=quant_unit || _sub_bits!=sub_bits) {
+            cerr<<"the quantization parameters don't match!"<<endl;
+            exit(-1);
+        }
+
+        in.read((char *)main_heuristics_q,sizeof(uint16_t)*loc_size*loc_size);
+        if (consider_rotation)
+            in.read((char *)sub_heuristics_q,sizeof(uint8_t)*sub_bytes*loc_size*loc_size);
+    } else {
+        // load main heurisitcs
+        in.read((char *)main_heuristics,sizeof(float)*loc_size*loc_size);
+        
+        // load sub heuristics
+        if (consider_rotation)
+            in.read((char *)sub_heuristics,sizeof(float)*state_size*loc_size);
+    }
 
     ONLYDEV(g_timer.record_d("heu/load_start","heu/load_end","heu/load");)
 
     DEV_DEBUG("[end] load heuristics from {}. (duration: {:.3f})",fpath,g_timer.get_d("heu/load"));
-}
\ No newline at end of file
+}
+
+// the header of the uncompressed heuristic file. tables are stored at page-aligned offsets after it,
+// so that they can be mapped and used in place.
+struct HeuristicFileHeader {
+    char magic[8];
+    uint32_t layout_version;
+    uint32_t mode;
+    uint64_t map_hash;
+    uint64_t weights_hash;
+    uint64_t loc_size;
+    uint32_t consider_rotation;
+    uint32_t n_orientations;
+    float quant_unit;
+    int32_t sub_bits;
+    uint64_t main_offset;
+    uint64_t main_bytes;
+    uint64_t sub_offset;
+    uint64_t sub_bytes;
+};
+
+static const char HEURISTIC_FILE_MAGIC[8]={'M','A','P','F','H','E','U','\0'};
+// bump it whenever the table layout or the header changes.
+static const uint32_t HEURISTIC_FILE_LAYOUT_VERSION=1;
+static const uint64_t HEURISTIC_FILE_ALIGNMENT=4096;
+
+// FNV-1a
+static uint64_t hash_bytes(const void * data, size_t size, uint64_t hash=14695981039346656037ULL) {
+    const unsigned char * bytes=(const unsigned char *)data;
+    for (size_t i=0;i<size;++i) {
+        hash^=bytes[i];
+        hash*=1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t align_offset(uint64_t offset) {
+    return (offset+HEURISTIC_FILE_ALIGNMENT-1)/HEURISTIC_FILE_ALIGNMENT*HEURISTIC_FILE_ALIGNMENT;
+}
+
+static HeuristicFileHeader make_file_header(const HeuristicTable & table) {
+    HeuristicFileHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,HEURISTIC_FILE_MAGIC,sizeof(header.magic));
+    header.layout_version=HEURISTIC_FILE_LAYOUT_VERSION;
+    header.mode=(uint32_t)table.mode;
+
+    uint64_t map_hash=hash_bytes(&table.env.rows,sizeof(int));
+    map_hash=hash_bytes(&table.env.cols,sizeof(int),map_hash);
+    header.map_hash=hash_bytes(table.env.map.data(),sizeof(int)*table.env.map.size(),map_hash);
+    header.weights_hash=hash_bytes(table.map_weights->data(),sizeof(float)*table.map_weights->size());
+
+    header.loc_size=table.loc_size;
+    header.consider_rotation=table.consider_rotation;
+    header.n_orientations=table.n_orientations;
+    if (table.mode==HeuristicMode::QUANTIZED) {
+        header.quant_unit=table.quant_unit;
+        header.sub_bits=table.sub_bits;
+    }
+
+    header.main_offset=align_offset(sizeof(HeuristicFileHeader));
+    header.main_bytes=table.main_table_bytes();
+    header.sub_bytes=table.sub_table_bytes();
+    header.sub_offset=header.main_offset+header.main_bytes;
+    if (header.sub_bytes>0) {
+        header.sub_offset=align_offset(header.sub_offset);
+    }
+    return header;
+}
+
+// a file written for another map, weights, mode or layout is rejected and will be recomputed.
+static bool check_file_header(const HeuristicFileHeader & header, const HeuristicFileHeader & expected, const string & fpath) {
+    if (memcmp(header.magic,expected.magic,sizeof(header.magic))!=0 || header.layout_version!=expected.layout_version) {
+        std::cerr<<fpath<<": unknown file format or layout version"<<endl;
+        return false;
+    }
+    if (header.map_hash!=expected.map_hash || header.loc_size!=expected.loc_size) {
+        std::cerr<<fpath<<": the map doesn't match"<<endl;
+        return false;
+    }
+    if (header.weights_hash!=expected.weights_hash) {
+        std::cerr<<fpath<<": the map weights don't match"<<endl;
+        return false;
+    }
+    if (header.mode!=expected.mode || header.consider_rotation!=expected.consider_rotation || header.n_orientations!=expected.n_orientations
+        || header.quant_unit!=expected.quant_unit || header.sub_bits!=expected.sub_bits) {
+        std::cerr<<fpath<<": the table settings don't match"<<endl;
+        return false;
+    }
+    if (memcmp(&header,&expected,sizeof(header))!=0) {
+        std::cerr<<fpath<<": the file is corrupted"<<endl;
+        return false;
+    }
+    return true;
+}
+
+bool HeuristicTable::save_mmap(const string & fpath) {
+    DEV_DEBUG("[start] Save heuristics to {}.", fpath);
+    ONLYDEV(g_timer.record_p("heu/save_start");)
+
+    HeuristicFileHeader header=make_file_header(*this);
+    const char * main_table=mode==HeuristicMode::QUANTIZED?(const char *)main_heuristics_q:(const char *)main_heuristics;
+    const char * sub_table=mode==HeuristicMode::QUANTIZED?(const char *)sub_heuristics_q:(const char *)sub_heuristics;
+
+    // write to a temporary file and rename it, so that other processes never see a partial file.
+    string tmp_fpath=fpath+".tmp."+std::to_string(getpid());
+    std::ofstream fout(tmp_fpath,std::ios::binary|std::ios::out|std::ios::trunc);
+    fout.write((const char *)&header,sizeof(header));
+    fout.seekp(header.main_offset);
+    fout.write(main_table,header.main_bytes);
+    if (header.sub_bytes>0) {
+        fout.seekp(header.sub_offset);
+        fout.write(sub_table,header.sub_bytes);
+    }
+    fout.close();
+
+    if (!fout || std::rename(tmp_fpath.c_str(),fpath.c_str())!=0) {
+        std::cerr<<"failed to save heuristics to "<<fpath<<endl;
+        std::remove(tmp_fpath.c_str());
+        return false;
+    }
+
+    ONLYDEV(g_timer.record_d("heu/save_start","heu/save_end","heu/save");)
+    DEV_DEBUG("[end] Save heuristics to {}. (duration: {:.3f})", fpath, g_timer.get_d("heu/save"));
+    return true;
+}
+
+bool HeuristicTable::load_mmap(const string & fpath) {
+    DEV_DEBUG("[start] map heuristics from {}.",fpath);
+    ONLYDEV(g_timer.record_p("heu/load_start");)
+
+    int fd=open(fpath.c_str(),O_RDONLY);
+    if (fd<0) {
+        std::cerr<<"failed to open "<<fpath<<endl;
+        return false;
+    }
+
+    struct stat st;
+    HeuristicFileHeader header;
+    if (fstat(fd,&st)!=0 || pread(fd,&header,sizeof(header),0)!=(ssize_t)sizeof(header)) {
+        std::cerr<<"failed to read the header of "<<fpath<<endl;
+        close(fd);
+        return false;
+    }
+
+    if (!check_file_header(header,make_file_header(*this),fpath)) {
+        close(fd);
+        return false;
+    }
+    if ((uint64_t)st.st_size<header.sub_offset+header.sub_bytes) {
+        std::cerr<<fpath<<": the file is truncated"<<endl;
+        close(fd);
+        return false;
+    }
+
+    size_t size=(size_t)st.st_size;
+    void * addr=mmap(nullptr,size,PROT_READ,MAP_SHARED,fd,0);
+    // the mapping stays valid after the descriptor is closed.
+    close(fd);
+    if (addr==MAP_FAILED) {
+        std::cerr<<"failed to map "<<fpath<<endl;
+        return false;
+    }
+
+    release_tables();
+    mmap_addr=addr;
+    mmap_size=size;
+    char * base=(char *)addr;
+    if (mode==HeuristicMode::QUANTIZED) {
+        main_heuristics_q=(uint16_t *)(base+header.main_offset);
+        sub_heuristics_q=header.sub_bytes>0?(uint8_t *)(base+header.sub_offset):nullptr;
+    } else {
+        main_heuristics=(float *)(base+header.main_offset);
+        sub_heuristics=header.sub_bytes>0?(float *)(base+header.sub_offset):nullptr;
+    }
+
+    ONLYDEV(g_timer.record_d("heu/load_start","heu/load_end","heu/load");)
+    DEV_DEBUG("[end] map heuristics from {}. (duration: {:.3f})",fpath,g_timer.get_d("heu/load"));
+    return true;
+}
+
+// the chunked file shares the header above, with its own magic and no table offsets. it is followed by
+// block_rows, n_blocks and n_blocks+1 offsets of the compressed blocks. each block holds block_rows rows
+// of the main table followed by the same rows of the sub table, compressed independently with zlib.
+static const char HEURISTIC_CHUNKED_FILE_MAGIC[8]={'M','A','P','F','H','E','Z','\0'};
+
+static HeuristicFileHeader make_chunked_file_header(const HeuristicTable & table) {
+    HeuristicFileHeader header=make_file_header(table);
+    memcpy(header.magic,HEURISTIC_CHUNKED_FILE_MAGIC,sizeof(header.magic));
+    header.main_offset=0;
+    header.sub_offset=0;
+    return header;
+}
+
+bool HeuristicTable::save_chunked(const string & fpath) {
+    DEV_DEBUG("[start] Save chunked heuristics to {}.", fpath);
+    ONLYDEV(g_timer.record_p("heu/save_start");)
+
+    HeuristicFileHeader header=make_chunked_file_header(*this);
+    const char * main_table=mode==HeuristicMode::QUANTIZED?(const char *)main_heuristics_q:(const char *)main_heuristics;
+    const char * sub_table=mode==HeuristicMode::QUANTIZED?(const char *)sub_heuristics_q:(const char *)sub_heuristics;
+    size_t main_row_bytes=main_table_bytes()/loc_size;
+    size_t sub_row_bytes=sub_table_bytes()/loc_size;
+
+    uint32_t block_rows=(uint32_t)chunk_rows;
+    uint32_t n_blocks=(uint32_t)((loc_size+block_rows-1)/block_rows);
+
+    // compress blocks in parallel, then write them in order.
+    std::vector<std::vector<char> > blocks(n_blocks);
+    #pragma omp parallel for schedule(dynamic,1)
+    for (uint32_t b=0;b<n_blocks;++b) {
+        size_t row_start=(size_t)b*block_rows;
+        size_t n_rows=std::min((size_t)block_rows,loc_size-row_start);
+
+        boost::iostreams::filtering_streambuf<boost::iostreams::output> outbuf;
+        outbuf.push(boost::iostreams::zlib_compressor());
+        outbuf.push(boost::iostreams::back_inserter(blocks[b]));
+        std::ostream out(&outbuf);
+        out.write(main_table+row_start*main_row_bytes,(std::streamsize)(n_rows*main_row_bytes));
+        if (sub_row_bytes>0)
+            out.write(sub_table+row_start*sub_row_bytes,(std::streamsize)(n_rows*sub_row_bytes));
+        boost::iostreams::close(outbuf);
+    }
+
+    std::vector<uint64_t> offsets(n_blocks+1);
+    offsets[0]=sizeof(header)+sizeof(block_rows)+sizeof(n_blocks)+sizeof(uint64_t)*offsets.size();
+    for (uint32_t b=0;b<n_blocks;++b) {
+        offsets[b+1]=offsets[b]+blocks[b].size();
+    }
+
+    // write to a temporary file and rename it, so that other processes never see a partial file.
+    string tmp_fpath=fpath+".tmp."+std::to_string(getpid());
+    std::ofstream fout(tmp_fpath,std::ios::binary|std::ios::out|std::ios::trunc);
+    fout.write((const char *)&header,sizeof(header));
+    fout.write((const char *)&block_rows,sizeof(block_rows));
+    fout.write((const char *)&n_blocks,sizeof(n_blocks));
+    fout.write((const char *)offsets.data(),(std::streamsize)(sizeof(uint64_t)*offsets.size()));
+    for (auto & block: blocks) {
+        fout.write(block.data(),(std::streamsize)block.size());
+    }
+    fout.close();
+
+    if (!fout || std::rename(tmp_fpath.c_str(),fpath.c_str())!=0) {
+        std::cerr<<"failed to save heuristics to "<<fpath<<endl;
+        std::remove(tmp_fpath.c_str());
+        return false;
+    }
+
+    ONLYDEV(g_timer.record_d("heu/save_start","heu/save_end","heu/save");)
+    DEV_DEBUG("[end] Save chunked heuristics to {}. ({} blocks, {} bytes, duration: {:.3f})", fpath, n_blocks, offsets[n_blocks], g_timer.get_d("heu/save"));
+    return true;
+}
+
+bool HeuristicTable::load_chunked(const string & fpath, const std::vector<int> * start_loc_idxs) {
+    DEV_DEBUG("[start] load chunked heuristics from {}.",fpath);
+    ONLYDEV(g_timer.record_p("heu/load_start");)
+
+    int fd=open(fpath.c_str(),O_RDONLY);
+    if (fd<0) {
+        std::cerr<<"failed to open "<<fpath<<endl;
+        return false;
+    }
+
+    HeuristicFileHeader header;
+    uint32_t block_rows=0;
+    uint32_t n_blocks=0;
+    bool valid=pread(fd,&header,sizeof(header),0)==(ssize_t)sizeof(header)
+        && pread(fd,&block_rows,sizeof(block_rows),sizeof(header))==(ssize_t)sizeof(block_rows)
+        && pread(fd,&n_blocks,sizeof(n_blocks),sizeof(header)+sizeof(block_rows))==(ssize_t)sizeof(n_blocks);
+    if (!valid) {
+        std::cerr<<"failed to read the header of "<<fpath<<endl;
+        close(fd);
+        return false;
+    }
+    if (!check_file_header(header,make_chunked_file_header(*this),fpath)) {
+        close(fd);
+        return false;
+    }
+    if (block_rows==0 || n_blocks!=(loc_size+block_rows-1)/block_rows) {
+        std::cerr<<fpath<<": the block index is corrupted"<<endl;
+        close(fd);
+        return false;
+    }
+
+    std::vector<uint64_t> offsets(n_blocks+1);
+    size_t index_bytes=sizeof(uint64_t)*offsets.size();
+    if (pread(fd,offsets.data(),index_bytes,sizeof(header)+sizeof(block_rows)+sizeof(n_blocks))!=(ssize_t)index_bytes) {
+        std::cerr<<fpath<<": the block index is truncated"<<endl;
+        close(fd);
+        return false;
+    }
+
+    // only the blocks holding the requested rows are read, the other rows stay unreachable.
+    std::vector<uint32_t> selected_blocks;
+    if (start_loc_idxs==nullptr) {
+        for (uint32_t b=0;b<n_blocks;++b) {
+            selected_blocks.push_back(b);
+        }
+    } else {
+        std::vector<bool> selected(n_blocks,false);
+        for (int loc_idx: *start_loc_idxs) {
+            selected[(size_t)loc_idx/block_rows]=true;
+        }
+        for (uint32_t b=0;b<n_blocks;++b) {
+            if (selected[b]) {
+                selected_blocks.push_back(b);
+            }
+        }
+    }
+
+    allocate_tables();
+    char * main_table=mode==HeuristicMode::QUANTIZED?(char *)main_heuristics_q:(char *)main_heuristics;
+    char * sub_table=mode==HeuristicMode::QUANTIZED?(char *)sub_heuristics_q:(char *)sub_heuristics;
+    size_t main_row_bytes=main_table_bytes()/loc_size;
+    size_t sub_row_bytes=sub_table_bytes()/loc_size;
+
+    std::atomic<bool> failed{false};
+    #pragma omp parallel
+    {
+        std::vector<char> buffer;
+        #pragma omp for schedule(dynamic,1)
+        for (size_t i=0;i<selected_blocks.size();++i) {
+            uint32_t b=selected_blocks[i];
+            size_t row_start=(size_t)b*block_rows;
+            size_t n_rows=std::min((size_t)block_rows,loc_size-row_start);
+            size_t block_bytes=offsets[b+1]-offsets[b];
+
+            buffer.resize(block_bytes);
+            if (pread(fd,buffer.data(),block_bytes,(off_t)offsets[b])!=(ssize_t)block_bytes) {
+                failed=true;
+                continue;
+            }
+
+            boost::iostreams::filtering_streambuf<boost::iostreams::input> inbuf;
+            inbuf.push(boost::iostreams::zlib_decompressor());
+            inbuf.push(boost::iostreams::array_source(buffer.data(),block_bytes));
+            std::istream in(&inbuf);
+            try {
+                in.read(main_table+row_start*main_row_bytes,(std::streamsize)(n_rows*main_row_bytes));
+                if (sub_row_bytes>0)
+                    in.read(sub_table+row_start*sub_row_bytes,(std::streamsize)(n_rows*sub_row_bytes));
+            } catch (const boost::iostreams::zlib_error &) {
+                in.setstate(std::ios::failbit);
+            }
+            if (!in) {
+                failed=true;
+            }
+        }
+    }
+    close(fd);
+
+    if (failed) {
+        std::cerr<<fpath<<": failed to read or decompress blocks"<<endl;
+        return false;
+    }
+
+    ONLYDEV(g_timer.record_d("heu/load_start","heu/load_end","heu/load");)
+    DEV_DEBUG("[end] load chunked heuristics from {}. ({}/{} blocks, duration: {:.3f})",fpath,selected_blocks.size(),n_blocks,g_timer.get_d("heu/load"));
+    return true;
+}
@@ -4,6 +4,7 @@ Timer g_timer;
 
 steady_clock::time_point Timer::record_p(const string & pkey)
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     auto t=steady_clock::now();
     time_points[pkey]=t;
     return t;
@@ -11,6 +12,7 @@ steady_clock::time_point Timer::record_p(const string & pkey)
 
 steady_clock::time_point Timer::get_p(const string & pkey) const
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     const auto & iter=time_points.find(pkey);
     if (iter!=time_points.end())
     {
@@ -26,6 +28,7 @@ steady_clock::time_point Timer::get_p(const string & pkey) const
 
 double Timer::record_d(const string & old_pkey, const string & new_pkey, const string & dkey)
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     auto new_p=record_p(new_pkey);
     auto old_p=get_p(old_pkey);
     auto d=duration<double>(new_p-old_p).count();
@@ -48,12 +51,14 @@ double Timer::record_d(const string & old_pkey, const string & new_pkey, const s
 
 double Timer::record_d(const string & old_pkey, const string & new_pkey)
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     return record_d(old_pkey,new_pkey,new_pkey);
 }
 
 
 double Timer::get_d(const string & dkey, int mode) const
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     const auto & iter=time_durations.find(dkey);
     double d=0;
     if (iter!=time_durations.end())
@@ -80,6 +85,7 @@ double Timer::get_d(const string & dkey, int mode) const
 
 std::unordered_map<string,double> Timer::get_all_d(int mode) const
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     std::unordered_map<string,double> ret;
     for (const auto & pair: time_durations)
     {
@@ -90,6 +96,7 @@ std::unordered_map<string,double> Timer::get_all_d(int mode) const
 
 void Timer::remove_p(const string & pkey)
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     int num=time_points.erase(pkey);
     if (num==0)
     {
@@ -101,6 +108,7 @@ void Timer::remove_p(const string & pkey)
 
 void Timer::remove_d(const string & dkey)
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     int num=time_durations.erase(dkey);
     if (num==0)
     {
@@ -114,6 +122,7 @@ void Timer::remove_d(const string & dkey)
 
 void Timer::clear_d()
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     time_durations.clear();
     time_duration_counters.clear();
     time_durations_last.clear();
@@ -121,17 +130,20 @@ void Timer::clear_d()
 
 void Timer::clear_p()
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     time_points.clear();
 }
 
 void Timer::clear()
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     clear_p();
     clear_d();
 }
 
 void Timer::print_d(const string & dkey) const
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     double sum_d=get_d(dkey,0);
     double mean_d=get_d(dkey,1);
     double last_d=get_d(dkey,2);
@@ -145,6 +157,7 @@ void Timer::print_d(const string & dkey) const
 
 void Timer::print_all_d() const
 {
+    std::lock_guard<std::recursive_mutex> lock(mtx);
     for (const auto & pair: time_durations)
     {
         print_d(pair.first);
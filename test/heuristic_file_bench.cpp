@@ -0,0 +1,120 @@
+#include "util/HeuristicTable.h"
+#include "Grid.h"
+#include "util/MyLogger.h"
+#include <cstring>
+#include <random>
+
+// compare the single-stream gz file of HeuristicTable::save/load with the chunked file of save_chunked/load_chunked.
+// usage: heuristic_file_bench map_file output_folder [mode=dense] [consider_rotation=1] [chunk_rows=64]
+// e.g. heuristic_file_bench example_problems/warehouse.domain/maps/sortation_large.map /tmp quantized 0
+
+using Clock=std::chrono::steady_clock;
+
+double seconds_since(const Clock::time_point & start) {
+    return std::chrono::duration<double>(Clock::now()-start).count();
+}
+
+bool same_tables(const HeuristicTable & a, const HeuristicTable & b, const std::vector<int> * rows=nullptr) {
+    bool quantized=a.mode==HeuristicMode::QUANTIZED;
+    const char * a_main=quantized?(const char *)a.main_heuristics_q:(const char *)a.main_heuristics;
+    const char * b_main=quantized?(const char *)b.main_heuristics_q:(const char *)b.main_heuristics;
+    const char * a_sub=quantized?(const char *)a.sub_heuristics_q:(const char *)a.sub_heuristics;
+    const char * b_sub=quantized?(const char *)b.sub_heuristics_q:(const char *)b.sub_heuristics;
+    size_t main_row_bytes=a.main_table_bytes()/a.loc_size;
+    size_t sub_row_bytes=a.sub_table_bytes()/a.loc_size;
+
+    if (rows==nullptr) {
+        return memcmp(a_main,b_main,a.main_table_bytes())==0 && (sub_row_bytes==0 || memcmp(a_sub,b_sub,a.sub_table_bytes())==0);
+    }
+
+    for (int row: *rows) {
+        if (memcmp(a_main+row*main_row_bytes,b_main+row*main_row_bytes,main_row_bytes)!=0) {
+            return false;
+        }
+        if (sub_row_bytes>0 && memcmp(a_sub+row*sub_row_bytes,b_sub+row*sub_row_bytes,sub_row_bytes)!=0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char ** argv) {
+    if (argc<3) {
+        std::cerr<<"usage: "<<argv[0]<<" map_file output_folder [mode=dense] [consider_rotation=1] [chunk_rows=64]"<<std::endl;
+        return -1;
+    }
+
+    // HeuristicTable logs through g_logger in DEV builds.
+    g_logger.init("logs/bench");
+
+    Grid grid(argv[1]);
+    string folder=argv[2];
+    nlohmann::json config;
+    config["mode"]=argc>3?argv[3]:"dense";
+    bool consider_rotation=argc>4?atoi(argv[4])!=0:true;
+    config["chunk_rows"]=argc>5?atoi(argv[5]):64;
+
+    SharedEnvironment env;
+    env.rows=grid.rows;
+    env.cols=grid.cols;
+    env.map=grid.map;
+    env.map_name=grid.map_name;
+    env.file_storage_path=folder;
+    auto map_weights=std::make_shared<std::vector<float> >(env.rows*env.cols*5,1);
+
+    string gz_path=folder+"/heuristic_file_bench.gz";
+    string chunked_path=folder+"/heuristic_file_bench.heuz";
+
+    HeuristicTable table(&env,map_weights,consider_rotation,config);
+    auto start=Clock::now();
+    table.compute_weighted_heuristics();
+    printf("compute: %.3fs (%d threads)\n",seconds_since(start),omp_get_max_threads());
+
+    {
+        start=Clock::now();
+        table.save(gz_path);
+        double save_time=seconds_since(start);
+
+        HeuristicTable loaded(&env,map_weights,consider_rotation,config);
+        start=Clock::now();
+        loaded.load(gz_path);
+        double load_time=seconds_since(start);
+
+        printf("gz: save %.3fs, load %.3fs, %zu bytes, bit-exact %d\n",
+            save_time,load_time,(size_t)boost::filesystem::file_size(gz_path),same_tables(table,loaded));
+    }
+
+    {
+        start=Clock::now();
+        table.save_chunked(chunked_path);
+        double save_time=seconds_since(start);
+
+        HeuristicTable loaded(&env,map_weights,consider_rotation,config);
+        start=Clock::now();
+        bool succ=loaded.load_chunked(chunked_path);
+        double load_time=seconds_since(start);
+
+        printf("chunked: save %.3fs, load %.3fs, %zu bytes, bit-exact %d\n",
+            save_time,load_time,(size_t)boost::filesystem::file_size(chunked_path),succ && same_tables(table,loaded));
+    }
+
+    {
+        // the rows of 1% of the locations, e.g. the current positions of agents.
+        std::vector<int> rows;
+        std::mt19937 rng(0);
+        for (size_t i=0;i<std::max((size_t)1,table.loc_size/100);++i) {
+            rows.push_back((int)(rng()%table.loc_size));
+        }
+
+        HeuristicTable loaded(&env,map_weights,consider_rotation,config);
+        start=Clock::now();
+        bool succ=loaded.load_chunked(chunked_path,&rows);
+        double load_time=seconds_since(start);
+
+        printf("chunked partial: load %zu rows %.3fs, bit-exact %d\n",rows.size(),load_time,succ && same_tables(table,loaded,&rows));
+    }
+
+    boost::filesystem::remove(gz_path);
+    boost::filesystem::remove(chunked_path);
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "LaCAM2/planner.hpp"
+#include "Grid.h"
+#include "util/MyLogger.h"
+#include <random>
+
+// time LaCAM2::HNode::init, which orders the agents of every high-level node, on a chain of configurations where
+// move_rate of the agents move or rotate at each step, and check the order against sorting all agents from scratch.
+// the heuristics are lazy rows of n_goals distinct goals, warmed up before timing.
+// usage: lacam2_hnode_bench map_file [n_agents=5000] [n_nodes=200] [move_rate=0.8] [n_goals=200]
+// e.g. lacam2_hnode_bench example_problems/warehouse.domain/maps/warehouse_large.map 10000
+
+using Clock=std::chrono::steady_clock;
+
+// the order HNode::init derives incrementally, by sorting all agents.
+void sort_all(const LaCAM2::Config & C, LaCAM2::Instance & ins, HeuristicTable & HT, uint d, int order_strategy, std::vector<uint> & order) {
+    const auto N=C.size();
+    std::vector<std::tuple<bool,bool,bool,float,float,float,int> > scores;
+    for (int i=0;i<N;++i) {
+        const auto & a=ins.agent_infos[i];
+        bool precomputed=ins.precomputed_paths!=nullptr && (*(ins.precomputed_paths))[i].size()>(d+1);
+        float h=HT.get(C.locs[i]->index,C.orients[i],ins.goals.locs[i]->index);
+        scores.emplace_back(a.disabled,C.arrivals[i],precomputed,a.elapsed,h,a.tie_breaker,i);
+    }
+    std::sort(scores.begin(),scores.end(),[&](const std::tuple<bool,bool,bool,float,float,float,int> & s1, const std::tuple<bool,bool,bool,float,float,float,int> & s2) {
+        if (std::get<0>(s1)!=std::get<0>(s2)) return std::get<0>(s1)<std::get<0>(s2);
+        if (std::get<1>(s1)!=std::get<1>(s2)) return std::get<1>(s1)<std::get<1>(s2);
+        if (std::get<2>(s1)!=std::get<2>(s2)) return std::get<2>(s1)>std::get<2>(s2);
+        if (order_strategy==0) {
+            if (std::get<4>(s1)!=std::get<4>(s2)) return std::get<4>(s1)<std::get<4>(s2);
+            if (std::get<3>(s1)!=std::get<3>(s2)) return std::get<3>(s1)>std::get<3>(s2);
+        } else {
+            if (std::get<3>(s1)!=std::get<3>(s2)) return std::get<3>(s1)>std::get<3>(s2);
+            if (std::get<4>(s1)!=std::get<4>(s2)) return std::get<4>(s1)<std::get<4>(s2);
+        }
+        if (std::get<5>(s1)!=std::get<5>(s2)) return std::get<5>(s1)>std::get<5>(s2);
+        return std::get<6>(s1)<std::get<6>(s2);
+    });
+    order.resize(N);
+    for (int i=0;i<N;++i) {
+        order[i]=std::get<6>(scores[i]);
+    }
+}
+
+int main(int argc, char ** argv) {
+    if (argc<2) {
+        std::cerr<<"usage: "<<argv[0]<<" map_file [n_agents=5000] [n_nodes=200] [move_rate=0.8] [n_goals=200]"<<std::endl;
+        return -1;
+    }
+
+    // HeuristicTable logs through g_logger in DEV builds.
+    g_logger.init("logs/bench");
+
+    Grid grid(argv[1]);
+    int n_agents=argc>2?atoi(argv[2]):5000;
+    int n_nodes=argc>3?atoi(argv[3]):200;
+    double move_rate=argc>4?atof(argv[4]):0.8;
+    int n_goals=argc>5?atoi(argv[5]):200;
+    int order_strategy=1;
+
+    SharedEnvironment env;
+    env.rows=grid.rows;
+    env.cols=grid.cols;
+    env.map=grid.map;
+    env.map_name=grid.map_name;
+    auto map_weights=std::make_shared<std::vector<float> >(env.rows*env.cols*5,1);
+
+    nlohmann::json config;
+    config["mode"]="lazy";
+    config["lazy_cache_size_mb"]=4096;
+    auto HT=std::make_shared<HeuristicTable>(&env,map_weights,true,config);
+    LaCAM2::Graph G(env);
+    if (n_agents>G.V.size()) {
+        std::cerr<<"too many agents for "<<G.V.size()<<" vertices"<<std::endl;
+        return -1;
+    }
+
+    std::mt19937 rng(0);
+    std::vector<uint> vertices(G.V.size());
+    std::iota(vertices.begin(),vertices.end(),0);
+    std::shuffle(vertices.begin(),vertices.end(),rng);
+    std::vector<std::pair<uint,int> > starts,goals;
+    std::vector<LaCAM2::AgentInfo> agent_infos(n_agents);
+    for (int i=0;i<n_agents;++i) {
+        starts.emplace_back(G.V[vertices[i]]->index,rng()%4);
+        goals.emplace_back(G.V[vertices[rng()%n_goals]]->index,-1);
+        agent_infos[i].id=i;
+        agent_infos[i].elapsed=(float)(rng()%50);
+        agent_infos[i].tie_breaker=std::uniform_real_distribution<float>(0,1)(rng);
+    }
+    LaCAM2::Instance ins(G,starts,goals,agent_infos);
+
+    // the configurations of the chain, agents don't avoid each other, which doesn't matter for ordering.
+    std::vector<LaCAM2::Config> configs(n_nodes,ins.starts);
+    for (int k=1;k<n_nodes;++k) {
+        configs[k]=configs[k-1];
+        for (int i=0;i<n_agents;++i) {
+            if (std::uniform_real_distribution<double>(0,1)(rng)>=move_rate) {
+                continue;
+            }
+            auto v=configs[k].locs[i];
+            if (rng()%2==0 && !v->neighbor.empty()) {
+                configs[k].locs[i]=v->neighbor[rng()%v->neighbor.size()];
+            } else {
+                configs[k].orients[i]=(configs[k].orients[i]+1+2*(rng()%2))%4;
+            }
+            configs[k].arrivals[i]=configs[k].arrivals[i] | (configs[k].locs[i]==ins.goals.locs[i]);
+        }
+    }
+
+    // warm up the heuristic rows and the arena.
+    std::vector<uint> order;
+    sort_all(configs[0],ins,*HT,0,order_strategy,order);
+    LaCAM2::SearchArena arena;
+    auto init_chain=[&]() {
+        arena.reset();
+        LaCAM2::HNode * parent=nullptr;
+        for (int k=0;k<n_nodes;++k) {
+            auto H=arena.hnodes.allocate();
+            H->init(configs[k],HT,&ins,parent,0,0,k,order_strategy,false,arena);
+            parent=H;
+        }
+    };
+    init_chain();
+
+    auto start=Clock::now();
+    init_chain();
+    double incremental=std::chrono::duration<double>(Clock::now()-start).count();
+
+    start=Clock::now();
+    for (int k=0;k<n_nodes;++k) {
+        sort_all(configs[k],ins,*HT,k,order_strategy,order);
+    }
+    double full_sort=std::chrono::duration<double>(Clock::now()-start).count();
+
+    int n_mismatches=0;
+    arena.reset();
+    LaCAM2::HNode * parent=nullptr;
+    for (int k=0;k<n_nodes;++k) {
+        auto H=arena.hnodes.allocate();
+        H->init(configs[k],HT,&ins,parent,0,0,k,order_strategy,false,arena);
+        sort_all(configs[k],ins,*HT,k,order_strategy,order);
+        n_mismatches+=H->order!=order;
+        parent=H;
+    }
+
+    printf("%d agents, %d nodes, move rate %.2f: HNode::init %.1fus/node, sorting all agents %.1fus/node, %d mismatched orders\n",
+        n_agents,n_nodes,move_rate,incremental/n_nodes*1e6,full_sort/n_nodes*1e6,n_mismatches);
+    return n_mismatches==0?0:-1;
+}
@@ -0,0 +1,149 @@
+#include "LaCAM2/planner.hpp"
+#include "Grid.h"
+#include "util/MyLogger.h"
+#include <random>
+#include <omp.h>
+
+// time one PIBT step, LaCAM2::Planner::get_new_config, sequentially and in tiles of tile_size on a run of n_steps
+// steps, where the agents follow the configurations of the sequential PIBT, and check that every configuration of
+// the tiled PIBT is complete and collision-free. the heuristics are lazy rows of n_goals distinct goals.
+// usage: lacam2_pibt_bench map_file [n_agents=10000] [n_steps=50] [tile_size=32] [n_goals=200]
+// e.g. OMP_NUM_THREADS=8 lacam2_pibt_bench example_problems/warehouse.domain/maps/sortation_large.map
+
+using Clock=std::chrono::steady_clock;
+
+// the number of agents that are not planned or collide.
+int count_invalid(LaCAM2::Planner & planner) {
+    int n_invalid=0;
+    std::vector<int> next(planner.V_size,-1);
+    for (auto a: planner.A) {
+        if (a->v_next==nullptr) {
+            ++n_invalid;
+            continue;
+        }
+        bool adjacent=a->v_next==a->v_now
+            || std::find(a->v_now->neighbor.begin(),a->v_now->neighbor.end(),a->v_next)!=a->v_now->neighbor.end();
+        if (!adjacent || next[a->v_next->id]>=0) {
+            ++n_invalid;
+        }
+        next[a->v_next->id]=a->id;
+    }
+    for (auto a: planner.A) {
+        auto b=a->v_next==nullptr?nullptr:planner.occupied_now[a->v_next->id];
+        if (b!=nullptr && b!=a && b->v_next==a->v_now) {
+            ++n_invalid;
+        }
+    }
+    return n_invalid;
+}
+
+int main(int argc, char ** argv) {
+    if (argc<2) {
+        std::cerr<<"usage: "<<argv[0]<<" map_file [n_agents=10000] [n_steps=50] [tile_size=32] [n_goals=200]"<<std::endl;
+        return -1;
+    }
+
+    // HeuristicTable logs through g_logger in DEV builds.
+    g_logger.init("logs/bench");
+
+    Grid grid(argv[1]);
+    int n_agents=argc>2?atoi(argv[2]):10000;
+    int n_steps=argc>3?atoi(argv[3]):50;
+    int tile_size=argc>4?atoi(argv[4]):32;
+    int n_goals=argc>5?atoi(argv[5]):200;
+
+    SharedEnvironment env;
+    env.rows=grid.rows;
+    env.cols=grid.cols;
+    env.map=grid.map;
+    env.map_name=grid.map_name;
+    auto map_weights=std::make_shared<std::vector<float> >(env.rows*env.cols*5,1);
+
+    nlohmann::json config;
+    config["mode"]="lazy";
+    config["lazy_cache_size_mb"]=4096;
+    auto HT=std::make_shared<HeuristicTable>(&env,map_weights,true,config);
+    LaCAM2::Graph G(env);
+    if (n_agents>G.V.size()) {
+        std::cerr<<"too many agents for "<<G.V.size()<<" vertices"<<std::endl;
+        return -1;
+    }
+
+    std::mt19937 rng(0);
+    std::vector<uint> vertices(G.V.size());
+    std::iota(vertices.begin(),vertices.end(),0);
+    std::shuffle(vertices.begin(),vertices.end(),rng);
+    std::vector<std::pair<uint,int> > starts,goals;
+    std::vector<LaCAM2::AgentInfo> agent_infos(n_agents);
+    for (int i=0;i<n_agents;++i) {
+        starts.emplace_back(G.V[vertices[i]]->index,rng()%4);
+        goals.emplace_back(G.V[vertices[rng()%n_goals]]->index,-1);
+        agent_infos[i].id=i;
+        agent_infos[i].elapsed=(float)(rng()%50);
+        agent_infos[i].tie_breaker=std::uniform_real_distribution<float>(0,1)(rng);
+    }
+    LaCAM2::Instance ins(G,starts,goals,agent_infos);
+
+    std::mt19937 MT(0);
+    LaCAM2::Planner sequential(&ins,HT,map_weights,nullptr,&MT,0,LaCAM2::OBJ_SUM_OF_LOSS,0.0F,false,true,false,false);
+    LaCAM2::Planner tiled(&ins,HT,map_weights,nullptr,&MT,0,LaCAM2::OBJ_SUM_OF_LOSS,0.0F,false,true,false,false,
+        nullptr,nullptr,tile_size);
+    // as in Planner::solve.
+    for (int i=0;i<n_agents;++i) {
+        sequential.A[i]=new LaCAM2::Agent(i);
+        tiled.A[i]=new LaCAM2::Agent(i);
+    }
+
+    int n_interior=0;
+    for (auto v: G.V) {
+        n_interior+=tiled.vertex_tiles[v->id]>=0;
+    }
+
+    LaCAM2::SearchArena arena;
+    LaCAM2::Config C=ins.starts;
+    double sequential_time=0;
+    double tiled_time=0;
+    int n_invalid=0;
+    int n_failed=0;
+    for (int step=-1;step<n_steps;++step) {
+        arena.reset();
+        auto H=arena.hnodes.allocate();
+        H->init(C,HT,&ins,nullptr,0,0,0,1,false,arena);
+        auto L=H->search_tree.front();
+
+        auto start=Clock::now();
+        bool tiled_res=tiled.get_new_config(H,L);
+        double elapse=std::chrono::duration<double>(Clock::now()-start).count();
+        n_failed+=!tiled_res;
+        n_invalid+=count_invalid(tiled);
+
+        start=Clock::now();
+        bool res=sequential.get_new_config(H,L);
+        double sequential_elapse=std::chrono::duration<double>(Clock::now()-start).count();
+
+        // the first step warms up the heuristic rows.
+        if (step>=0) {
+            tiled_time+=elapse;
+            sequential_time+=sequential_elapse;
+        }
+
+        if (!res) {
+            std::cerr<<"sequential PIBT failed at step "<<step<<std::endl;
+            return -1;
+        }
+        for (int i=0;i<n_agents;++i) {
+            auto a=sequential.A[i];
+            int diff=a->v_next->index-a->v_now->index;
+            if (diff!=0) {
+                C.orients[i]=diff==1?0:(diff==env.cols?1:(diff==-1?2:3));
+            }
+            C.locs[i]=a->v_next;
+            C.arrivals[i]=C.arrivals[i] | (C.locs[i]==ins.goals.locs[i]);
+        }
+    }
+
+    printf("%d agents, %d steps, %d threads, tiles of %d with %.1f%% of the vertices inside: sequential %.2fms/step (%.1f configs/s), tiled %.2fms/step (%.1f configs/s), %d failed steps, %d invalid moves\n",
+        n_agents,n_steps,omp_get_max_threads(),tile_size,100.0*n_interior/(double)G.V.size(),
+        sequential_time/n_steps*1e3,n_steps/sequential_time,tiled_time/n_steps*1e3,n_steps/tiled_time,n_failed,n_invalid);
+    return n_invalid==0?0:-1;
+}
@@ -0,0 +1,136 @@
+#include "LNS/Parallel/NeighborGenerator.h"
+#include "Grid.h"
+#include "util/MyLogger.h"
+#include <random>
+
+// time LNS::Parallel::NeighborGenerator::generate for every destroy heuristic, and check that two generators with
+// the same seed destroy the same agents, i.e., no choice depends on rand() or on the other threads.
+// other agents are random walks in the path table towards random goals, so they have delays for the congestion
+// heuristic.
+// usage: neighbor_generator_bench map_file [n_neighbors=2000] [n_agents=200] [window=15] [n_threads=4]
+// e.g. neighbor_generator_bench example_problems/random.domain/maps/random-32-32-20.map
+
+using Clock=std::chrono::steady_clock;
+using namespace LNS::Parallel;
+
+int main(int argc, char ** argv) {
+    if (argc<2) {
+        std::cerr<<"usage: "<<argv[0]<<" map_file [n_neighbors=2000] [n_agents=200] [window=15] [n_threads=4]"<<std::endl;
+        return -1;
+    }
+
+    // HeuristicTable logs through g_logger in DEV builds.
+    g_logger.init("logs/bench");
+
+    Grid grid(argv[1]);
+    int n_neighbors=argc>2?atoi(argv[2]):2000;
+    int n_agents=argc>3?atoi(argv[3]):200;
+    int window=argc>4?atoi(argv[4]):15;
+    int n_threads=argc>5?atoi(argv[5]):4;
+
+    SharedEnvironment env;
+    env.rows=grid.rows;
+    env.cols=grid.cols;
+    env.map=grid.map;
+    env.map_name=grid.map_name;
+    env.num_of_agents=n_agents;
+    auto map_weights=std::make_shared<std::vector<float> >(env.rows*env.cols*5,1);
+
+    auto HT=std::make_shared<HeuristicTable>(&env,map_weights,true);
+    HT->compute_weighted_heuristics();
+
+    std::mt19937 rng(0);
+    auto random_loc=[&]() {
+        return HT->empty_locs[rng()%HT->loc_size];
+    };
+
+    // each agent occupies a random walk, so no two agents are at the same location at the same time.
+    LNS::PathTable path_table(env.rows*env.cols,window);
+    std::vector<LNS::Parallel::Path> paths(n_agents);
+    const int offsets[4]={1,env.cols,-1,-env.cols};
+    for (int agent_id=0;agent_id<n_agents;++agent_id) {
+        auto & path=paths[agent_id];
+        int loc=random_loc();
+        while (path_table.constrained(loc,loc,0)) {
+            loc=random_loc();
+        }
+        path.nodes.emplace_back(loc,0);
+        for (int t=1;t<=window;++t) {
+            int next_loc=loc;
+            int dir=(int)(rng()%5);
+            if (dir<4) {
+                int x=loc%env.cols+(dir==0?1:(dir==2?-1:0));
+                int y=loc/env.cols+(dir==1?1:(dir==3?-1:0));
+                if (x>=0 && x<env.cols && y>=0 && y<env.rows && env.map[loc+offsets[dir]]==0) {
+                    next_loc=loc+offsets[dir];
+                }
+            }
+            if (path_table.constrained(loc,next_loc,t)) {
+                next_loc=loc;
+            }
+            if (path_table.constrained(loc,next_loc,t)) {
+                break;
+            }
+            loc=next_loc;
+            path.nodes.emplace_back(loc,0);
+        }
+        path_table.insertPath(agent_id,path);
+        env.curr_states.emplace_back(path.nodes[0].location,0,0);
+        env.goal_locations.push_back({{random_loc(),0}});
+    }
+
+    LNS::Instance instance(env);
+    auto agent_infos=std::make_shared<std::vector<LaCAM2::AgentInfo> >(n_agents);
+    std::vector<Agent> agents;
+    for (int agent_id=0;agent_id<n_agents;++agent_id) {
+        agents.emplace_back(agent_id,instance,HT,agent_infos);
+        agents.back().path=paths[agent_id];
+        agents.back().path.path_cost=agents.back().getEstimatedPathLength(agents.back().path,instance.goal_locations[agent_id],HT);
+    }
+    CommitLog commit_log;
+    PathStore path_store(agents,commit_log,n_agents);
+    CongestionIndex congestion_index(instance,4,window+1);
+    congestion_index.update(agents);
+
+    TimeLimiter time_limiter(1000);
+    const char * names[]={"random_agents","random_walk","intersection","congestion","adaptive"};
+    bool same=true;
+    for (int strategy=0;strategy<=DESTORY_COUNT;++strategy) {
+        bool ALNS=strategy==DESTORY_COUNT;
+        auto run=[&](std::vector<std::vector<int> > & neighbors) {
+            NeighborGenerator generator(
+                instance, HT, path_table, agents, path_store, agent_infos, &congestion_index,
+                8, ALNS?RANDOMWALK:(destroy_heuristic)strategy,
+                ALNS, 0.01, 0.01, n_threads, true, 0, 2023
+            );
+            for (int i=0;i<n_neighbors;++i) {
+                auto & neighbor=generator.generate(time_limiter,i%n_threads);
+                neighbors.push_back(neighbor.agents);
+                if (ALNS) {
+                    // so that the weights, and hence the choices of the roulette wheel, change.
+                    neighbor.old_sum_of_costs=1;
+                    neighbor.sum_of_costs=(float)(i%2);
+                    neighbor.succ=i%2==0;
+                    generator.update(neighbor);
+                }
+            }
+        };
+
+        std::vector<std::vector<int> > neighbors,other_neighbors;
+        auto start=Clock::now();
+        run(neighbors);
+        double elapsed=std::chrono::duration<double>(Clock::now()-start).count();
+        run(other_neighbors);
+
+        size_t n_destroyed=0;
+        for (auto & neighbor: neighbors) {
+            n_destroyed+=neighbor.size();
+        }
+        bool strategy_same=neighbors==other_neighbors;
+        same=same && strategy_same;
+        printf("%s, %d neighbors: %.3fs, %.0f neighbors/s, %.2f agents per neighbor, same with the same seed: %s\n",
+            names[strategy],n_neighbors,elapsed,n_neighbors/elapsed,(double)n_destroyed/n_neighbors,strategy_same?"yes":"no");
+    }
+
+    return same?0:1;
+}
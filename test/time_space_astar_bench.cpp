@@ -0,0 +1,214 @@
+#include "LNS/Parallel/TimeSpaceAStarPlanner.h"
+#include "LNS/Parallel/SIPPPlanner.h"
+#include "Grid.h"
+#include "util/MyLogger.h"
+#include <random>
+#include <queue>
+#include <unordered_map>
+
+// time LNS::Parallel::TimeSpaceAStarPlanner::findPath, the single-agent search of every LNS iteration, or
+// SIPPPlanner::findPath with planner=sipp. planner=baseline is the same search with the data structures the planner
+// had before it became allocation-free: a std::priority_queue open list with lazy updates, a std::unordered_map of
+// the states and a new state per successor, so both can be compared on one build.
+// other agents are random walks in the path table, so the searches have to wait and detour around them.
+// with table=view, the searches run in a view of the path table that hides 8 agents and shows 8 other paths, as in
+// a local optimizer replanning a neighbor.
+// usage: time_space_astar_bench map_file [n_queries=2000] [n_agents=200] [window=15] [planner=astar|baseline|sipp] [table=own|view]
+// e.g. time_space_astar_bench example_problems/random.domain/maps/random-32-32-20.map
+
+using Clock=std::chrono::steady_clock;
+using AStarState=LNS::Parallel::TimeSpaceAStarState;
+
+// TimeSpaceAStarPlanner::findPath with a std::priority_queue and a std::unordered_map. an improved state is a new
+// copy pushed again, and the stale copies are skipped when popped. the successors come from the planner, so the
+// search is the same up to tie breaking.
+struct BaselineTimeSpaceAStar {
+    LNS::Parallel::TimeSpaceAStarPlanner & planner;
+    std::unordered_map<uint64_t,AStarState *> all_states;
+    std::vector<AStarState *> allocated;
+    LNS::Parallel::Path path;
+    int n_expanded=0;
+    int n_generated=0;
+
+    explicit BaselineTimeSpaceAStar(LNS::Parallel::TimeSpaceAStarPlanner & planner): planner(planner) {}
+    ~BaselineTimeSpaceAStar() { clear(); }
+
+    void clear() {
+        for (auto state: allocated) {
+            delete state;
+        }
+        allocated.clear();
+        all_states.clear();
+        path.clear();
+        n_expanded=0;
+        n_generated=0;
+    }
+
+    AStarState * allocate(const AStarState & state) {
+        AStarState * new_state=new AStarState(state);
+        new_state->closed=false;
+        allocated.push_back(new_state);
+        return new_state;
+    }
+
+    void findPath(int start_pos, int start_orient, int goal_pos, LNS::ConstraintTable & constraint_table, const TimeLimiter & time_limiter) {
+        clear();
+        std::priority_queue<AStarState *,std::vector<AStarState *>,AStarState::Compare> open_list;
+
+        AStarState * start_state=allocate(AStarState(start_pos,start_orient,0,0,planner.HT->get(start_pos,start_orient,goal_pos),0,false,nullptr));
+        open_list.push(start_state);
+        all_states[start_state->key()]=start_state;
+
+        while (!open_list.empty() && !time_limiter.timeout()) {
+            AStarState * curr=open_list.top();
+            open_list.pop();
+            if (curr->closed || all_states[curr->key()]!=curr) {
+                continue;
+            }
+            curr->closed=true;
+            ++n_expanded;
+
+            if ((planner.execution_window==1 && curr->pos==goal_pos && curr->t>=1 && !constraint_table.constrained(curr->pos,curr->t))
+                || curr->t>=constraint_table.window_size_for_PATH) {
+                planner.buildPath(curr,goal_pos);
+                path=planner.path;
+                return;
+            }
+
+            planner.getSuccessors(curr,goal_pos,constraint_table);
+            for (auto & next_state: planner.successors) {
+                ++n_generated;
+                auto it=all_states.find(next_state.key());
+                if (it==all_states.end()) {
+                    AStarState * new_state=allocate(next_state);
+                    all_states.emplace(new_state->key(),new_state);
+                    open_list.push(new_state);
+                } else {
+                    AStarState * old_state=it->second;
+                    if (next_state.num_of_conflicts<old_state->num_of_conflicts || (
+                            next_state.num_of_conflicts==old_state->num_of_conflicts && next_state.f<old_state->f)) {
+                        AStarState * new_state=allocate(next_state);
+                        it->second=new_state;
+                        open_list.push(new_state);
+                    }
+                }
+            }
+        }
+    }
+};
+
+int main(int argc, char ** argv) {
+    if (argc<2) {
+        std::cerr<<"usage: "<<argv[0]<<" map_file [n_queries=2000] [n_agents=200] [window=15] [planner=astar|baseline|sipp] [table=own|view]"<<std::endl;
+        return -1;
+    }
+
+    // HeuristicTable logs through g_logger in DEV builds.
+    g_logger.init("logs/bench");
+
+    Grid grid(argv[1]);
+    int n_queries=argc>2?atoi(argv[2]):2000;
+    int n_agents=argc>3?atoi(argv[3]):200;
+    int window=argc>4?atoi(argv[4]):15;
+    std::string planner_name=argc>5?argv[5]:"astar";
+    std::string table_name=argc>6?argv[6]:"own";
+
+    SharedEnvironment env;
+    env.rows=grid.rows;
+    env.cols=grid.cols;
+    env.map=grid.map;
+    env.map_name=grid.map_name;
+    auto map_weights=std::make_shared<std::vector<float> >(env.rows*env.cols*5,1);
+
+    auto HT=std::make_shared<HeuristicTable>(&env,map_weights,true);
+    HT->compute_weighted_heuristics();
+
+    LNS::Instance instance(env);
+    std::mt19937 rng(0);
+    auto random_loc=[&]() {
+        return HT->empty_locs[rng()%HT->loc_size];
+    };
+
+    // each agent occupies a random walk, so no two agents are at the same location at the same time.
+    LNS::PathTable path_table(instance.map_size,window);
+    std::vector<LNS::Parallel::Path> paths(n_agents);
+    const int offsets[4]={1,env.cols,-1,-env.cols};
+    for (int agent_id=0;agent_id<n_agents;++agent_id) {
+        auto & path=paths[agent_id];
+        int loc=random_loc();
+        while (path_table.constrained(loc,loc,0)) {
+            loc=random_loc();
+        }
+        path.nodes.emplace_back(loc,0);
+        for (int t=1;t<=window;++t) {
+            int next_loc=loc;
+            int dir=(int)(rng()%5);
+            if (dir<4) {
+                int x=loc%env.cols+(dir==0?1:(dir==2?-1:0));
+                int y=loc/env.cols+(dir==1?1:(dir==3?-1:0));
+                if (x>=0 && x<env.cols && y>=0 && y<env.rows && env.map[loc+offsets[dir]]==0) {
+                    next_loc=loc+offsets[dir];
+                }
+            }
+            if (path_table.constrained(loc,next_loc,t)) {
+                next_loc=loc;
+            }
+            if (path_table.constrained(loc,next_loc,t)) {
+                break;
+            }
+            loc=next_loc;
+            path.nodes.emplace_back(loc,0);
+        }
+        path_table.insertPath(agent_id,path);
+    }
+
+    // the first 8 agents are the neighbor: their paths are hidden and shown again as new ones, shifted by 8 agents.
+    LNS::PathTable view(&path_table,window);
+    for (int agent_id=0;agent_id<std::min(n_agents,8);++agent_id) {
+        view.hide(agent_id,paths[agent_id]);
+        if (agent_id+8<n_agents) {
+            view.insertPath(agent_id,paths[agent_id+8]);
+        }
+    }
+
+    LNS::ConstraintTable constraint_table(instance.num_of_cols,instance.map_size,table_name=="view"?&view:&path_table,nullptr,window,window,window);
+    LNS::Parallel::TimeSpaceAStarPlanner planner(instance,HT,map_weights,1);
+    LNS::Parallel::SIPPPlanner sipp_planner(instance,HT,map_weights,1);
+    BaselineTimeSpaceAStar baseline_planner(planner);
+    TimeLimiter time_limiter(1000);
+
+    std::vector<int> starts,orients,goals;
+    for (int i=0;i<n_queries;++i) {
+        starts.push_back(random_loc());
+        orients.push_back(rng()%4);
+        goals.push_back(random_loc());
+    }
+
+    size_t n_expanded=0;
+    size_t n_generated=0;
+    double sum_of_costs=0;
+    auto start=Clock::now();
+    for (int i=0;i<n_queries;++i) {
+        if (planner_name=="sipp") {
+            sipp_planner.findPath(starts[i],orients[i],goals[i],constraint_table,time_limiter);
+            n_expanded+=sipp_planner.n_expanded;
+            n_generated+=sipp_planner.n_generated;
+            sum_of_costs+=sipp_planner.path.path_cost;
+        } else if (planner_name=="baseline") {
+            baseline_planner.findPath(starts[i],orients[i],goals[i],constraint_table,time_limiter);
+            n_expanded+=baseline_planner.n_expanded;
+            n_generated+=baseline_planner.n_generated;
+            sum_of_costs+=baseline_planner.path.path_cost;
+        } else {
+            planner.findPath(starts[i],orients[i],goals[i],constraint_table,time_limiter);
+            n_expanded+=planner.n_expanded;
+            n_generated+=planner.n_generated;
+            sum_of_costs+=planner.path.path_cost;
+        }
+    }
+    double elapsed=std::chrono::duration<double>(Clock::now()-start).count();
+
+    printf("%s in %s table, %d queries: %.3fs, %.0f queries/s, %zu expanded, %zu generated, %.0f expansions/s, sum of costs %.0f\n",
+        planner_name.c_str(),table_name.c_str(),n_queries,elapsed,n_queries/elapsed,n_expanded,n_generated,(double)n_expanded/elapsed,sum_of_costs);
+    return 0;
+}